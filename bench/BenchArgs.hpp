@@ -0,0 +1,65 @@
+#pragma once
+
+// Parses the `--key value` options of a benchmark.
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <print>
+#include <span>
+#include <string_view>
+
+namespace bench_args
+{
+
+/// Parses all of `value` as a number.
+template <typename T> bool parseNumber(std::string_view value, T &target)
+{
+  auto [ptr, ec] =
+      std::from_chars(value.data(), value.data() + value.size(), target);
+  return ec == std::errc{} && ptr == value.data() + value.size();
+}
+
+/// Parses a count of `target`'s unit (e.g. milliseconds) that isn't negative.
+template <typename Rep, typename Period>
+bool parseDuration(std::string_view value,
+                   std::chrono::duration<Rep, Period> &target)
+{
+  Rep count{};
+  if (!parseNumber(value, count) || count < 0)
+  {
+    return false;
+  }
+  target = std::chrono::duration<Rep, Period>(count);
+  return true;
+}
+
+template <typename Config>
+using OptionParser = bool (*)(std::string_view key, std::string_view value,
+                              Config &config);
+
+/// Passes every `--key value` pair of `args` from `first` on (after the
+/// program and positional arguments) to `parseOption`. Fails at the first
+/// option it rejects, and if the last key has no value.
+template <typename Config>
+bool parseArgs(std::span<char *> args, Config &config,
+               OptionParser<Config> parseOption, std::size_t first = 1)
+{
+  if (args.size() < first || (args.size() - first) % 2 != 0)
+  {
+    return false;
+  }
+  for (std::size_t i = first; i < args.size(); i += 2)
+  {
+    std::string_view key = args[i];
+    std::string_view value = args[i + 1];
+    if (!parseOption(key, value, config))
+    {
+      std::println(stderr, "Invalid option: {} {}", key, value);
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace bench_args
@@ -0,0 +1,34 @@
+#pragma once
+
+// A `VoteSink` that counts the votes and skips on the calling thread, for
+// benchmarks that run the pipeline without a UI thread.
+
+#include "VoteCounter.hpp"
+#include "VoteSink.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+class CountingSink : public VoteSink
+{
+public:
+  explicit CountingSink(std::size_t threshold) : counter_(threshold) {}
+
+  void publishVote(Vote vote) override
+  {
+    this->votes_++;
+    if (this->counter_.vote(vote.user, vote.receivedAt) ==
+        VoteCounter::Result::ThresholdReached)
+    {
+      this->skips_++;
+    }
+  }
+
+  std::uint64_t votes() const { return this->votes_; }
+  std::uint64_t skips() const { return this->skips_; }
+
+private:
+  VoteCounter counter_;
+  std::uint64_t votes_ = 0;
+  std::uint64_t skips_ = 0;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+// Summarizes the latencies measured by a benchmark in microseconds.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <format>
+#include <string>
+#include <vector>
+
+namespace latency_stats
+{
+
+using Duration = std::chrono::steady_clock::duration;
+
+inline double toMicros(Duration d)
+{
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+/// The `p` quantile of `sorted` (ascending) - 0 if it's empty.
+inline double percentile(const std::vector<Duration> &sorted, double p)
+{
+  if (sorted.empty())
+  {
+    return 0;
+  }
+  auto idx = std::min(sorted.size() - 1,
+                      static_cast<std::size_t>(
+                          p * static_cast<double>(sorted.size())));
+  return toMicros(sorted[idx]);
+}
+
+/// Sorts `values` and formats their p50, p99 and maximum as a JSON object.
+inline std::string summarize(std::vector<Duration> &values)
+{
+  std::ranges::sort(values);
+  return std::format(R"({{"p50":{:.1f},"p99":{:.1f},"max":{:.1f}}})",
+                     percentile(values, 0.5), percentile(values, 0.99),
+                     percentile(values, 1.0));
+}
+
+} // namespace latency_stats
@@ -0,0 +1,89 @@
+#pragma once
+
+// Counts heap allocations through a replaced global `operator new` and reads
+// the peak resident set size of the process.
+//
+// The replacement operators are defined here, so include this header in
+// exactly one translation unit of a benchmark.
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace memory_stats
+{
+
+inline std::atomic<std::uint64_t> allocations{0};
+inline std::atomic<std::uint64_t> allocatedBytes{0};
+/// Allocations of threads that called `trackThisThread()`
+inline std::atomic<std::uint64_t> trackedAllocations{0};
+inline thread_local bool tracked = false;
+
+inline void trackThisThread()
+{
+  tracked = true;
+}
+
+inline void *allocate(std::size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if (tracked)
+  {
+    trackedAllocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (auto *ptr = std::malloc(size == 0 ? 1 : size))
+  {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+/// Peak resident set size in KiB
+inline std::uint64_t peakRssKb()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+  return counters.PeakWorkingSetSize / 1024;
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<std::uint64_t>(usage.ru_maxrss);
+#endif
+}
+
+} // namespace memory_stats
+
+void *operator new(std::size_t size)
+{
+  return memory_stats::allocate(size);
+}
+void *operator new[](std::size_t size)
+{
+  return memory_stats::allocate(size);
+}
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void *ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void *ptr, std::size_t /*size*/) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void *ptr, std::size_t /*size*/) noexcept
+{
+  std::free(ptr);
+}
@@ -0,0 +1,174 @@
+// Counts the heap allocations of the hot path - parsing, matching and
+// deduplicating PRIVMSGs (`MessageHandler` -> `VoteEngine` -> `VoteCounter`)
+// - through a replaced global `operator new`.
+//
+// Like in `WebSocketSession`, replies are allocated from a `FrameArena` that
+// is reset after every frame. The messages are fed once to warm up the vote
+// set. After that, handling a message must not allocate: the bench fails if
+// any allocation happens in the measured loops.
+
+#include "AppContext.hpp"
+#include "BenchArgs.hpp"
+#include "CountingSink.hpp"
+#include "MemoryStats.hpp"
+#include "chat/VoteEngine.hpp"
+#include "irc/FrameArena.hpp"
+#include "irc/MessageHandler.hpp"
+
+#include <boost/asio/io_context.hpp>
+
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+using bench_args::parseNumber;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::size_t messages = 200'000;
+  std::size_t users = 10'000;
+  /// Messages per frame
+  std::size_t batch = 50;
+  std::size_t threshold = 100;
+  std::size_t loops = 3;
+  std::string out;
+};
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--messages"sv)
+  {
+    ok = parseNumber(value, config.messages) && config.messages > 0;
+  }
+  else if (key == "--users"sv)
+  {
+    ok = parseNumber(value, config.users) && config.users > 0;
+  }
+  else if (key == "--batch"sv)
+  {
+    ok = parseNumber(value, config.batch) && config.batch > 0;
+  }
+  else if (key == "--threshold"sv)
+  {
+    ok = parseNumber(value, config.threshold) && config.threshold > 0;
+  }
+  else if (key == "--loops"sv)
+  {
+    ok = parseNumber(value, config.loops) && config.loops > 0;
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+/// Frames of PRIVMSGs like Twitch sends them - every frame ends with a PING.
+std::vector<std::string> makeFrames(const BenchConfig &config)
+{
+  std::vector<std::string> frames;
+  std::string frame;
+  for (std::size_t i = 0; i < config.messages; i++)
+  {
+    // 7919 is prime, so every user shows up once per `users` messages
+    auto user = (i * 7919) % config.users;
+    std::format_to(
+        std::back_inserter(frame),
+        "@badge-info=;badges={};color=#1E90FF;display-name=simuser{};"
+        "id=bench-{};mod=0;room-id=11148817;subscriber={};"
+        "user-id={};user-type= :simuser{}!simuser{}@simuser{}.tmi.twitch.tv "
+        "PRIVMSG #bench :{}\r\n",
+        user % 2 == 0 ? "subscriber/12"sv : ""sv, user, i,
+        user % 2 == 0 ? 1 : 0, 10000000 + user, user, user, user,
+        i % 4 == 3 ? "hello chat"sv : "-voteskip"sv);
+    if ((i + 1) % config.batch == 0 || i + 1 == config.messages)
+    {
+      frame += "PING :tmi.twitch.tv\r\n";
+      frames.emplace_back(std::move(frame));
+      frame.clear();
+    }
+  }
+  return frames;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr, "Usage: bench_alloc [--messages n] [--users n] "
+                         "[--batch n] [--threshold n] [--loops n] "
+                         "[--out file.json]");
+    return 1;
+  }
+
+  boost::asio::io_context ctx;
+  CountingSink sink(config.threshold);
+  auto app = std::make_shared<AppContext>(ctx.get_executor(), &sink);
+  VoteEngine engine(app, Rules{
+                          .command = "-voteskip",
+                          .channel = "bench",
+                          .allowSubs = true,
+                          .allowNonSubs = true,
+                          .threshold = config.threshold,
+                      });
+  MessageHandler handler(engine, engine.addSource());
+  auto frames = makeFrames(config);
+  FrameArena arena;
+
+  auto feed = [&]
+  {
+    std::size_t messages = 0;
+    for (const auto &frame : frames)
+    {
+      {
+        std::pmr::string replies(arena.resource());
+        messages += handler.handle(frame, std::chrono::steady_clock::now(),
+                                   replies)
+                        .messages;
+      }
+      arena.reset();
+    }
+    return messages;
+  };
+
+  feed();
+
+  std::size_t messages = 0;
+  auto allocationsBefore = memory_stats::allocations.load();
+  auto bytesBefore = memory_stats::allocatedBytes.load();
+  for (std::size_t loop = 0; loop < config.loops; loop++)
+  {
+    messages += feed();
+  }
+  auto steadyAllocations =
+      memory_stats::allocations.load() - allocationsBefore;
+  auto steadyBytes = memory_stats::allocatedBytes.load() - bytesBefore;
+
+  auto json = std::format(
+      R"({{"messages":{},"votes":{},"skips":{},"allocations":{},)"
+      R"("allocated_bytes":{},"allocations_per_message":{:.4f}}})",
+      messages, sink.votes(), sink.skips(), steadyAllocations, steadyBytes,
+      static_cast<double>(steadyAllocations) /
+          static_cast<double>(messages));
+  std::println("{}", json);
+  if (!config.out.empty())
+  {
+    std::ofstream(config.out) << json << '\n';
+  }
+  return steadyAllocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+// Connects `IrcClient` to twitch-irc-sim with a short ping interval and checks
+// that the connection health monitoring reacts to the right things:
+//
+// - `healthy`: the simulator answers PINGs and delivers messages on time for
+//   `--healthy-ms`. The connection must not be replaced, and the PING round
+//   trips must be measured.
+// - `degrading`: after a second, the delivery lag of the messages grows by
+//   `--lag-growth` ms per second. The connection must be replaced within
+//   `--limit-ms` of the degradation starting.
+
+#include "AppContext.hpp"
+#include "BenchArgs.hpp"
+#include "IrcSimulator.hpp"
+#include "irc/IrcClient.hpp"
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace
+{
+
+namespace asio = boost::asio;
+using Clock = std::chrono::steady_clock;
+using bench_args::parseDuration;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::chrono::milliseconds pingInterval{200};
+  std::chrono::milliseconds healthy{3000};
+  std::chrono::milliseconds lagGrowth{2000};
+  std::chrono::milliseconds limit{5000};
+  std::string out;
+};
+
+/// The degradation starts this long after connecting
+constexpr auto DEGRADE_AFTER = std::chrono::seconds(1);
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--ping-ms"sv)
+  {
+    ok = parseDuration(value, config.pingInterval) &&
+         config.pingInterval.count() > 0;
+  }
+  else if (key == "--healthy-ms"sv)
+  {
+    ok = parseDuration(value, config.healthy) && config.healthy.count() > 0;
+  }
+  else if (key == "--lag-growth"sv)
+  {
+    ok = parseDuration(value, config.lagGrowth) &&
+         config.lagGrowth.count() > 0;
+  }
+  else if (key == "--limit-ms"sv)
+  {
+    ok = parseDuration(value, config.limit) && config.limit.count() > 0;
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+struct PhaseResult
+{
+  std::uint64_t unhealthyReconnects = 0;
+  std::uint64_t pings = 0;
+  double rttP50Ms = 0;
+  /// Degradation started -> connection replaced (or -1)
+  double detectMs = -1;
+};
+
+/// Connects to `sim` until `done` returns true or `timeout` passed.
+template <typename Done>
+PhaseResult runPhase(const IrcSimulator &sim, const BenchConfig &config,
+                     std::chrono::milliseconds timeout, Done done)
+{
+  IrcClient client;
+  client.app()->setRules(
+      Rules{
+          .command = "-voteskip",
+          .channel = "bench",
+          .allowSubs = true,
+          .allowNonSubs = true,
+          .threshold = 50,
+      },
+      false);
+  IrcClientOptions options;
+  options.health.pingInterval = config.pingInterval;
+  client.start(
+      Endpoint{
+          .host = "127.0.0.1",
+          .port = std::to_string(sim.port()),
+          .path = "/",
+          .secure = false,
+      },
+      options);
+
+  const auto &metrics = client.app()->metrics();
+  auto start = Clock::now();
+  PhaseResult result;
+  while (Clock::now() - start < timeout)
+  {
+    if (done(metrics))
+    {
+      result.detectMs = std::chrono::duration<double, std::milli>(
+                            Clock::now() - start - DEGRADE_AFTER)
+                            .count();
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  client.stop();
+
+  auto rtt = metrics.histogram(Metrics::Stage::PingRtt).snapshot();
+  result.unhealthyReconnects =
+      metrics.value(Metrics::Counter::UnhealthyReconnects);
+  result.pings = rtt.count;
+  result.rttP50Ms = static_cast<double>(rtt.quantile(0.5)) / 1e6;
+  return result;
+}
+
+SimConfig simConfig(std::chrono::milliseconds lagGrowth)
+{
+  return SimConfig{
+      .address = "127.0.0.1",
+      .port = 0,
+      .rate = 500.0,
+      .command = "-voteskip",
+      .degradeAfter = DEGRADE_AFTER,
+      .lagGrowth = lagGrowth,
+  };
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr, "Usage: bench_health [--ping-ms ms] [--healthy-ms ms] "
+                         "[--lag-growth ms] [--limit-ms ms] [--out file.json]");
+    return 1;
+  }
+
+  asio::io_context serverCtx;
+  IrcSimulator healthySim(serverCtx, simConfig({}));
+  IrcSimulator degradingSim(serverCtx, simConfig(config.lagGrowth));
+  healthySim.start();
+  degradingSim.start();
+
+  auto work = asio::make_work_guard(serverCtx);
+  std::thread serverThread([&] { serverCtx.run(); });
+
+  auto healthy = runPhase(healthySim, config, config.healthy,
+                          [](const Metrics &) { return false; });
+  auto degrading =
+      runPhase(degradingSim, config, DEGRADE_AFTER + config.limit,
+               [](const Metrics &metrics)
+               {
+                 return metrics.value(
+                            Metrics::Counter::UnhealthyReconnects) > 0;
+               });
+
+  // at least half of the PINGs have to be answered
+  auto expectedPings = static_cast<std::uint64_t>(config.healthy /
+                                                  config.pingInterval / 2);
+  bool passed = healthy.unhealthyReconnects == 0 &&
+                healthy.pings >= expectedPings &&
+                degrading.unhealthyReconnects > 0 && degrading.detectMs >= 0;
+
+  auto json = std::format(
+      R"({{"ping_ms":{},"healthy":{{"unhealthy_reconnects":{},"pings":{},)"
+      R"("rtt_p50_ms":{:.3f}}},"degrading":{{"lag_growth_ms":{},)"
+      R"("unhealthy_reconnects":{},"detect_ms":{:.0f}}},"limit_ms":{},)"
+      R"("passed":{}}})",
+      config.pingInterval.count(), healthy.unhealthyReconnects, healthy.pings,
+      healthy.rttP50Ms, config.lagGrowth.count(),
+      degrading.unhealthyReconnects, degrading.detectMs, config.limit.count(),
+      passed);
+  std::println("{}", json);
+  if (!config.out.empty())
+  {
+    std::ofstream(config.out) << json << '\n';
+  }
+
+  work.reset();
+  serverCtx.stop();
+  serverThread.join();
+  return passed ? 0 : 1;
+}
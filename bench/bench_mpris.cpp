@@ -0,0 +1,315 @@
+// Skips through `MprisController` on a real D-Bus bus against a stub MPRIS
+// player that runs in-process on its own connection.
+//
+// Run it on a private bus so no real player gets skipped:
+//
+//     dbus-run-session -- bench_mpris
+//
+// Every skip checks that the controller's cached title follows the stub's
+// `PropertiesChanged` signal.
+
+#include "BenchArgs.hpp"
+#include "LatencyStats.hpp"
+#include "media/MprisController.hpp"
+
+#include <dbus/dbus.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <future>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using bench_args::parseDuration;
+using bench_args::parseNumber;
+using latency_stats::summarize;
+using namespace std::string_view_literals;
+
+constexpr const char *MPRIS_PATH = "/org/mpris/MediaPlayer2";
+constexpr const char *PLAYER_INTERFACE = "org.mpris.MediaPlayer2.Player";
+constexpr const char *PROPERTIES_INTERFACE = "org.freedesktop.DBus.Properties";
+
+struct BenchConfig
+{
+  std::size_t skips = 1000;
+  /// Time the stub takes to handle `Next`
+  std::chrono::microseconds latency{0};
+  std::string address;
+  std::string out;
+};
+
+void appendEntry(DBusMessageIter *dict, const char *key, const char *value)
+{
+  DBusMessageIter entry;
+  DBusMessageIter variant;
+  dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY, nullptr,
+                                   &entry);
+  dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+  dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, "s", &variant);
+  dbus_message_iter_append_basic(&variant, DBUS_TYPE_STRING, &value);
+  dbus_message_iter_close_container(&entry, &variant);
+  dbus_message_iter_close_container(dict, &entry);
+}
+
+/// A player that is always playing and advances a track on `Next`.
+class StubPlayer
+{
+public:
+  StubPlayer(const std::string &address, std::chrono::microseconds latency)
+      : latency_(latency)
+  {
+    DBusError error;
+    dbus_error_init(&error);
+    if (address.empty())
+    {
+      this->connection_ = dbus_bus_get_private(DBUS_BUS_SESSION, &error);
+    }
+    else
+    {
+      this->connection_ = dbus_connection_open_private(address.c_str(), &error);
+      if (this->connection_ != nullptr)
+      {
+        dbus_bus_register(this->connection_, &error);
+      }
+    }
+    if (dbus_error_is_set(&error))
+    {
+      std::string message = error.message;
+      dbus_error_free(&error);
+      throw std::runtime_error(std::format("Stub player: {}", message));
+    }
+    dbus_connection_set_exit_on_disconnect(this->connection_, FALSE);
+
+    DBusObjectPathVTable vtable{};
+    vtable.message_function =
+        [](DBusConnection * /*connection*/, DBusMessage *message, void *self)
+    { return static_cast<StubPlayer *>(self)->handle(message); };
+    dbus_connection_register_object_path(this->connection_, MPRIS_PATH,
+                                         &vtable, this);
+    dbus_bus_request_name(this->connection_, "org.mpris.MediaPlayer2.bench",
+                          DBUS_NAME_FLAG_DO_NOT_QUEUE, &error);
+    dbus_error_free(&error);
+
+    this->thread_ = std::jthread(
+        [this](const std::stop_token &stop)
+        {
+          while (!stop.stop_requested() &&
+                 dbus_connection_read_write_dispatch(this->connection_, 50))
+          {
+          }
+        });
+  }
+
+  ~StubPlayer()
+  {
+    this->thread_.request_stop();
+    this->thread_.join();
+    dbus_connection_close(this->connection_);
+    dbus_connection_unref(this->connection_);
+  }
+
+  StubPlayer(const StubPlayer &) = delete;
+  StubPlayer(StubPlayer &&) noexcept = delete;
+  StubPlayer &operator=(const StubPlayer &) = delete;
+  StubPlayer &operator=(StubPlayer &&) noexcept = delete;
+
+  static std::string title(std::uint64_t track)
+  {
+    return std::format("Track {}", track);
+  }
+
+private:
+  DBusHandlerResult handle(DBusMessage *message)
+  {
+    if (dbus_message_is_method_call(message, PLAYER_INTERFACE, "Next"))
+    {
+      std::this_thread::sleep_for(this->latency_);
+      this->track_++;
+      this->reply(dbus_message_new_method_return(message));
+      this->emitChanged();
+      return DBUS_HANDLER_RESULT_HANDLED;
+    }
+    if (dbus_message_is_method_call(message, PROPERTIES_INTERFACE, "GetAll"))
+    {
+      auto *reply = dbus_message_new_method_return(message);
+      DBusMessageIter args;
+      dbus_message_iter_init_append(reply, &args);
+      this->appendProperties(&args);
+      this->reply(reply);
+      return DBUS_HANDLER_RESULT_HANDLED;
+    }
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+  }
+
+  void appendProperties(DBusMessageIter *args)
+  {
+    auto title = StubPlayer::title(this->track_);
+
+    DBusMessageIter dict;
+    dbus_message_iter_open_container(args, DBUS_TYPE_ARRAY, "{sv}", &dict);
+    appendEntry(&dict, "PlaybackStatus", "Playing");
+
+    DBusMessageIter entry;
+    DBusMessageIter variant;
+    DBusMessageIter metadata;
+    const char *key = "Metadata";
+    dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY, nullptr,
+                                     &entry);
+    dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+    dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, "a{sv}",
+                                     &variant);
+    dbus_message_iter_open_container(&variant, DBUS_TYPE_ARRAY, "{sv}",
+                                     &metadata);
+    appendEntry(&metadata, "xesam:title", title.c_str());
+    dbus_message_iter_close_container(&variant, &metadata);
+    dbus_message_iter_close_container(&entry, &variant);
+    dbus_message_iter_close_container(&dict, &entry);
+
+    dbus_message_iter_close_container(args, &dict);
+  }
+
+  void emitChanged()
+  {
+    auto *signal = dbus_message_new_signal(MPRIS_PATH, PROPERTIES_INTERFACE,
+                                           "PropertiesChanged");
+    DBusMessageIter args;
+    DBusMessageIter invalidated;
+    dbus_message_iter_init_append(signal, &args);
+    dbus_message_iter_append_basic(&args, DBUS_TYPE_STRING,
+                                   &PLAYER_INTERFACE);
+    this->appendProperties(&args);
+    dbus_message_iter_open_container(&args, DBUS_TYPE_ARRAY, "s",
+                                     &invalidated);
+    dbus_message_iter_close_container(&args, &invalidated);
+    this->reply(signal);
+  }
+
+  void reply(DBusMessage *message)
+  {
+    dbus_connection_send(this->connection_, message, nullptr);
+    dbus_message_unref(message);
+  }
+
+  std::chrono::microseconds latency_;
+  DBusConnection *connection_ = nullptr;
+  std::uint64_t track_ = 0;
+  std::jthread thread_;
+};
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--skips"sv)
+  {
+    ok = parseNumber(value, config.skips) && config.skips > 0;
+  }
+  else if (key == "--latency-us"sv)
+  {
+    ok = parseDuration(value, config.latency);
+  }
+  else if (key == "--address"sv)
+  {
+    config.address = value;
+    ok = true;
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+/// Waits until `media` reports `title` - returns false after a second.
+bool waitForTitle(const MprisController &media, const std::string &title)
+{
+  auto deadline = Clock::now() + std::chrono::seconds(1);
+  while (media.state().title != title)
+  {
+    if (Clock::now() > deadline)
+    {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr, "Usage: bench_mpris [--skips n] [--latency-us n] "
+                         "[--address bus-address] [--out file.json]");
+    return 1;
+  }
+
+  try
+  {
+    StubPlayer player(config.address, config.latency);
+    MprisController media(config.address);
+    if (!waitForTitle(media, StubPlayer::title(0)))
+    {
+      std::println(stderr, "The controller didn't find the stub player");
+      return 1;
+    }
+
+    std::vector<Clock::duration> skips;
+    std::vector<Clock::duration> updates;
+    std::size_t failed = 0;
+    std::size_t stale = 0;
+    for (std::size_t i = 1; i <= config.skips; i++)
+    {
+      std::promise<SkipOutcome> done;
+      auto start = Clock::now();
+      media.skip([&](SkipOutcome outcome) { done.set_value(outcome); });
+      if (done.get_future().get() != SkipOutcome::Skipped)
+      {
+        failed++;
+        continue;
+      }
+      skips.emplace_back(Clock::now() - start);
+
+      if (waitForTitle(media, StubPlayer::title(i)))
+      {
+        updates.emplace_back(Clock::now() - start);
+      }
+      else
+      {
+        stale++;
+      }
+    }
+
+    auto json = std::format(
+        R"({{"skips":{},"failed":{},"stale_states":{},)"
+        R"("skip_us":{},"state_update_us":{}}})",
+        skips.size(), failed, stale, summarize(skips), summarize(updates));
+    std::println("{}", json);
+    if (!config.out.empty())
+    {
+      std::ofstream(config.out) << json << '\n';
+    }
+    return failed == 0 && stale == 0 ? 0 : 1;
+  }
+  catch (const std::exception &ex)
+  {
+    std::println(stderr, "{}", ex.what());
+    return 1;
+  }
+}
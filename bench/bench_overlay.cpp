@@ -0,0 +1,191 @@
+// Publishes `--updates` vote updates to `--subscribers` overlays connected
+// to `/events` and measures how long it takes until all of them got the last
+// one. The server runs on its own context, like on the IO thread in the app.
+//
+// The cost of an update must not depend on the number of overlays: it's
+// serialized once, plus once as `state` if overlays that fell behind are
+// resynchronized. The run fails if there were more serializations.
+
+#include "BenchArgs.hpp"
+#include "VoteCounter.hpp"
+#include "overlay/OverlayServer.hpp"
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace
+{
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+using bench_args::parseNumber;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::size_t subscribers = 100;
+  std::size_t updates = 10'000;
+  std::chrono::seconds timeout{60};
+  std::string out;
+};
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--subscribers"sv)
+  {
+    ok = parseNumber(value, config.subscribers) && config.subscribers > 0;
+  }
+  else if (key == "--updates"sv)
+  {
+    ok = parseNumber(value, config.updates) && config.updates > 0;
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+struct SubscriberStats
+{
+  std::atomic<std::size_t> done{0};
+  std::atomic<std::uint64_t> bytes{0};
+  /// Nanoseconds since the steady clock's epoch of the last arrival
+  std::atomic<std::int64_t> lastDone{0};
+};
+
+/// Reads `/events` until the event with the final count arrived.
+asio::awaitable<void> subscribe(std::uint16_t port, std::string marker,
+                                SubscriberStats &stats)
+{
+  tcp::socket socket(co_await asio::this_coro::executor);
+  co_await socket.async_connect({asio::ip::address_v4::loopback(), port},
+                                asio::use_awaitable);
+  co_await asio::async_write(
+      socket,
+      asio::buffer("GET /events HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"sv),
+      asio::use_awaitable);
+
+  std::array<char, 64 * 1024> buf{};
+  std::string tail;
+  for (;;)
+  {
+    auto n = co_await socket.async_read_some(asio::buffer(buf),
+                                             asio::use_awaitable);
+    stats.bytes.fetch_add(n);
+    // the marker may be split across reads
+    tail.append(buf.data(), n);
+    if (tail.contains(marker))
+    {
+      stats.lastDone.store(Clock::now().time_since_epoch().count());
+      stats.done.fetch_add(1);
+      co_return;
+    }
+    tail.erase(0, tail.size() - std::min(tail.size(), marker.size()));
+  }
+}
+
+double toMillis(Clock::duration d)
+{
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr, "Usage: bench_overlay [--subscribers n] "
+                         "[--updates n] [--out file.json]");
+    return 1;
+  }
+
+  asio::io_context serverCtx;
+  auto serverWork = asio::make_work_guard(serverCtx);
+  OverlayServer server(serverCtx.get_executor(), 0);
+  std::thread serverThread([&] { serverCtx.run(); });
+
+  asio::io_context clientCtx;
+  SubscriberStats stats;
+  auto marker = std::format(R"("count":{})", config.updates);
+  for (std::size_t i = 0; i < config.subscribers; i++)
+  {
+    asio::co_spawn(clientCtx, subscribe(server.port(), marker, stats),
+                   asio::detached);
+  }
+  std::thread clientThread([&] { clientCtx.run(); });
+
+  auto deadline = Clock::now() + config.timeout;
+  while (server.subscribers() < config.subscribers && Clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  auto start = Clock::now();
+  for (std::size_t i = 1; i <= config.updates; i++)
+  {
+    server.publish(VoteSnapshot{
+        .count = i,
+        .threshold = config.updates,
+        .enabled = true,
+    });
+  }
+  auto published = Clock::now();
+  while (stats.done.load() < config.subscribers && Clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto received = stats.done.load();
+  auto lastDone = Clock::time_point(Clock::duration(stats.lastDone.load()));
+
+  auto serializations = server.serializations();
+  // the initial `state`, then a delta and at most one `state` per update
+  bool passed = received == config.subscribers &&
+                serializations <= 2 * config.updates + 1;
+
+  auto json = std::format(
+      R"({{"subscribers":{},"updates":{},"received":{},"serializations":{},)"
+      R"("serializations_per_update":{:.3f},"bytes_per_subscriber":{},)"
+      R"("publish_ms":{:.3f},"fanout_ms":{:.3f},"passed":{}}})",
+      config.subscribers, config.updates, received, serializations,
+      static_cast<double>(serializations) /
+          static_cast<double>(config.updates),
+      stats.bytes.load() / config.subscribers, toMillis(published - start),
+      received > 0 ? toMillis(lastDone - start) : 0.0, passed);
+  std::println("{}", json);
+  if (!config.out.empty())
+  {
+    std::ofstream(config.out) << json << '\n';
+  }
+
+  clientCtx.stop();
+  clientThread.join();
+  serverWork.reset();
+  serverCtx.stop();
+  serverThread.join();
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+// Measures the persistence of the vote state:
+//
+// - How long a restart takes to restore `--voters` votes (read, decode and
+//   restore into a `VoteCounter`).
+// - How many of `--saves` saves in a burst the `PersistWriter` coalesces.
+// - How long a save takes to reach the disk when every save is flushed.
+// - Whether a reader ever sees a torn file while the saves are written. A
+//   crash mid-write would leave the same file behind.
+//
+// The run fails if a read was torn or the final file isn't the last save.
+
+#include "BenchArgs.hpp"
+#include "VoteCounter.hpp"
+#include "VoteState.hpp"
+#include "persist/AtomicFile.hpp"
+#include "persist/PersistWriter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using bench_args::parseNumber;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::size_t voters = 5000;
+  std::size_t saves = 500;
+  std::filesystem::path dir =
+      std::filesystem::temp_directory_path() / "bench_persist";
+  std::string out;
+};
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--voters"sv)
+  {
+    ok = parseNumber(value, config.voters);
+  }
+  else if (key == "--saves"sv)
+  {
+    ok = parseNumber(value, config.saves) && config.saves > 0;
+  }
+  else if (key == "--dir"sv)
+  {
+    config.dir = value;
+    ok = true;
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+VoteState makeState(std::size_t voters, std::size_t save)
+{
+  VoteState state{
+      .savedAt = std::chrono::system_clock::now(),
+      .title = std::format("Track {}", save),
+  };
+  state.voters.reserve(voters);
+  for (std::size_t i = 0; i < voters; i++)
+  {
+    state.voters.emplace_back(std::format("user{}", i));
+  }
+  return state;
+}
+
+double toMillis(Clock::duration d)
+{
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr, "Usage: bench_persist [--voters n] [--saves n] "
+                         "[--dir path] [--out file.json]");
+    return 1;
+  }
+  std::filesystem::create_directories(config.dir);
+  auto votesPath = config.dir / "votes.bin";
+  auto settingsPath = config.dir / "settings.json";
+
+  // Burst of saves while a reader checks every version it sees
+  std::atomic<bool> done{false};
+  std::atomic<std::uint64_t> reads{0};
+  std::atomic<std::uint64_t> torn{0};
+  writeFileAtomically(votesPath, encodeVoteState(makeState(0, 0)));
+  std::thread reader(
+      [&]
+      {
+        while (!done.load())
+        {
+          auto contents = readFile(votesPath);
+          if (!contents || !decodeVoteState(*contents))
+          {
+            torn.fetch_add(1);
+          }
+          reads.fetch_add(1);
+        }
+      });
+
+  // the saves are encoded up front, so only the writer is measured
+  std::vector<std::string> encoded;
+  encoded.reserve(config.saves);
+  for (std::size_t i = 0; i < config.saves; i++)
+  {
+    encoded.emplace_back(encodeVoteState(
+        makeState(config.voters * (i + 1) / config.saves, i + 1)));
+  }
+
+  PersistWriter::Stats stats;
+  Clock::duration queueTime{};
+  Clock::duration flushTime{};
+  std::vector<Clock::duration> saveTimes;
+  {
+    PersistWriter writer;
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < config.saves; i++)
+    {
+      writer.write(votesPath, encoded[i]);
+      writer.write(settingsPath, std::format(R"({{"threshold":{}}})", i));
+    }
+    queueTime = Clock::now() - start;
+    writer.flush();
+    flushTime = Clock::now() - start;
+    stats = writer.stats();
+
+    // every save reaches the disk
+    for (const auto &data : encoded)
+    {
+      auto saveStart = Clock::now();
+      writer.write(votesPath, data);
+      writer.flush();
+      saveTimes.emplace_back(Clock::now() - saveStart);
+    }
+  }
+  done.store(true);
+  reader.join();
+  std::ranges::sort(saveTimes);
+
+  // Restart: restore the last save
+  auto restoreStart = Clock::now();
+  auto contents = readFile(votesPath);
+  auto state = contents ? decodeVoteState(*contents) : std::nullopt;
+  VoteCounter counter(config.voters + 1);
+  if (state)
+  {
+    counter.restore(state->voters);
+  }
+  auto restoreTime = Clock::now() - restoreStart;
+
+  bool lastWins = contents == encoded.back();
+  bool restored = state && counter.count() == config.voters &&
+                  state->title == std::format("Track {}", config.saves);
+  bool passed = torn.load() == 0 && lastWins && restored;
+
+  auto json = std::format(
+      R"({{"voters":{},"snapshot_bytes":{},"restore_ms":{:.3f},)"
+      R"("queued":{},"written":{},"coalesced":{},"failed":{},)"
+      R"("queue_ms":{:.3f},"flush_ms":{:.3f},)"
+      R"("save_ms":{{"p50":{:.3f},"max":{:.3f}}},"reads":{},"torn_reads":{},)"
+      R"("passed":{}}})",
+      config.voters, contents ? contents->size() : 0, toMillis(restoreTime),
+      stats.queued, stats.written, stats.coalesced, stats.failed,
+      toMillis(queueTime), toMillis(flushTime),
+      toMillis(saveTimes[saveTimes.size() / 2]), toMillis(saveTimes.back()),
+      reads.load(), torn.load(), passed);
+  std::println("{}", json);
+  if (!config.out.empty())
+  {
+    std::ofstream(config.out) << json << '\n';
+  }
+
+  std::filesystem::remove(votesPath);
+  std::filesystem::remove(settingsPath);
+  return passed ? 0 : 1;
+}
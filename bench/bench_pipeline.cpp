@@ -0,0 +1,457 @@
+// Measures the path from a frame arriving on the socket to the skip being
+// dispatched: twitch-irc-sim -> WebSocketSession -> AppContext::publishVote
+// -> VoteCounter -> SkipDispatcher -> FakeMediaController.
+//
+// The main thread stands in for the UI thread - votes are handed over in
+// batches through a `VoteBatch` just like `TwitchPanel` does.
+//
+// The heap allocations of all threads and of the IO thread alone (the
+// simulator runs in-process) are reported too, as is the peak RSS.
+//
+// The time from starting the client to the WebSocket handshake and to the
+// first PRIVMSG is reported as well (see `Startup`), as is the time it takes
+// to stop the client afterwards.
+//
+// `--deflate` sets the `permessage-deflate` options (see
+// `Compression::parse`). Compare the bytes on the wire and the CPU time of
+// the IO thread with `--deflate off` to see what inflating costs.
+//
+// `--user-rate` limits the messages per user (see `UserRateLimiter`). Let a
+// few users spam with `--spammers` and `--spam-ratio` to see what's shed.
+
+#include "AppContext.hpp"
+#include "BenchArgs.hpp"
+#include "LatencyStats.hpp"
+#include "IrcSimulator.hpp"
+#include "MemoryStats.hpp"
+#include "VoteBatch.hpp"
+#include "VoteCounter.hpp"
+#include "irc/Compression.hpp"
+#include "irc/IrcClient.hpp"
+#include "log/Log.hpp"
+#include "log/LogSinks.hpp"
+#include "media/FakeMediaController.hpp"
+#include "media/SkipDispatcher.hpp"
+#include "trace/Startup.hpp"
+#include "trace/Trace.hpp"
+
+#include <boost/asio/post.hpp>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <print>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using bench_args::parseNumber;
+using latency_stats::percentile;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::uint64_t messages = 1'000'000;
+  double rate = 0;
+  std::size_t threshold = 50;
+  std::size_t batch = 32;
+  double fragmentRatio = 0.05;
+  double voteRatio = 0.1;
+  std::size_t users = 100'000;
+  std::size_t spammers = 0;
+  double spamRatio = 0.0;
+  std::optional<UserRateLimiter::Config> userRateLimit;
+  Compression compression{.enabled = false};
+  std::chrono::seconds timeout{120};
+  std::string out;
+  std::string record;
+  std::string metrics;
+  std::string trace;
+  std::string log;
+};
+
+/// CPU time of a thread, readable from any other thread.
+class ThreadCpuClock
+{
+public:
+  /// The clock of the calling thread
+  static ThreadCpuClock current()
+  {
+    ThreadCpuClock clock;
+#ifdef _WIN32
+    DuplicateHandle(GetCurrentProcess(), GetCurrentThread(),
+                    GetCurrentProcess(), &clock.thread_, 0, FALSE,
+                    DUPLICATE_SAME_ACCESS);
+#else
+    pthread_getcpuclockid(pthread_self(), &clock.clock_);
+#endif
+    return clock;
+  }
+
+  double seconds() const
+  {
+#ifdef _WIN32
+    FILETIME creation;
+    FILETIME exit;
+    FILETIME kernel;
+    FILETIME user;
+    if (!GetThreadTimes(this->thread_, &creation, &exit, &kernel, &user))
+    {
+      return 0;
+    }
+    auto ticks = [](FILETIME t)
+    {
+      return (static_cast<std::uint64_t>(t.dwHighDateTime) << 32) |
+             t.dwLowDateTime;
+    };
+    return static_cast<double>(ticks(kernel) + ticks(user)) / 1e7;
+#else
+    timespec ts{};
+    clock_gettime(this->clock_, &ts);
+    return static_cast<double>(ts.tv_sec) +
+           static_cast<double>(ts.tv_nsec) / 1e9;
+#endif
+  }
+
+private:
+#ifdef _WIN32
+  HANDLE thread_ = nullptr;
+#else
+  clockid_t clock_{};
+#endif
+};
+
+/// Stands in for `CallAfter` - wakes the main thread.
+class Wakeup
+{
+public:
+  void notify()
+  {
+    {
+      std::lock_guard lock(this->mtx_);
+      this->pending_ = true;
+    }
+    this->condvar_.notify_one();
+  }
+
+  void wait(Clock::duration wait)
+  {
+    std::unique_lock lock(this->mtx_);
+    this->condvar_.wait_for(lock, wait, [this] { return this->pending_; });
+    this->pending_ = false;
+  }
+
+private:
+  std::mutex mtx_;
+  std::condition_variable condvar_;
+  bool pending_ = false;
+};
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--messages"sv)
+  {
+    ok = parseNumber(value, config.messages) && config.messages > 0;
+  }
+  else if (key == "--rate"sv)
+  {
+    ok = parseNumber(value, config.rate);
+  }
+  else if (key == "--threshold"sv)
+  {
+    ok = parseNumber(value, config.threshold) && config.threshold > 0;
+  }
+  else if (key == "--batch"sv)
+  {
+    ok = parseNumber(value, config.batch) && config.batch > 0;
+  }
+  else if (key == "--fragment"sv)
+  {
+    ok = parseNumber(value, config.fragmentRatio);
+  }
+  else if (key == "--vote-ratio"sv)
+  {
+    ok = parseNumber(value, config.voteRatio);
+  }
+  else if (key == "--users"sv)
+  {
+    ok = parseNumber(value, config.users) && config.users > 0;
+  }
+  else if (key == "--spammers"sv)
+  {
+    ok = parseNumber(value, config.spammers);
+  }
+  else if (key == "--spam-ratio"sv)
+  {
+    ok = parseNumber(value, config.spamRatio);
+  }
+  else if (key == "--user-rate"sv)
+  {
+    config.userRateLimit = UserRateLimiter::Config::parse(value);
+    ok = config.userRateLimit.has_value();
+  }
+  else if (key == "--deflate"sv)
+  {
+    auto compression = Compression::parse(value);
+    ok = compression.has_value();
+    if (ok)
+    {
+      config.compression = *compression;
+    }
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  else if (key == "--record"sv)
+  {
+    config.record = value;
+    ok = true;
+  }
+  else if (key == "--metrics"sv)
+  {
+    config.metrics = value;
+    ok = true;
+  }
+  else if (key == "--trace"sv)
+  {
+    config.trace = value;
+    ok = true;
+  }
+  else if (key == "--log"sv)
+  {
+    config.log = value;
+    ok = true;
+  }
+  return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr,
+                 "Usage: bench_pipeline [--messages n] [--rate msgs/s] "
+                 "[--threshold n] [--batch n] [--fragment ratio] "
+                 "[--vote-ratio ratio] [--users n] [--spammers n] "
+                 "[--spam-ratio ratio] [--user-rate spec] [--deflate spec] "
+                 "[--out file.json] "
+                 "[--record file] [--metrics file.prom] "
+                 "[--trace trace.json] [--log log.jsonl]");
+    return 1;
+  }
+
+  if (!config.log.empty())
+  {
+    Log::addSink(std::make_unique<JsonLinesSink>(config.log));
+    Log::start();
+  }
+  if (!config.trace.empty())
+  {
+    Tracer::start(config.trace);
+    Tracer::setThreadName("UI");
+  }
+
+  boost::asio::io_context simCtx;
+  IrcSimulator sim(simCtx,
+                   SimConfig{
+                       .address = "127.0.0.1",
+                       .port = 0,
+                       .rate = config.rate,
+                       .batch = config.batch,
+                       .fragmentRatio = config.fragmentRatio,
+                       .voteRatio = config.voteRatio,
+                       .subRatio = 0.3,
+                       .users = config.users,
+                       .spammers = config.spammers,
+                       .spamRatio = config.spamRatio,
+                       .command = "-voteskip",
+                       .deflate = config.compression.enabled,
+                       .totalMessages = config.messages,
+                   });
+  sim.start();
+  std::thread simThread([&] { simCtx.run(); });
+
+  Wakeup wakeup;
+  VoteBatch batch([&] { wakeup.notify(); });
+  Endpoint endpoint{
+      .host = "127.0.0.1",
+      .port = std::to_string(sim.port()),
+      .path = "/",
+      .secure = false,
+  };
+  Startup::begin();
+  IrcClient client;
+  auto app = client.app();
+  app->setCompression(config.compression, false);
+  app->setRules(
+      Rules{
+          .command = "-voteskip",
+          .channel = "bench",
+          .allowSubs = true,
+          .allowNonSubs = true,
+          .threshold = config.threshold,
+      },
+      false);
+  app->setHandler(&batch);
+
+  // runs on the IO thread before the client starts connecting
+  std::promise<ThreadCpuClock> ioCpuPromise;
+  boost::asio::post(client.executor(),
+                    [&]
+                    {
+                      memory_stats::trackThisThread();
+                      ioCpuPromise.set_value(ThreadCpuClock::current());
+                    });
+  client.start(endpoint, {
+                             .recordPath = config.record,
+                             .userRateLimit = config.userRateLimit,
+                         });
+
+  auto ioCpu = ioCpuPromise.get_future().get();
+  auto &metrics = app->metrics();
+  VoteCounter counter(config.threshold);
+  // no cooldown - every vote that reaches the threshold is dispatched unless
+  // a skip is still in flight
+  SkipDispatcher skips(
+      std::make_shared<FakeMediaController>(FakeMediaController::Options{}),
+      std::shared_ptr<Metrics>(app, &metrics), {});
+  std::vector<Clock::duration> latencies;
+  std::vector<Vote> votes;
+  std::uint64_t received = 0;
+  Clock::time_point firstVote;
+  Clock::time_point lastVote;
+  auto deadline = Clock::now() + config.timeout;
+
+  const auto &stats = sim.stats();
+  // votes from rate limited users never arrive
+  auto expectedVotes = [&]
+  {
+    return stats.votes.load() -
+           metrics.value(Metrics::Counter::RateLimitedVotes);
+  };
+  while (stats.messages.load() < config.messages || received < expectedVotes())
+  {
+    if (Clock::now() > deadline)
+    {
+      std::println(stderr, "Timed out after receiving {} votes", received);
+      break;
+    }
+
+    wakeup.wait(std::chrono::milliseconds(100));
+    batch.take(votes);
+    for (const auto &vote : votes)
+    {
+      if (received++ == 0)
+      {
+        firstVote = vote.receivedAt;
+      }
+      lastVote = vote.receivedAt;
+      metrics.record(Metrics::Stage::UiApply, Clock::now() - vote.publishedAt);
+      switch (counter.vote(vote.user))
+      {
+      case VoteCounter::Result::Duplicate:
+        metrics.add(Metrics::Counter::Duplicates);
+        break;
+      case VoteCounter::Result::ThresholdReached:
+      {
+        TraceSpan span("skip", "ui");
+        if (skips.request() == SkipDispatcher::Result::Dispatched)
+        {
+          latencies.emplace_back(Clock::now() - vote.receivedAt);
+          metrics.record(Metrics::Stage::VoteToSkip, latencies.back());
+        }
+        break;
+      }
+      default:
+        break;
+      }
+    }
+    votes.clear();
+  }
+
+  std::ranges::sort(latencies);
+  auto seconds = std::chrono::duration<double>(lastVote - firstVote).count();
+  auto messages = stats.messages.load();
+  auto allocations = memory_stats::allocations.load();
+  auto ioAllocations = memory_stats::trackedAllocations.load();
+  auto ioCpuSeconds = ioCpu.seconds();
+
+  auto stopStart = Clock::now();
+  client.stop();
+  auto shutdownMs =
+      std::chrono::duration<double, std::milli>(Clock::now() - stopStart)
+          .count();
+  auto sinceStart = [](Startup::Milestone milestone)
+  {
+    auto elapsed = Startup::elapsed(milestone);
+    return elapsed ? std::chrono::duration<double, std::milli>(*elapsed).count()
+                   : 0.0;
+  };
+
+  auto json = std::format(
+      R"({{"messages":{},"bytes":{},"frames":{},"votes":{},"skips":{},)"
+      R"("coalesced_skips":{},"seconds":{:.3f},"messages_per_second":{:.0f},)"
+      R"("vote_to_skip_us":{{"p50":{:.1f},"p99":{:.1f},"p999":{:.1f},)"
+      R"("max":{:.1f}}},"allocations":{},"io_allocations":{},)"
+      R"("io_allocations_per_message":{:.3f},"arena_overflows":{},)"
+      R"("peak_rss_kb":{},"wire_bytes":{},"io_cpu_seconds":{:.3f},)"
+      R"("connected_ms":{:.1f},"first_message_ms":{:.1f},)"
+      R"("shutdown_ms":{:.1f},"rate_limited":{},"rate_limited_votes":{},)"
+      R"("rate_limiter_evictions":{}}})",
+      messages, stats.bytes.load(), stats.frames.load(), received,
+      latencies.size(), metrics.value(Metrics::Counter::SkipsCoalesced),
+      seconds, seconds > 0 ? static_cast<double>(messages) / seconds : 0.0,
+      percentile(latencies, 0.5), percentile(latencies, 0.99),
+      percentile(latencies, 0.999),
+      percentile(latencies, 1.0), allocations,
+      ioAllocations,
+      static_cast<double>(ioAllocations) / static_cast<double>(messages),
+      metrics.value(Metrics::Counter::ArenaOverflows),
+      memory_stats::peakRssKb(), metrics.value(Metrics::Counter::WireBytes),
+      ioCpuSeconds, sinceStart(Startup::Milestone::Connected),
+      sinceStart(Startup::Milestone::FirstMessage), shutdownMs,
+      metrics.value(Metrics::Counter::RateLimited),
+      metrics.value(Metrics::Counter::RateLimitedVotes),
+      metrics.value(Metrics::Counter::RateLimiterEvictions));
+
+  std::println("{}", json);
+  if (!config.out.empty())
+  {
+    std::ofstream(config.out) << json << '\n';
+  }
+  if (!config.metrics.empty())
+  {
+    std::ofstream(config.metrics) << metrics.renderPrometheus();
+  }
+
+  simCtx.stop();
+  simThread.join();
+  Tracer::stop();
+  Log::stop();
+
+  return received == expectedVotes() ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+// Replays a recording (see `ChatRecorder`) through `MessageHandler`,
+// `VoteEngine` and `VoteCounter` as fast as possible - no network and no
+// thread hops.
+
+#include "AppContext.hpp"
+#include "BenchArgs.hpp"
+#include "CountingSink.hpp"
+#include "chat/VoteEngine.hpp"
+#include "irc/ChatRecording.hpp"
+#include "irc/MessageHandler.hpp"
+
+#include <boost/asio/io_context.hpp>
+
+#include <format>
+#include <fstream>
+#include <print>
+#include <span>
+#include <string_view>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using bench_args::parseNumber;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::string recording;
+  std::string command = "-voteskip";
+  std::size_t threshold = 50;
+  std::size_t loops = 1;
+  std::string out;
+};
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--threshold"sv)
+  {
+    ok = parseNumber(value, config.threshold) && config.threshold > 0;
+  }
+  else if (key == "--loops"sv)
+  {
+    ok = parseNumber(value, config.loops) && config.loops > 0;
+  }
+  else if (key == "--command"sv)
+  {
+    config.command = value;
+    ok = true;
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  std::span<char *> args{argv, static_cast<std::size_t>(argc)};
+  if (args.size() < 2 || !bench_args::parseArgs(args, config, parseOption, 2))
+  {
+    std::println(stderr, "Usage: bench_replay <recording> [--threshold n] "
+                         "[--loops n] [--command text] [--out file.json]");
+    return 1;
+  }
+  config.recording = args[1];
+
+  try
+  {
+    boost::asio::io_context ctx;
+    CountingSink sink(config.threshold);
+    auto app = std::make_shared<AppContext>(ctx.get_executor(), &sink);
+    VoteEngine engine(app, Rules{
+                            .command = config.command,
+                            .channel = {},
+                            .allowSubs = true,
+                            .allowNonSubs = true,
+                            .threshold = config.threshold,
+                        });
+    MessageHandler handler(engine, engine.addSource());
+    ChatReplay replay(config.recording);
+
+    std::uint64_t frames = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t messages = 0;
+    auto start = Clock::now();
+    for (std::size_t loop = 0; loop < config.loops; loop++)
+    {
+      replay.rewind();
+      while (auto frame = replay.next())
+      {
+        frames++;
+        bytes += frame->data.size();
+        messages += replay.feed(*frame, handler, Clock::now()).messages;
+      }
+    }
+    auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    auto json = std::format(
+        R"({{"frames":{},"bytes":{},"messages":{},"votes":{},"skips":{},)"
+        R"("seconds":{:.3f},"messages_per_second":{:.0f},)"
+        R"("megabytes_per_second":{:.1f}}})",
+        frames, bytes, messages, sink.votes(), sink.skips(), seconds,
+        static_cast<double>(messages) / seconds,
+        static_cast<double>(bytes) / seconds / (1024.0 * 1024.0));
+    std::println("{}", json);
+    if (!config.out.empty())
+    {
+      std::ofstream(config.out) << json << '\n';
+    }
+  }
+  catch (const std::exception &ex)
+  {
+    std::println(stderr, "Failed to replay: {}", ex.what());
+    return 1;
+  }
+  return 0;
+}
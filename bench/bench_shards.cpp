@@ -0,0 +1,273 @@
+// Votes from 1 to `--max-threads` threads at once and compares a
+// `ShardedVoteCounter` with a single `VoteCounter` behind a mutex (`single`).
+//
+// Every thread votes for its own slice of `--votes` names drawn from
+// `--users` users, so users vote more than once and from different threads.
+// Only the time spent voting is measured - the names are created before the
+// threads start.
+//
+// The bench fails if the sharded counter lost or double-counted a vote: every
+// epoch has to end with exactly one `ThresholdReached`, the counted votes
+// have to add up to the epochs and the current count, and with a threshold
+// that's never reached, every user has to be counted exactly once. Whether
+// the counter scales depends on the cores of the machine, so the speedup is
+// only reported.
+
+#include "BenchArgs.hpp"
+#include "ShardedVoteCounter.hpp"
+#include "UserName.hpp"
+#include "VoteCounter.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <latch>
+#include <limits>
+#include <mutex>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using bench_args::parseNumber;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::size_t votes = 2'000'000;
+  std::size_t users = 500'000;
+  std::size_t threshold = 1000;
+  std::size_t maxThreads = 16;
+  /// 0 = one per hardware thread
+  std::size_t shards = 0;
+  std::string out;
+};
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--votes"sv)
+  {
+    ok = parseNumber(value, config.votes) && config.votes > 0;
+  }
+  else if (key == "--users"sv)
+  {
+    ok = parseNumber(value, config.users) && config.users > 0;
+  }
+  else if (key == "--threshold"sv)
+  {
+    ok = parseNumber(value, config.threshold) && config.threshold > 0;
+  }
+  else if (key == "--max-threads"sv)
+  {
+    ok = parseNumber(value, config.maxThreads) && config.maxThreads > 0;
+  }
+  else if (key == "--shards"sv)
+  {
+    ok = parseNumber(value, config.shards);
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+/// The user of vote `seq`
+std::size_t userOf(std::size_t seq, std::size_t users)
+{
+  return static_cast<std::size_t>((seq * 2654435761U) % users);
+}
+
+/// The names each of `threads` threads votes for
+std::vector<std::vector<UserName>> slices(const BenchConfig &config,
+                                          std::size_t threads)
+{
+  std::vector<std::vector<UserName>> slices(threads);
+  auto perThread = config.votes / threads;
+  for (std::size_t t = 0; t < threads; t++)
+  {
+    slices[t].reserve(perThread);
+    for (std::size_t i = 0; i < perThread; i++)
+    {
+      auto user = userOf((t * perThread) + i, config.users);
+      slices[t].emplace_back(std::format("u{}", user));
+    }
+  }
+  return slices;
+}
+
+struct Tally
+{
+  std::uint64_t duplicates = 0;
+  std::uint64_t counted = 0;
+  std::uint64_t reached = 0;
+
+  void add(VoteCounter::Result result)
+  {
+    switch (result)
+    {
+    case VoteCounter::Result::Duplicate:
+      this->duplicates++;
+      break;
+    case VoteCounter::Result::Counted:
+      this->counted++;
+      break;
+    case VoteCounter::Result::ThresholdReached:
+      this->reached++;
+      break;
+    default:
+      break;
+    }
+  }
+};
+
+/// Runs `vote(name)` for every slice on its own thread - returns the
+/// seconds it took and the combined results.
+template <typename Vote>
+std::pair<double, Tally> run(const std::vector<std::vector<UserName>> &slices,
+                             Vote vote)
+{
+  std::vector<Tally> tallies(slices.size());
+  std::latch ready(static_cast<std::ptrdiff_t>(slices.size() + 1));
+  std::vector<std::jthread> threads;
+  for (std::size_t t = 0; t < slices.size(); t++)
+  {
+    threads.emplace_back(
+        [&, t]
+        {
+          Tally tally;
+          ready.arrive_and_wait();
+          for (const auto &name : slices[t])
+          {
+            tally.add(vote(name.view()));
+          }
+          tallies[t] = tally;
+        });
+  }
+  ready.arrive_and_wait();
+  auto start = Clock::now();
+  threads.clear(); // joins
+  auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  Tally total;
+  for (const auto &tally : tallies)
+  {
+    total.duplicates += tally.duplicates;
+    total.counted += tally.counted;
+    total.reached += tally.reached;
+  }
+  return {seconds, total};
+}
+
+/// Counts all users once without crossing the threshold
+bool uniqueCheck(const BenchConfig &config, std::size_t threads)
+{
+  auto names = slices(config, threads);
+  std::vector<bool> seen(config.users);
+  std::uint64_t distinct = 0;
+  for (const auto &slice : names)
+  {
+    for (const auto &name : slice)
+    {
+      std::size_t user = 0;
+      parseNumber(name.view().substr(1), user);
+      distinct += seen[user] ? 0 : 1;
+      seen[user] = true;
+    }
+  }
+
+  ShardedVoteCounter counter(std::numeric_limits<std::uint32_t>::max(),
+                             config.shards);
+  auto [seconds, tally] =
+      run(names, [&](std::string_view user) { return counter.vote(user); });
+  return tally.counted == distinct && tally.reached == 0 &&
+         counter.count() == distinct;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr, "Usage: bench_shards [--votes n] [--users n] "
+                         "[--threshold n] [--max-threads n] [--shards n] "
+                         "[--out file.json]");
+    return 1;
+  }
+
+  bool passed = uniqueCheck(config, config.maxThreads);
+  double singleBase = 0;
+  double shardedBase = 0;
+  std::string runs;
+  for (std::size_t threads = 1; threads <= config.maxThreads; threads *= 2)
+  {
+    auto names = slices(config, threads);
+    auto votes = static_cast<double>(names.size() * names[0].size());
+
+    VoteCounter single(config.threshold);
+    std::mutex singleMutex;
+    auto [singleSeconds, singleTally] =
+        run(names,
+            [&](std::string_view user)
+            {
+              std::lock_guard lock(singleMutex);
+              return single.vote(user);
+            });
+
+    ShardedVoteCounter sharded(config.threshold, config.shards);
+    auto [shardedSeconds, shardedTally] =
+        run(names, [&](std::string_view user) { return sharded.vote(user); });
+
+    // every epoch ended with exactly one `ThresholdReached`
+    bool exact =
+        shardedTally.reached == sharded.epoch() &&
+        shardedTally.counted + shardedTally.reached ==
+            (sharded.epoch() * config.threshold) + sharded.count() &&
+        shardedTally.duplicates + shardedTally.counted +
+                shardedTally.reached ==
+            static_cast<std::uint64_t>(votes);
+    passed = passed && exact;
+
+    auto singleRate = votes / singleSeconds;
+    auto shardedRate = votes / shardedSeconds;
+    if (threads == 1)
+    {
+      singleBase = singleRate;
+      shardedBase = shardedRate;
+    }
+    std::format_to(
+        std::back_inserter(runs),
+        R"({}{{"threads":{},"single_votes_per_second":{:.0f},)"
+        R"("sharded_votes_per_second":{:.0f},"single_speedup":{:.2f},)"
+        R"("sharded_speedup":{:.2f},"skips":{},"exact":{}}})",
+        runs.empty() ? "" : ",", threads, singleRate, shardedRate,
+        singleRate / singleBase, shardedRate / shardedBase,
+        shardedTally.reached, exact);
+  }
+
+  auto json = std::format(
+      R"({{"votes":{},"users":{},"threshold":{},"shards":{},)"
+      R"("hardware_threads":{},"runs":[{}],"passed":{}}})",
+      config.votes, config.users, config.threshold,
+      ShardedVoteCounter(1, config.shards).shards(),
+      std::thread::hardware_concurrency(), runs, passed);
+  std::println("{}", json);
+  if (!config.out.empty())
+  {
+    std::ofstream(config.out) << json << '\n';
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+// Measures how long `IrcClient::stop()` takes with the connection in
+// different states, and fails if a single stop takes longer than
+// `--limit-ms`:
+//
+// - `handshake`: the server accepted the TCP connection but never answers
+//   the WebSocket handshake.
+// - `idle`: connected to twitch-irc-sim, which sends a message per second.
+// - `flood`: connected to twitch-irc-sim, which sends as fast as it can.
+// - `silent-close`: connected to a server that never answers the close, so
+//   the client has to give up after `IrcClient::STOP_CLOSE_TIMEOUT`.
+// - `backoff`: the connection was refused and the client waits to reconnect.
+// - `replay`: a recording of `--replay-frames` frames is replayed as fast as
+//   possible. The client is stopped `REPLAY_SETTLE` after starting, in the
+//   middle of the replay.
+
+#include "AppContext.hpp"
+#include "BenchArgs.hpp"
+#include "IrcSimulator.hpp"
+#include "irc/ChatRecording.hpp"
+#include "irc/IrcClient.hpp"
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+namespace asio = boost::asio;
+namespace websocket = boost::beast::websocket;
+using asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+using bench_args::parseDuration;
+using bench_args::parseNumber;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::size_t rounds = 5;
+  /// Time for the client to get into the state before it's stopped
+  std::chrono::milliseconds settle{300};
+  std::chrono::milliseconds limit{100};
+  std::size_t replayFrames = 30'000;
+  std::string out;
+};
+
+constexpr std::size_t MESSAGES_PER_FRAME = 32;
+constexpr auto REPLAY_SETTLE = std::chrono::milliseconds(20);
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--rounds"sv)
+  {
+    ok = parseNumber(value, config.rounds) && config.rounds > 0;
+  }
+  else if (key == "--settle-ms"sv)
+  {
+    ok = parseDuration(value, config.settle);
+  }
+  else if (key == "--limit-ms"sv)
+  {
+    ok = parseDuration(value, config.limit);
+  }
+  else if (key == "--replay-frames"sv)
+  {
+    ok = parseNumber(value, config.replayFrames);
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+/// Accepts connections and keeps them open without ever reading from them.
+/// With `handshake` set, it completes the WebSocket handshake first.
+class SilentServer
+{
+public:
+  SilentServer(asio::io_context &ctx, bool handshake)
+      : acceptor_(ctx, {asio::ip::make_address("127.0.0.1"), 0}),
+        handshake_(handshake)
+  {
+    asio::co_spawn(ctx, this->listen(), asio::detached);
+  }
+
+  std::uint16_t port() const
+  {
+    return this->acceptor_.local_endpoint().port();
+  }
+
+private:
+  asio::awaitable<void> listen()
+  {
+    for (;;)
+    {
+      auto socket =
+          co_await this->acceptor_.async_accept(asio::use_awaitable);
+      if (!this->handshake_)
+      {
+        this->sockets_.emplace_back(std::move(socket));
+        continue;
+      }
+      auto ws =
+          std::make_unique<websocket::stream<tcp::socket>>(std::move(socket));
+      co_await ws->async_accept(asio::use_awaitable);
+      this->streams_.emplace_back(std::move(ws));
+    }
+  }
+
+  tcp::acceptor acceptor_;
+  bool handshake_;
+  std::vector<tcp::socket> sockets_;
+  std::vector<std::unique_ptr<websocket::stream<tcp::socket>>> streams_;
+};
+
+/// A port nothing listens on
+std::uint16_t refusingPort(asio::io_context &ctx)
+{
+  tcp::acceptor acceptor(ctx, {asio::ip::make_address("127.0.0.1"), 0});
+  return acceptor.local_endpoint().port();
+}
+
+/// Writes `frames` frames of votes to a temporary recording.
+std::filesystem::path writeRecording(std::size_t frames)
+{
+  auto path = std::filesystem::temp_directory_path() / "bench_shutdown.rec";
+  std::string frame;
+  for (std::size_t i = 0; i < MESSAGES_PER_FRAME; i++)
+  {
+    std::format_to(std::back_inserter(frame),
+                   ":u{0}!u{0}@u{0}.tmi.twitch.tv PRIVMSG #bench "
+                   ":-voteskip\r\n",
+                   i);
+  }
+
+  ChatRecorder recorder(path);
+  auto now = Clock::now();
+  for (std::size_t i = 0; i < frames; i++)
+  {
+    recorder.append(frame, now);
+  }
+  return path;
+}
+
+Clock::duration stopAfter(std::uint16_t port, const IrcClientOptions &options,
+                          std::chrono::milliseconds settle)
+{
+  IrcClient client;
+  client.app()->setRules(
+      Rules{
+          .command = "-voteskip",
+          .channel = "bench",
+          .allowSubs = true,
+          .allowNonSubs = true,
+          .threshold = 50,
+      },
+      false);
+  client.start(
+      Endpoint{
+          .host = "127.0.0.1",
+          .port = std::to_string(port),
+          .path = "/",
+          .secure = false,
+      },
+      options);
+  std::this_thread::sleep_for(settle);
+
+  auto start = Clock::now();
+  client.stop();
+  return Clock::now() - start;
+}
+
+double toMillis(Clock::duration d)
+{
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr, "Usage: bench_shutdown [--rounds n] [--settle-ms ms] "
+                         "[--limit-ms ms] [--replay-frames n] "
+                         "[--out file.json]");
+    return 1;
+  }
+
+  asio::io_context serverCtx;
+  auto simConfig = [](double rate)
+  {
+    return SimConfig{
+        .address = "127.0.0.1",
+        .port = 0,
+        .rate = rate,
+        .command = "-voteskip",
+    };
+  };
+  IrcSimulator idleSim(serverCtx, simConfig(1.0));
+  IrcSimulator floodSim(serverCtx, simConfig(0.0));
+  idleSim.start();
+  floodSim.start();
+  SilentServer handshakeServer(serverCtx, false);
+  SilentServer closeServer(serverCtx, true);
+
+  auto work = asio::make_work_guard(serverCtx);
+  std::thread serverThread([&] { serverCtx.run(); });
+
+  auto recording = writeRecording(config.replayFrames);
+  struct State
+  {
+    std::string_view name;
+    std::uint16_t port;
+    std::chrono::milliseconds settle;
+    IrcClientOptions options;
+  };
+  const std::vector<State> states{
+      {"handshake", handshakeServer.port(), config.settle, {}},
+      {"idle", idleSim.port(), config.settle, {}},
+      {"flood", floodSim.port(), config.settle, {}},
+      {"silent-close", closeServer.port(), config.settle, {}},
+      {"backoff", refusingPort(serverCtx), config.settle, {}},
+      {
+          "replay",
+          refusingPort(serverCtx),
+          REPLAY_SETTLE,
+          {.replayPath = recording, .replayRealTime = false},
+      },
+  };
+
+  bool passed = true;
+  std::string json = "{";
+  for (const auto &[name, port, settle, options] : states)
+  {
+    std::vector<Clock::duration> stops;
+    for (std::size_t i = 0; i < config.rounds; i++)
+    {
+      stops.emplace_back(stopAfter(port, options, settle));
+    }
+    std::ranges::sort(stops);
+    auto slowest = stops.back();
+    passed = passed && slowest <= config.limit;
+
+    std::format_to(std::back_inserter(json),
+                   R"("{}":{{"p50_ms":{:.2f},"max_ms":{:.2f}}},)", name,
+                   toMillis(stops[stops.size() / 2]), toMillis(slowest));
+  }
+  std::format_to(std::back_inserter(json), R"("limit_ms":{},"passed":{}}})",
+                 config.limit.count(), passed);
+
+  std::println("{}", json);
+  if (!config.out.empty())
+  {
+    std::ofstream(config.out) << json << '\n';
+  }
+
+  std::filesystem::remove(recording);
+  work.reset();
+  serverCtx.stop();
+  serverThread.join();
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+// Measures how long a skip takes with and without a warm session cache.
+//
+// `cold` looks up the session, playback info, media properties and timeline
+// before every skip (like the old `GsmtcWorker::skipSong`), `warm` only
+// seeks and skips. The latencies of the fake controller are injected, so the
+// numbers show the cost of the lookups, not of any real media app.
+//
+// `dispatcher` fires a burst of skip requests through a `SkipDispatcher` and
+// reports how many of them were coalesced.
+
+#include "BenchArgs.hpp"
+#include "LatencyStats.hpp"
+#include "media/FakeMediaController.hpp"
+#include "media/SkipDispatcher.hpp"
+#include "metrics/Metrics.hpp"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <future>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using bench_args::parseDuration;
+using bench_args::parseNumber;
+using latency_stats::summarize;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::size_t skips = 200;
+  std::chrono::microseconds query{2000};
+  std::chrono::microseconds seek{1000};
+  std::chrono::microseconds skip{1000};
+  std::size_t requests = 200;
+  std::chrono::microseconds interval{500};
+  std::chrono::microseconds cooldown{20'000};
+  std::string out;
+};
+
+struct Latencies
+{
+  /// Until `skip()` returned
+  std::vector<Clock::duration> dispatch;
+  /// Until the skip finished
+  std::vector<Clock::duration> complete;
+};
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--skips"sv)
+  {
+    ok = parseNumber(value, config.skips) && config.skips > 0;
+  }
+  else if (key == "--query-us"sv)
+  {
+    ok = parseDuration(value, config.query);
+  }
+  else if (key == "--seek-us"sv)
+  {
+    ok = parseDuration(value, config.seek);
+  }
+  else if (key == "--skip-us"sv)
+  {
+    ok = parseDuration(value, config.skip);
+  }
+  else if (key == "--requests"sv)
+  {
+    ok = parseNumber(value, config.requests) && config.requests > 0;
+  }
+  else if (key == "--interval-us"sv)
+  {
+    ok = parseDuration(value, config.interval);
+  }
+  else if (key == "--cooldown-us"sv)
+  {
+    ok = parseDuration(value, config.cooldown);
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+Latencies measure(const BenchConfig &config, bool cached)
+{
+  FakeMediaController media({
+      .query = config.query,
+      .seek = config.seek,
+      .skip = config.skip,
+      .cached = cached,
+  });
+
+  Latencies latencies;
+  for (std::size_t i = 0; i < config.skips; i++)
+  {
+    std::promise<Clock::time_point> done;
+    auto start = Clock::now();
+    media.skip([&](SkipOutcome /*outcome*/) { done.set_value(Clock::now()); });
+    latencies.dispatch.emplace_back(Clock::now() - start);
+    latencies.complete.emplace_back(done.get_future().get() - start);
+  }
+  return latencies;
+}
+
+std::string measureDispatcher(const BenchConfig &config)
+{
+  auto media =
+      std::make_shared<FakeMediaController>(FakeMediaController::Options{
+          .query = config.query,
+          .seek = config.seek,
+          .skip = config.skip,
+          .cached = true,
+      });
+  auto metrics = std::make_shared<Metrics>();
+  SkipDispatcher skips(media, metrics, config.cooldown);
+
+  for (std::size_t i = 0; i < config.requests; i++)
+  {
+    skips.request();
+    std::this_thread::sleep_for(config.interval);
+  }
+  while (skips.inFlight())
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  auto latency = metrics->histogram(Metrics::Stage::Skip).snapshot();
+  return std::format(
+      R"({{"requests":{},"dispatched":{},"coalesced":{},"skipped":{},)"
+      R"("skip_us":{{"p50":{:.1f},"p99":{:.1f}}}}})",
+      config.requests, metrics->value(Metrics::Counter::Skips),
+      metrics->value(Metrics::Counter::SkipsCoalesced),
+      metrics->value(Metrics::Counter::SkipsSucceeded),
+      static_cast<double>(latency.quantile(0.5)) / 1e3,
+      static_cast<double>(latency.quantile(0.99)) / 1e3);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr,
+                 "Usage: bench_skip [--skips n] [--query-us n] [--seek-us n] "
+                 "[--skip-us n] [--requests n] [--interval-us n] "
+                 "[--cooldown-us n] [--out file.json]");
+    return 1;
+  }
+
+  auto cold = measure(config, false);
+  auto warm = measure(config, true);
+  auto dispatcher = measureDispatcher(config);
+
+  auto json = std::format(
+      R"({{"skips":{},)"
+      R"("cold":{{"dispatch_us":{},"complete_us":{}}},)"
+      R"("warm":{{"dispatch_us":{},"complete_us":{}}},)"
+      R"("dispatcher":{}}})",
+      config.skips, summarize(cold.dispatch), summarize(cold.complete),
+      summarize(warm.dispatch), summarize(warm.complete), dispatcher);
+  std::println("{}", json);
+  if (!config.out.empty())
+  {
+    std::ofstream(config.out) << json << '\n';
+  }
+  return 0;
+}
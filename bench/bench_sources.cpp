@@ -0,0 +1,222 @@
+// Feeds two stand-in chat sources into one `VoteEngine` as fast as possible.
+//
+// Every message is a vote from a unique user. `--overlap` of the messages are
+// delivered by both sources (like a channel joined on two connections) and
+// must only be counted once. The sources yield after every batch, so their
+// batches interleave - the votes of each source must still arrive in the
+// order it sent them. The bench fails if a vote got lost, was counted twice
+// or arrived out of order.
+
+#include "AppContext.hpp"
+#include "BenchArgs.hpp"
+#include "Rules.hpp"
+#include "VoteSink.hpp"
+#include "chat/ChatSource.hpp"
+#include "chat/VoteEngine.hpp"
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <print>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+namespace asio = boost::asio;
+using Clock = std::chrono::steady_clock;
+using bench_args::parseNumber;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::uint64_t messages = 1'000'000;
+  std::size_t batch = 64;
+  double overlap = 0.2;
+  std::string out;
+};
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--messages"sv)
+  {
+    ok = parseNumber(value, config.messages) && config.messages > 0;
+  }
+  else if (key == "--batch"sv)
+  {
+    ok = parseNumber(value, config.batch) && config.batch > 0;
+  }
+  else if (key == "--overlap"sv)
+  {
+    ok = parseNumber(value, config.overlap) && config.overlap >= 0 &&
+         config.overlap <= 1;
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+/// Whether both sources deliver message `seq` - the same for both of them
+bool isShared(std::uint64_t seq, double overlap)
+{
+  return static_cast<double>((seq * 2654435761U) % 1000) < overlap * 1000.0;
+}
+
+/// Sends `messages` votes - the user (and ID) is `<prefix><seq>`, or
+/// `s<seq>` for the shared ones.
+class StandInSource : public ChatSource
+{
+public:
+  StandInSource(char prefix, const BenchConfig &config)
+      : prefix_(prefix),
+        config_(config),
+        names_(config.batch),
+        batch_(config.batch)
+  {
+  }
+
+  asio::awaitable<void> run(VoteEngine &engine, std::size_t source) override
+  {
+    auto executor = co_await asio::this_coro::executor;
+    std::uint64_t seq = 0;
+    while (seq < this->config_.messages && !this->stopping_)
+    {
+      std::size_t n = 0;
+      for (; n < this->config_.batch && seq < this->config_.messages;
+           n++, seq++)
+      {
+        auto &name = this->names_[n];
+        auto prefix =
+            isShared(seq, this->config_.overlap) ? 's' : this->prefix_;
+        auto end =
+            std::format_to_n(name.data(), name.size(), "{}{}", prefix, seq)
+                .out;
+        std::string_view user(name.data(), end);
+        this->batch_[n] = ChatMessage{
+            .user = user,
+            .content = "-voteskip"sv,
+            .id = user,
+            .isSub = seq % 2 == 0,
+        };
+      }
+      engine.deliver(source, std::span(this->batch_).first(n), Clock::now());
+      // let the other source deliver its batch
+      co_await asio::post(executor, asio::use_awaitable);
+    }
+  }
+
+  void stop() override { this->stopping_ = true; }
+
+private:
+  char prefix_;
+  const BenchConfig &config_;
+  std::vector<std::array<char, 24>> names_;
+  std::vector<ChatMessage> batch_;
+  bool stopping_ = false;
+};
+
+/// Checks that the votes with the same prefix arrive in order.
+class OrderingSink : public VoteSink
+{
+public:
+  void publishVote(Vote vote) override
+  {
+    auto user = vote.user.view();
+    std::uint64_t seq = 0;
+    parseNumber(user.substr(1), seq);
+    auto &next = this->next_[static_cast<unsigned char>(user[0])];
+    if (seq < next)
+    {
+      this->reordered++; // or counted twice
+    }
+    next = seq + 1;
+    this->votes++;
+  }
+
+  std::uint64_t votes = 0;
+  std::uint64_t reordered = 0;
+
+private:
+  /// The lowest sequence that's still in order, by prefix
+  std::array<std::uint64_t, 256> next_{};
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr, "Usage: bench_sources [--messages n] [--batch n] "
+                         "[--overlap 0..1] [--out file.json]");
+    return 1;
+  }
+
+  asio::io_context ctx;
+  OrderingSink sink;
+  auto app = std::make_shared<AppContext>(ctx.get_executor(), &sink);
+  VoteEngine engine(app, Rules{
+                             .command = "-voteskip",
+                             .channel = "bench",
+                             .allowSubs = true,
+                             .allowNonSubs = true,
+                             .threshold = 1,
+                         });
+
+  StandInSource first('a', config);
+  StandInSource second('b', config);
+  auto firstId = engine.addSource();
+  auto secondId = engine.addSource();
+  asio::co_spawn(ctx, first.run(engine, firstId), asio::detached);
+  asio::co_spawn(ctx, second.run(engine, secondId), asio::detached);
+
+  auto start = Clock::now();
+  ctx.run();
+  auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::uint64_t shared = 0;
+  for (std::uint64_t seq = 0; seq < config.messages; seq++)
+  {
+    shared += isShared(seq, config.overlap) ? 1 : 0;
+  }
+  auto expectedVotes = 2 * config.messages - shared;
+  auto duplicates =
+      app->metrics().value(Metrics::Counter::DuplicateMessages);
+  bool passed = sink.votes == expectedVotes && duplicates == shared &&
+                sink.reordered == 0;
+
+  auto json = std::format(
+      R"({{"messages":{},"batch":{},"shared":{},"votes":{},)"
+      R"("expected_votes":{},"duplicates":{},"reordered":{},)"
+      R"("delivered":[{},{}],"seconds":{:.3f},"messages_per_second":{:.0f},)"
+      R"("passed":{}}})",
+      2 * config.messages, config.batch, shared, sink.votes, expectedVotes,
+      duplicates, sink.reordered, engine.delivered(firstId),
+      engine.delivered(secondId), seconds,
+      static_cast<double>(2 * config.messages) / seconds, passed);
+  std::println("{}", json);
+  if (!config.out.empty())
+  {
+    std::ofstream(config.out) << json << '\n';
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,307 @@
+// Runs a day of a stream on a `VirtualClock`: chat traffic with votes,
+// tracks that end on their own (starting a new vote epoch), connection drops
+// that go through the `Reconnector` of `IrcClient` and bursts of settings
+// edits that go through the same `Debouncer` and `Throttle` as `TwitchPanel`.
+//
+// Everything is driven by a seeded RNG, so the same seed always produces the
+// same output - in a fraction of the wall-clock time.
+//
+// The defaults let some tracks be skipped and others end on their own. The
+// run fails if no votes expired or every track was skipped, since then the
+// track ends weren't exercised.
+
+#include "BenchArgs.hpp"
+#include "VoteCounter.hpp"
+#include "irc/Reconnector.hpp"
+#include "time/Clock.hpp"
+#include "time/Debouncer.hpp"
+#include "time/VirtualClock.hpp"
+
+#include <format>
+#include <fstream>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+using namespace std::chrono_literals;
+using bench_args::parseDuration;
+using bench_args::parseNumber;
+using namespace std::string_view_literals;
+
+struct BenchConfig
+{
+  std::chrono::hours duration{24};
+  double rate = 5.0;
+  double voteRatio = 0.05;
+  std::size_t users = 5000;
+  std::size_t threshold = 50;
+  std::uint32_t seed = 42;
+  std::string out;
+};
+
+struct DayStats
+{
+  std::uint64_t messages = 0;
+  std::uint64_t votes = 0;
+  std::uint64_t skips = 0;
+  std::uint64_t tracks = 0;
+  /// Votes that were dropped because their track ended on its own
+  std::uint64_t expiredVotes = 0;
+  std::uint64_t disconnects = 0;
+  std::uint64_t reconnectAttempts = 0;
+  Clock::Duration downtime{};
+  std::uint64_t keystrokes = 0;
+  std::uint64_t ruleUpdates = 0;
+  std::uint64_t saves = 0;
+};
+
+class VirtualDay
+{
+public:
+  VirtualDay(const BenchConfig &config)
+      : config_(config),
+        rng_(config.seed),
+        counter_(config.threshold),
+        reconnector_(this->clock_, Backoff(1s, 2min, config.seed),
+                     [this] { this->reconnect(); }),
+        trackEnd_(this->clock_, [this] { this->startTrack(); }),
+        commandDebouncer_(this->clock_, 1s, [this] { this->emitRules(); }),
+        settingsSave_(this->clock_, 1s, [this] { this->stats_.saves++; })
+  {
+  }
+
+  void run()
+  {
+    this->startTrack();
+    this->scheduleMessage();
+    this->scheduleDisconnect();
+    this->scheduleEditBurst();
+    this->clock_.advance(this->config_.duration);
+  }
+
+  const DayStats &stats() const { return this->stats_; }
+
+private:
+  template <typename Rep, typename Period>
+  Clock::Duration exponential(std::chrono::duration<Rep, Period> mean)
+  {
+    std::exponential_distribution<double> dist(
+        1.0 / std::chrono::duration<double>(mean).count());
+    return std::chrono::duration_cast<Clock::Duration>(
+        std::chrono::duration<double>(dist(this->rng_)));
+  }
+
+  void scheduleMessage()
+  {
+    this->clock_.schedule(this->exponential(std::chrono::duration<double>(
+                              1.0 / this->config_.rate)),
+                          [this]
+                          {
+                            if (this->connected_)
+                            {
+                              this->onMessage();
+                            }
+                            this->scheduleMessage();
+                          });
+  }
+
+  void onMessage()
+  {
+    this->stats_.messages++;
+    if (!std::bernoulli_distribution(this->config_.voteRatio)(this->rng_))
+    {
+      return;
+    }
+
+    this->stats_.votes++;
+    auto user = std::uniform_int_distribution<std::size_t>(
+        0, this->config_.users - 1)(this->rng_);
+    auto name = std::format("user{}", user);
+    if (this->counter_.vote(name, this->clock_.now()) ==
+        VoteCounter::Result::ThresholdReached)
+    {
+      this->stats_.skips++;
+      this->startTrack();
+    }
+  }
+
+  /// Songs are 2.5 to 4.5 minutes long.
+  void startTrack()
+  {
+    this->stats_.tracks++;
+    this->stats_.expiredVotes += this->counter_.count();
+    this->counter_.startEpoch(this->clock_.now());
+
+    auto length = std::uniform_int_distribution<int>(150, 270)(this->rng_);
+    this->trackEnd_.start(std::chrono::seconds(length));
+  }
+
+  void scheduleDisconnect()
+  {
+    this->clock_.schedule(this->exponential(90min),
+                          [this]
+                          {
+                            if (this->connected_)
+                            {
+                              this->disconnect();
+                            }
+                            this->scheduleDisconnect();
+                          });
+  }
+
+  void disconnect()
+  {
+    this->stats_.disconnects++;
+    this->connected_ = false;
+    this->disconnectedAt_ = this->clock_.now();
+    this->outageUntil_ = this->disconnectedAt_ + this->exponential(30s);
+    this->reconnector_.disconnected();
+  }
+
+  void reconnect()
+  {
+    this->stats_.reconnectAttempts++;
+    this->reconnector_.connecting();
+    if (this->clock_.now() < this->outageUntil_)
+    {
+      this->reconnector_.disconnected();
+      return;
+    }
+    this->connected_ = true;
+    this->stats_.downtime += this->clock_.now() - this->disconnectedAt_;
+  }
+
+  void scheduleEditBurst()
+  {
+    this->clock_.schedule(this->exponential(30min),
+                          [this]
+                          {
+                            auto keys = std::uniform_int_distribution<int>(
+                                3, 15)(this->rng_);
+                            this->scheduleKeystroke(keys);
+                            this->scheduleEditBurst();
+                          });
+  }
+
+  void scheduleKeystroke(int remaining)
+  {
+    if (remaining <= 0)
+    {
+      return;
+    }
+    this->clock_.schedule(
+        std::chrono::milliseconds(
+            std::uniform_int_distribution<int>(80, 400)(this->rng_)),
+        [this, remaining]
+        {
+          this->stats_.keystrokes++;
+          this->commandDebouncer_.trigger();
+          this->scheduleKeystroke(remaining - 1);
+        });
+  }
+
+  void emitRules()
+  {
+    this->stats_.ruleUpdates++;
+    this->settingsSave_.trigger();
+  }
+
+  const BenchConfig &config_;
+  std::mt19937 rng_;
+  VirtualClock clock_;
+  DayStats stats_;
+
+  VoteCounter counter_;
+  Reconnector reconnector_;
+  bool connected_ = true;
+  Clock::TimePoint disconnectedAt_;
+  Clock::TimePoint outageUntil_;
+
+  Timer trackEnd_;
+  Debouncer commandDebouncer_;
+  Throttle settingsSave_;
+};
+
+bool parseOption(std::string_view key, std::string_view value,
+                 BenchConfig &config)
+{
+  bool ok = false;
+  if (key == "--hours"sv)
+  {
+    ok = parseDuration(value, config.duration) && config.duration.count() > 0;
+  }
+  else if (key == "--rate"sv)
+  {
+    ok = parseNumber(value, config.rate) && config.rate > 0;
+  }
+  else if (key == "--vote-ratio"sv)
+  {
+    ok = parseNumber(value, config.voteRatio);
+  }
+  else if (key == "--users"sv)
+  {
+    ok = parseNumber(value, config.users) && config.users > 0;
+  }
+  else if (key == "--threshold"sv)
+  {
+    ok = parseNumber(value, config.threshold) && config.threshold > 0;
+  }
+  else if (key == "--seed"sv)
+  {
+    ok = parseNumber(value, config.seed);
+  }
+  else if (key == "--out"sv)
+  {
+    config.out = value;
+    ok = true;
+  }
+  return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  BenchConfig config;
+  if (!bench_args::parseArgs({argv, static_cast<std::size_t>(argc)}, config,
+                              parseOption))
+  {
+    std::println(stderr,
+                 "Usage: bench_virtual_day [--hours n] [--rate msgs/s] "
+                 "[--vote-ratio ratio] [--users n] [--threshold n] "
+                 "[--seed n] [--out file.json]");
+    return 1;
+  }
+
+  VirtualDay day(config);
+  auto start = std::chrono::steady_clock::now();
+  day.run();
+  auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count();
+
+  const auto &stats = day.stats();
+  auto passed = stats.expiredVotes > 0 && stats.tracks != stats.skips;
+  auto simulated = std::chrono::duration<double>(config.duration).count();
+  auto json = std::format(
+      R"({{"simulated_seconds":{:.0f},"wall_seconds":{:.3f},"speedup":{:.0f},)"
+      R"("messages":{},"votes":{},"skips":{},"tracks":{},)"
+      R"("expired_votes":{},"disconnects":{},)"
+      R"("reconnect_attempts":{},"downtime_seconds":{:.1f},)"
+      R"("keystrokes":{},"rule_updates":{},"saves":{},"passed":{}}})",
+      simulated, wall, simulated / wall, stats.messages, stats.votes,
+      stats.skips, stats.tracks, stats.expiredVotes, stats.disconnects,
+      stats.reconnectAttempts,
+      std::chrono::duration<double>(stats.downtime).count(), stats.keystrokes,
+      stats.ruleUpdates, stats.saves, passed);
+  std::println("{}", json);
+  if (!config.out.empty())
+  {
+    std::ofstream(config.out) << json << '\n';
+  }
+  return passed ? 0 : 1;
+}
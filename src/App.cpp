@@ -4,11 +4,19 @@
 #include "Settings.hpp"
 #include "TwitchPanel.hpp"
 #include "gsmtc/GsmtcWorker.hpp"
+#include "irc/Compression.hpp"
+#include "irc/Endpoint.hpp"
 #include "irc/IrcClient.hpp"
+#include "log/Log.hpp"
+#include "log/LogSinks.hpp"
+#include "log/WxLogSink.hpp"
+#include "trace/Startup.hpp"
+#include "trace/Trace.hpp"
 
 #include <winrt/Windows.Foundation.h>
 #include <winrt/Windows.Storage.h>
 
+#include <wx/arrstr.h>
 #include <wx/button.h>
 #include <wx/checkbox.h>
 #include <wx/frame.h>
@@ -20,11 +28,11 @@
 #include <wx/statbox.h>
 #include <wx/stattext.h>
 #include <wx/textctrl.h>
+#include <wx/utils.h>
 
-#include <condition_variable>
-#include <mutex>
+#include <chrono>
+#include <optional>
 #include <print>
-#include <thread>
 #include <utility>
 
 wxIMPLEMENT_APP(App);
@@ -32,37 +40,269 @@ wxIMPLEMENT_APP(App);
 class RootFrame : public wxFrame
 {
 public:
-  RootFrame(AppContextPtr app, winrt::com_ptr<GsmtcWorker> gsmtc,
+  RootFrame(Clock &clock, AppContextPtr app,
+            std::shared_ptr<MediaController> media,
             winrt::com_ptr<AppSettings> settings);
+
+  TwitchPanel *twitchPanel() const { return this->twitchPanel_; }
+
+private:
+  TwitchPanel *twitchPanel_ = nullptr;
 };
 
-void App::initContext(Rules initialRules)
+namespace
+{
+
+/// The IRC endpoint can be overridden with `SKIP_MY_SONG_IRC_URL` (e.g. to
+/// point the app at `twitch-irc-sim`).
+Endpoint ircEndpoint()
+{
+  wxString url;
+  if (!wxGetEnv("SKIP_MY_SONG_IRC_URL", &url))
+  {
+    return Endpoint::twitch();
+  }
+
+  auto endpoint = Endpoint::parse(url.ToStdString());
+  if (!endpoint)
+  {
+    std::println(stderr, "Invalid IRC URL '{}' - using Twitch",
+                 url.ToStdString());
+    return Endpoint::twitch();
+  }
+  std::println(stderr, "Using IRC endpoint {}", url.ToStdString());
+  return *endpoint;
+}
+
+/// `SKIP_MY_SONG_RECORD` records all received frames to a file,
+/// `SKIP_MY_SONG_REPLAY` replays such a recording instead of connecting.
+/// Set `SKIP_MY_SONG_REPLAY_SPEED=max` to replay as fast as possible.
+/// `SKIP_MY_SONG_USER_RATE` limits the messages per user (see
+/// `UserRateLimiter::Config::parse`), e.g. `rate=1,burst=5`.
+/// `SKIP_MY_SONG_EXTRA_CHANNELS` is a comma-separated list of channels whose
+/// votes count as well. `SKIP_MY_SONG_PING_INTERVAL` sets how often (in ms)
+/// the health of a connection is checked.
+IrcClientOptions ircOptions()
 {
-  std::condition_variable condvar;
-  std::mutex mtx;
-  std::thread(
-      [&]
+  IrcClientOptions options;
+  wxString value;
+  if (wxGetEnv("SKIP_MY_SONG_RECORD", &value))
+  {
+    options.recordPath = value.ToStdWstring();
+  }
+  if (wxGetEnv("SKIP_MY_SONG_REPLAY", &value))
+  {
+    options.replayPath = value.ToStdWstring();
+  }
+  if (wxGetEnv("SKIP_MY_SONG_REPLAY_SPEED", &value))
+  {
+    options.replayRealTime = value != "max";
+  }
+  if (wxGetEnv("SKIP_MY_SONG_USER_RATE", &value))
+  {
+    options.userRateLimit =
+        UserRateLimiter::Config::parse(value.ToStdString());
+    if (!options.userRateLimit)
+    {
+      std::println(stderr, "Invalid user rate limit '{}'",
+                   value.ToStdString());
+    }
+  }
+  if (wxGetEnv("SKIP_MY_SONG_EXTRA_CHANNELS", &value))
+  {
+    for (const auto &channel : wxSplit(value, ','))
+    {
+      auto trimmed = channel.Strip(wxString::both).Lower();
+      if (!trimmed.empty())
       {
-        IrcClient client;
-        client.run(
-            [&](auto init)
+        options.extraChannels.emplace_back(trimmed.ToStdString());
+      }
+    }
+  }
+  if (wxGetEnv("SKIP_MY_SONG_PING_INTERVAL", &value))
+  {
+    unsigned long ms = 0;
+    if (value.ToULong(&ms) && ms > 0)
+    {
+      options.health.pingInterval = std::chrono::milliseconds(ms);
+    }
+    else
+    {
+      std::println(stderr, "Invalid ping interval '{}'", value.ToStdString());
+    }
+  }
+  return options;
+}
+
+/// `SKIP_MY_SONG_DEFLATE` sets the `permessage-deflate` options of the chat
+/// connection (see `Compression::parse`), e.g. `off` or `window=12`.
+Compression ircCompression()
+{
+  wxString value;
+  if (!wxGetEnv("SKIP_MY_SONG_DEFLATE", &value))
+  {
+    return {};
+  }
+  auto compression = Compression::parse(value.ToStdString());
+  if (!compression)
+  {
+    std::println(stderr, "Invalid deflate options '{}'", value.ToStdString());
+    return {};
+  }
+  return *compression;
+}
+
+/// Logs go to the log view. `SKIP_MY_SONG_LOG_JSON=log.jsonl` additionally
+/// writes them as JSON lines.
+void startLogging()
+{
+  Log::addSink(std::make_unique<WxLogSink>());
+
+  wxString path;
+  if (wxGetEnv("SKIP_MY_SONG_LOG_JSON", &path))
+  {
+    try
+    {
+      Log::addSink(std::make_unique<JsonLinesSink>(path.ToStdWstring()));
+    }
+    catch (const std::exception &ex)
+    {
+      std::println(stderr, "{}", ex.what());
+    }
+  }
+
+  Log::start();
+  Log::setThreadName("UI");
+}
+
+/// Until the manager is there, skips report that no app is playing.
+winrt::fire_and_forget initMedia(std::shared_ptr<GsmtcWorker> gsmtc)
+{
+  co_await gsmtc->init();
+  Startup::reach(Startup::Milestone::Media);
+}
+
+/// `SKIP_MY_SONG_TRACE=trace.json` records a Chrome trace until the app exits.
+void startTracing()
+{
+  wxString path;
+  if (!wxGetEnv("SKIP_MY_SONG_TRACE", &path))
+  {
+    return;
+  }
+  if (Tracer::start(path.ToStdWstring()))
+  {
+    Tracer::setThreadName("UI");
+    std::println(stderr, "Tracing to {}", path.ToStdString());
+  }
+}
+
+} // namespace
+
+void App::initContext()
+{
+  this->irc_ = std::make_unique<IrcClient>();
+  this->app_ = this->irc_->app();
+  this->app_->setCompression(ircCompression(), false);
+  this->irc_->start(ircEndpoint(), ircOptions());
+}
+
+void App::stopIrc()
+{
+  auto start = std::chrono::steady_clock::now();
+  this->irc_->stop();
+  Log::info("Stopped the IO thread in {}ms",
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+}
+
+void App::loadSettings()
+{
+  this->settings_->readBackground(
+      [this](Rules rules, std::optional<VoteState> votes)
+      {
+        this->CallAfter(
+            [this, rules = std::move(rules), votes = std::move(votes)]
             {
+              Startup::reach(Startup::Milestone::Settings);
+              this->settingsLoaded_ = true;
+              if (!this->panel_)
+              {
+                this->app_->setRules(rules);
+                return;
+              }
+              this->panel_->loadRules(rules);
+              if (votes)
               {
-                std::lock_guard<std::mutex> lk(mtx);
-                this->app_ = std::move(init);
-                this->app_->setRules(initialRules, false);
+                this->panel_->restoreVotes(*votes);
               }
-              condvar.notify_all();
             });
-      })
-      .detach(); // TODO: don't
+      });
+}
 
-  std::unique_lock<std::mutex> lk(mtx);
-  condvar.wait(lk, [&] { return this->app_ != nullptr; });
+/// `SKIP_MY_SONG_METRICS_PORT` serves the metrics on
+/// `http://127.0.0.1:<port>/metrics`.
+void App::initMetrics()
+{
+  wxString value;
+  unsigned long port = 0;
+  if (!wxGetEnv("SKIP_MY_SONG_METRICS_PORT", &value))
+  {
+    return;
+  }
+  if (!value.ToULong(&port) || port > 0xffff)
+  {
+    std::println(stderr, "Invalid metrics port '{}'", value.ToStdString());
+    return;
+  }
+
+  try
+  {
+    this->metricsServer_ = std::make_unique<MetricsServer>(
+        std::shared_ptr<const Metrics>(this->app_, &this->app_->metrics()),
+        static_cast<std::uint16_t>(port));
+    std::println(stderr, "Serving metrics on http://127.0.0.1:{}/metrics",
+                 this->metricsServer_->port());
+  }
+  catch (const std::exception &ex)
+  {
+    std::println(stderr, "Failed to start the metrics server: {}", ex.what());
+  }
+}
+
+/// `SKIP_MY_SONG_OVERLAY_PORT` serves the stream overlay on
+/// `http://127.0.0.1:<port>/`.
+void App::initOverlay()
+{
+  wxString value;
+  unsigned long port = 0;
+  if (!wxGetEnv("SKIP_MY_SONG_OVERLAY_PORT", &value))
+  {
+    return;
+  }
+  if (!value.ToULong(&port) || port > 0xffff)
+  {
+    std::println(stderr, "Invalid overlay port '{}'", value.ToStdString());
+    return;
+  }
+
+  try
+  {
+    this->overlay_ = std::make_unique<OverlayServer>(
+        this->irc_->executor(), static_cast<std::uint16_t>(port));
+    std::println(stderr, "Serving the overlay on http://127.0.0.1:{}/",
+                 this->overlay_->port());
+  }
+  catch (const std::exception &ex)
+  {
+    std::println(stderr, "Failed to start the overlay server: {}", ex.what());
+  }
 }
 
 bool App::OnInit()
 {
+  Startup::begin();
   if (!wxApp::OnInit())
   {
     return false;
@@ -71,28 +311,66 @@ bool App::OnInit()
   winrt::init_apartment();
 
   wxLog::EnableLogging();
+  startLogging();
+  startTracing();
 
-  auto gsmtc = winrt::make_self<GsmtcWorker>();
-  gsmtc->init().get();
-  this->settings_ = winrt::make_self<AppSettings>();
+  // Nothing below waits for anything else: the media manager is requested
+  // and the settings are read on the thread pool, the IO thread sets up TLS
+  // and resolves the endpoint, and the window is shown in the meantime.
+  auto gsmtc = std::make_shared<GsmtcWorker>();
+  initMedia(gsmtc);
+  this->writer_ = std::make_shared<PersistWriter>();
+  this->settings_ = winrt::make_self<AppSettings>(this->writer_);
+  this->initContext();
+  this->loadSettings();
+  this->initMetrics();
+  this->initOverlay();
 
-  this->initContext(this->settings_->read());
+  this->clock_ = std::make_unique<WxClock>();
 
   // Create the main window
-  auto *frame = new RootFrame(this->app_, std::move(gsmtc), this->settings_);
+  auto *frame = new RootFrame(*this->clock_, this->app_, std::move(gsmtc),
+                              this->settings_);
+  this->panel_ = frame->twitchPanel();
+  this->panel_->setOverlay(this->overlay_.get());
+  // The panel receives the votes, so the IO thread has to stop before the
+  // window is destroyed.
+  frame->Bind(wxEVT_CLOSE_WINDOW,
+              [this](wxCloseEvent &evt)
+              {
+                this->stopIrc();
+                evt.Skip();
+              });
 
   frame->Show();
+  Startup::reach(Startup::Milestone::Window);
 
   return true;
 }
 
 int App::OnExit()
 {
-  this->settings_->writeNow(this->app_->readRules());
+  // don't overwrite the settings with empty rules
+  if (this->settingsLoaded_)
+  {
+    this->settings_->save(this->app_->readRules());
+  }
+  // the panel saved its votes when it was destroyed
+  this->writer_->flush();
+  this->metricsServer_.reset();
+  // the IO thread was stopped when the window closed
+  this->overlay_.reset();
+  // the context uses the client's io_context (this also stops the client if
+  // the window didn't)
+  this->app_.reset();
+  this->irc_.reset();
+  Tracer::stop();
+  Log::stop();
   return wxApp::OnExit();
 }
 
-RootFrame::RootFrame(AppContextPtr app, winrt::com_ptr<GsmtcWorker> gsmtc,
+RootFrame::RootFrame(Clock &clock, AppContextPtr app,
+                     std::shared_ptr<MediaController> media,
                      winrt::com_ptr<AppSettings> settings)
     : wxFrame(nullptr, wxID_ANY, "SkipMySong")
 {
@@ -102,9 +380,9 @@ RootFrame::RootFrame(AppContextPtr app, winrt::com_ptr<GsmtcWorker> gsmtc,
       new wxNotebook(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize);
   book->Hide();
 
-  auto *page = new TwitchPanel(book, std::move(app), std::move(gsmtc),
-                               std::move(settings));
-  book->AddPage(page, "Twitch", false);
+  this->twitchPanel_ = new TwitchPanel(book, clock, std::move(app),
+                                       std::move(media), std::move(settings));
+  book->AddPage(this->twitchPanel_, "Twitch", false);
 
   book->SetSelection(0);
 
@@ -2,8 +2,15 @@
 
 #include "AppContext.hpp"
 #include "Settings.hpp"
+#include "TwitchPanel.hpp"
+#include "irc/IrcClient.hpp"
+#include "metrics/MetricsServer.hpp"
+#include "overlay/OverlayServer.hpp"
+#include "persist/PersistWriter.hpp"
+#include "time/WxClock.hpp"
 
 #include <wx/app.h>
+#include <wx/weakref.h>
 
 class App : public wxApp
 {
@@ -12,10 +19,24 @@ public:
   int OnExit() override;
 
 private:
-  void initContext(Rules initialRules);
+  void initContext();
+  void initMetrics();
+  void initOverlay();
+  void loadSettings();
+  void stopIrc();
 
+  std::unique_ptr<IrcClient> irc_;
   AppContextPtr app_;
+  /// Writes the settings and the votes
+  std::shared_ptr<PersistWriter> writer_;
   winrt::com_ptr<AppSettings> settings_;
+  bool settingsLoaded_ = false;
+  std::unique_ptr<WxClock> clock_;
+  std::unique_ptr<MetricsServer> metricsServer_;
+  /// Runs on the IO thread
+  std::unique_ptr<OverlayServer> overlay_;
+  /// Gets the settings once they're loaded
+  wxWeakRef<TwitchPanel> panel_;
 };
 
 wxDECLARE_APP(App);
@@ -1,12 +1,14 @@
 #pragma once
 
 #include "Rules.hpp"
-#include "VoteEvent.hpp"
-
-#include <wx/event.h>
+#include "VoteSink.hpp"
+#include "irc/Compression.hpp"
+#include "metrics/Metrics.hpp"
 
 #include <boost/asio/experimental/concurrent_channel.hpp>
 
+#include <atomic>
+#include <cassert>
 #include <memory>
 #include <mutex>
 
@@ -19,8 +21,9 @@ struct AppContext
       boost::system::error_code, Ping)>;
 
   template <typename T>
-  AppContext(const T &executionContext, wxEvtHandler *voteHandler)
+  AppContext(const T &executionContext, VoteSink *voteHandler)
       : rulesChanged_(executionContext, 1),
+        compressionChanged_(executionContext, 1),
         voteHandler_(voteHandler)
   {
   }
@@ -50,17 +53,40 @@ struct AppContext
     }
   }
 
-  void publishVote(std::string user)
+  PingChannel &compressionChanged() { return this->compressionChanged_; }
+
+  Compression readCompression()
+  {
+    std::lock_guard lock(this->compressionMtx_);
+    return this->compression_;
+  }
+  /// The current connection is reopened with the new settings if `emit` is
+  /// set.
+  void setCompression(Compression compression, bool emit = true)
+  {
+    {
+      std::lock_guard lock(this->compressionMtx_);
+      this->compression_ = compression;
+    }
+    if (emit)
+    {
+      this->compressionChanged_.try_send(boost::system::error_code{}, Ping{});
+    }
+  }
+
+  void publishVote(Vote vote)
   {
     auto *handler = this->voteHandler_.load();
     if (handler == nullptr)
     {
       return;
     }
-    handler->QueueEvent(new VoteEvent(std::move(user)));
+    handler->publishVote(std::move(vote));
   }
 
-  void setHandler(wxEvtHandler *voteHandler)
+  Metrics &metrics() { return this->metrics_; }
+
+  void setHandler(VoteSink *voteHandler)
   {
     assert(this->voteHandler_.load() == nullptr);
     this->voteHandler_.store(voteHandler);
@@ -68,10 +94,16 @@ struct AppContext
 
 private:
   PingChannel rulesChanged_;
-  Rules rules_;
+  /// Empty until the settings are loaded - no channel is joined before that
+  Rules rules_{};
   std::mutex rulesMtx_;
 
-  std::atomic<wxEvtHandler *> voteHandler_;
+  PingChannel compressionChanged_;
+  Compression compression_;
+  std::mutex compressionMtx_;
+
+  std::atomic<VoteSink *> voteHandler_;
+  Metrics metrics_;
 };
 
 using AppContextPtr = std::shared_ptr<AppContext>;
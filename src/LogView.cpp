@@ -0,0 +1,198 @@
+#include "LogView.hpp"
+
+#include <wx/choice.h>
+#include <wx/datetime.h>
+#include <wx/listctrl.h>
+#include <wx/log.h>
+#include <wx/sizer.h>
+#include <wx/textctrl.h>
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+
+constexpr std::array LEVELS = {
+    LogLevel::Debug,
+    LogLevel::Info,
+    LogLevel::Warning,
+    LogLevel::Error,
+};
+
+LogLevel fromWxLevel(wxLogLevel level)
+{
+  if (level <= wxLOG_Error)
+  {
+    return LogLevel::Error;
+  }
+  if (level == wxLOG_Warning)
+  {
+    return LogLevel::Warning;
+  }
+  if (level <= wxLOG_Info)
+  {
+    return LogLevel::Info;
+  }
+  return LogLevel::Debug;
+}
+
+/// Forwards everything logged through wxLog to a `LogView`. wx buffers
+/// messages from other threads and logs them on the UI thread.
+class LogViewTarget : public wxLog
+{
+public:
+  LogViewTarget(LogView *view) : view_(view) {}
+
+protected:
+  void DoLogRecord(wxLogLevel level, const wxString &msg,
+                   const wxLogRecordInfo &info) override
+  {
+    auto time = std::chrono::system_clock::time_point(
+        std::chrono::milliseconds(info.timestampMS));
+    this->view_->append(time, fromWxLevel(level), msg.utf8_string());
+  }
+
+private:
+  LogView *view_;
+};
+
+} // namespace
+
+class LogList : public wxListCtrl
+{
+public:
+  LogList(wxWindow *parent, const LogHistory &history)
+      : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize,
+                   wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL),
+        history_(history)
+  {
+    this->AppendColumn("Time", wxLIST_FORMAT_LEFT, 70);
+    this->AppendColumn("Level", wxLIST_FORMAT_LEFT, 60);
+    this->AppendColumn("Message", wxLIST_FORMAT_LEFT, 400);
+
+    this->warningAttr_.SetTextColour(wxColour(0xC0, 0x70, 0x00));
+    this->errorAttr_.SetTextColour(*wxRED);
+  }
+
+  /// Updates the list after the history changed.
+  void sync(bool shifted)
+  {
+    auto oldCount = this->GetItemCount();
+    // only follow new messages if the user didn't scroll up
+    bool atEnd =
+        oldCount == 0 ||
+        this->GetTopItem() + this->GetCountPerPage() >= oldCount;
+
+    auto count = static_cast<long>(this->history_.size());
+    this->SetItemCount(count);
+    if (shifted)
+    {
+      this->Refresh();
+    }
+    else if (count > 0)
+    {
+      this->RefreshItem(count - 1);
+    }
+
+    if (atEnd && count > 0)
+    {
+      this->EnsureVisible(count - 1);
+    }
+  }
+
+protected:
+  wxString OnGetItemText(long item, long column) const override
+  {
+    const auto &entry = this->history_.at(static_cast<std::size_t>(item));
+    switch (column)
+    {
+    case 0:
+      return wxDateTime(std::chrono::system_clock::to_time_t(entry.time))
+          .FormatISOTime();
+    case 1:
+      return wxString::FromUTF8(logLevelName(entry.level).data(),
+                                logLevelName(entry.level).size());
+    default:
+      return wxString::FromUTF8(entry.message);
+    }
+  }
+
+  wxItemAttr *OnGetItemAttr(long item) const override
+  {
+    switch (this->history_.at(static_cast<std::size_t>(item)).level)
+    {
+    case LogLevel::Warning:
+      return &this->warningAttr_;
+    case LogLevel::Error:
+      return &this->errorAttr_;
+    default:
+      return nullptr;
+    }
+  }
+
+private:
+  const LogHistory &history_;
+
+  mutable wxItemAttr warningAttr_;
+  mutable wxItemAttr errorAttr_;
+};
+
+LogView::LogView(wxWindow *parent)
+    : wxPanel(parent),
+      history_(CAPACITY)
+{
+  auto *sizer = new wxBoxSizer(wxVERTICAL);
+
+  auto *filterSizer = new wxBoxSizer(wxHORIZONTAL);
+  this->levelChoice_ = new wxChoice(this, wxID_ANY);
+  this->levelChoice_->Append("All");
+  this->levelChoice_->Append("Info");
+  this->levelChoice_->Append("Warnings");
+  this->levelChoice_->Append("Errors");
+  this->levelChoice_->SetSelection(1);
+  filterSizer->Add(this->levelChoice_, 0, wxRIGHT, 5);
+
+  this->filterCtrl_ = new wxTextCtrl(this, wxID_ANY);
+  this->filterCtrl_->SetHint("Filter");
+  filterSizer->Add(this->filterCtrl_, 1);
+  sizer->Add(filterSizer, 0, wxEXPAND | wxBOTTOM, 5);
+
+  this->list_ = new LogList(this, this->history_);
+  sizer->Add(this->list_, 1, wxEXPAND);
+  this->SetSizer(sizer);
+
+  this->levelChoice_->Bind(wxEVT_CHOICE,
+                           [this](auto &) { this->applyFilter(); });
+  this->filterCtrl_->Bind(wxEVT_TEXT,
+                          [this](auto &) { this->applyFilter(); });
+  this->applyFilter();
+
+  this->previousTarget_ = wxLog::SetActiveTarget(new LogViewTarget(this));
+}
+
+LogView::~LogView()
+{
+  delete wxLog::SetActiveTarget(this->previousTarget_);
+}
+
+void LogView::append(std::chrono::system_clock::time_point time,
+                     LogLevel level, std::string_view message)
+{
+  auto result = this->history_.push(time, level, message);
+  if (result.appended || result.evicted)
+  {
+    this->list_->sync(result.evicted);
+  }
+}
+
+void LogView::applyFilter()
+{
+  auto selection = std::max(this->levelChoice_->GetSelection(), 0);
+  this->history_.setFilter(LogFilter{
+      .minLevel = LEVELS[static_cast<std::size_t>(selection)], // NOLINT
+      .text = this->filterCtrl_->GetValue().utf8_string(),
+  });
+  this->list_->SetItemCount(static_cast<long>(this->history_.size()));
+  this->list_->Refresh();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "log/LogHistory.hpp"
+
+#include <wx/panel.h>
+
+class wxChoice;
+class wxLog;
+class wxTextCtrl;
+
+class LogList;
+
+/// Shows the last `CAPACITY` log messages in a virtual list - only the
+/// visible rows are rendered, so memory and append cost stay flat.
+///
+/// The view installs itself as the active `wxLog` target and restores the
+/// previous target when it's destroyed.
+class LogView : public wxPanel
+{
+public:
+  static constexpr std::size_t CAPACITY = 5000;
+
+  LogView(wxWindow *parent);
+  ~LogView() override;
+
+  LogView(const LogView &) = delete;
+  LogView(LogView &&) noexcept = delete;
+  LogView &operator=(const LogView &) = delete;
+  LogView &operator=(LogView &&) noexcept = delete;
+
+  /// Must be called on the UI thread.
+  void append(std::chrono::system_clock::time_point time, LogLevel level,
+              std::string_view message);
+
+private:
+  void applyFilter();
+
+  LogHistory history_;
+
+  LogList *list_ = nullptr;
+  wxChoice *levelChoice_ = nullptr;
+  wxTextCtrl *filterCtrl_ = nullptr;
+
+  wxLog *previousTarget_ = nullptr;
+};
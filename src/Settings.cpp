@@ -1,11 +1,12 @@
 #include "Settings.hpp"
 
+#include "persist/AtomicFile.hpp"
+
 #include <winrt/Windows.Data.Json.h>
 
 #include <wx/log.h>
 
 #include <filesystem>
-#include <fstream>
 #include <print>
 
 #define WIN32_LEAN_AND_MEAN
@@ -50,7 +51,19 @@ void ensurePath(const std::filesystem::path &path)
   }
 }
 
-Rules defaultRules()
+} // namespace
+
+AppSettings::AppSettings(std::shared_ptr<PersistWriter> writer)
+    : writer_(std::move(writer)),
+      configDir_(getSettingsPath()),
+      configPath_(this->configDir_ / "skip-my-song.json"),
+      votesPath_(this->configDir_ / "votes.bin")
+{
+  ensurePath(this->configDir_);
+  std::println(stderr, "Settings path is {}", this->configPath_.string());
+}
+
+Rules AppSettings::defaultRules()
 {
   return Rules{
       .command = "-voteskip",
@@ -61,30 +74,17 @@ Rules defaultRules()
   };
 }
 
-} // namespace
-
-AppSettings::AppSettings()
-    : configDir_(getSettingsPath()),
-      configPath_(this->configDir_ / "skip-my-song.json")
-{
-  ensurePath(this->configDir_);
-  std::println(stderr, "Settings path is {}", this->configPath_.string());
-}
-
 Rules AppSettings::read() const
 {
   try
   {
-    if (!std::filesystem::exists(this->configPath_))
+    auto contents = readFile(this->configPath_);
+    if (!contents)
     {
       std::println(stderr, "Using default settings as no config was found");
       return defaultRules();
     }
-    std::wifstream in(this->configPath_);
-    std::wstringstream stream;
-    stream << in.rdbuf();
-
-    winrt::hstring source(stream.view());
+    auto source = winrt::to_hstring(*contents);
 
     JsonObject obj;
     if (!JsonObject::TryParse(source, obj))
@@ -110,7 +110,22 @@ Rules AppSettings::read() const
   return defaultRules();
 }
 
-void AppSettings::writeNow(const Rules &rules) const
+std::optional<VoteState> AppSettings::readVotes() const
+{
+  auto contents = readFile(this->votesPath_);
+  if (!contents)
+  {
+    return std::nullopt;
+  }
+  auto votes = decodeVoteState(*contents);
+  if (!votes)
+  {
+    std::println(stderr, "Ignoring invalid saved votes");
+  }
+  return votes;
+}
+
+void AppSettings::save(const Rules &rules)
 {
   try
   {
@@ -125,20 +140,25 @@ void AppSettings::writeNow(const Rules &rules) const
                       JsonValue::CreateBooleanValue(rules.allowNonSubs));
     obj.SetNamedValue(L"threshold", JsonValue::CreateNumberValue(
                                         static_cast<double>(rules.threshold)));
-    std::wofstream out(this->configPath_);
-    out << obj.Stringify();
-    std::println(stderr, "Saved settings");
+    this->writer_->write(this->configPath_, winrt::to_string(obj.Stringify()));
   }
   catch (const std::exception &ex)
   {
-    wxLogMessage("Failed to write settings: %s", ex.what());
-    std::println(stderr, "Failed to write settings: {}", ex.what());
+    wxLogMessage("Failed to save settings: %s", ex.what());
+    std::println(stderr, "Failed to save settings: {}", ex.what());
   }
 }
 
-winrt::fire_and_forget AppSettings::writeBackground(Rules rules)
+void AppSettings::saveVotes(const VoteState &votes)
+{
+  this->writer_->write(this->votesPath_, encodeVoteState(votes));
+}
+
+winrt::fire_and_forget AppSettings::readBackground(
+    std::function<void(Rules, std::optional<VoteState>)> done)
 {
   auto lifetime = this->get_strong();
   co_await winrt::resume_background();
-  this->writeNow(rules);
+  auto rules = this->read();
+  done(std::move(rules), this->readVotes());
 }
@@ -1,24 +1,42 @@
 #pragma once
 
 #include "AppContext.hpp"
+#include "VoteState.hpp"
+#include "persist/PersistWriter.hpp"
 
 #include <winrt/Windows.Foundation.h>
 
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
 
 class AppSettings
     : public winrt::implements<AppSettings,
                                winrt::Windows::Foundation::IInspectable>
 {
 public:
-  AppSettings();
+  explicit AppSettings(std::shared_ptr<PersistWriter> writer);
+
+  /// Used until the settings are loaded and if there are none
+  static Rules defaultRules();
 
   Rules read() const;
+  /// The votes saved by the last run, if there are any.
+  std::optional<VoteState> readVotes() const;
+  /// Reads the settings and the saved votes on the thread pool and calls
+  /// `done` there.
+  winrt::fire_and_forget
+  readBackground(std::function<void(Rules, std::optional<VoteState>)> done);
 
-  void writeNow(const Rules &rules) const;
-  winrt::fire_and_forget writeBackground(Rules rules);
+  /// Both are queued on the writer - a newer save replaces an older one
+  /// that wasn't written yet.
+  void save(const Rules &rules);
+  void saveVotes(const VoteState &votes);
 
 private:
+  std::shared_ptr<PersistWriter> writer_;
   std::filesystem::path configDir_;
   std::filesystem::path configPath_;
+  std::filesystem::path votesPath_;
 };
@@ -0,0 +1,144 @@
+#include "ShardedVoteCounter.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace
+{
+
+/// Users that didn't vote since their shard was pruned
+constexpr std::uint64_t NO_EPOCH = std::numeric_limits<std::uint64_t>::max();
+
+constexpr std::uint64_t COUNT_MASK = 0xffffffff;
+
+std::uint64_t epochOf(std::uint64_t tally)
+{
+  return tally >> 32;
+}
+
+std::uint64_t countOf(std::uint64_t tally)
+{
+  return tally & COUNT_MASK;
+}
+
+std::uint64_t pack(std::uint64_t epoch, std::uint64_t count)
+{
+  return (epoch << 32) | count;
+}
+
+std::size_t clampThreshold(std::size_t threshold)
+{
+  return std::clamp<std::size_t>(threshold, 1, COUNT_MASK);
+}
+
+} // namespace
+
+ShardedVoteCounter::ShardedVoteCounter(std::size_t threshold,
+                                       std::size_t shards)
+    : shardCount_(shards != 0
+                      ? shards
+                      : std::max(std::thread::hardware_concurrency(), 1U)),
+      pruneSize_(std::max<std::size_t>(
+          VoteCounter::PRUNE_SIZE / this->shardCount_, 1)),
+      threshold_(clampThreshold(threshold))
+{
+  this->shards_ = std::make_unique<Shard[]>(this->shardCount_);
+  for (std::size_t i = 0; i < this->shardCount_; i++)
+  {
+    this->shards_[i].votes.reserve(this->pruneSize_);
+  }
+}
+
+ShardedVoteCounter::Result ShardedVoteCounter::vote(std::string_view user)
+{
+  auto &shard = this->shardOf(user);
+  std::lock_guard lock(shard.mutex);
+
+  auto tally = this->tally_.load(std::memory_order_relaxed);
+  auto it = shard.votes.find(user);
+  if (it == shard.votes.end())
+  {
+    shard.prune(epochOf(tally), this->pruneSize_);
+    it = shard.votes.emplace(UserName(user), NO_EPOCH).first;
+  }
+
+  // Only other shards change the tally - retry until our vote is in
+  for (;;)
+  {
+    auto epoch = epochOf(tally);
+    if (it->second == epoch)
+    {
+      return Result::Duplicate;
+    }
+
+    auto count = countOf(tally) + 1;
+    bool reached = count >= this->threshold_.load(std::memory_order_relaxed);
+    auto next = reached ? pack(epoch + 1, 0) : pack(epoch, count);
+    if (!this->tally_.compare_exchange_weak(tally, next,
+                                            std::memory_order_relaxed))
+    {
+      continue;
+    }
+
+    it->second = epoch;
+    if (shard.epoch != epoch)
+    {
+      shard.epoch = epoch;
+      shard.epochVotes = 0;
+    }
+    shard.epochVotes++;
+    shard.counted.fetch_add(1, std::memory_order_relaxed);
+    return reached ? Result::ThresholdReached : Result::Counted;
+  }
+}
+
+void ShardedVoteCounter::reset()
+{
+  auto tally = this->tally_.load(std::memory_order_relaxed);
+  while (!this->tally_.compare_exchange_weak(
+      tally, pack(epochOf(tally) + 1, 0), std::memory_order_relaxed))
+  {
+  }
+}
+
+std::size_t ShardedVoteCounter::count() const
+{
+  return static_cast<std::size_t>(
+      countOf(this->tally_.load(std::memory_order_relaxed)));
+}
+
+std::uint64_t ShardedVoteCounter::epoch() const
+{
+  return epochOf(this->tally_.load(std::memory_order_relaxed));
+}
+
+void ShardedVoteCounter::setThreshold(std::size_t threshold)
+{
+  this->threshold_.store(clampThreshold(threshold),
+                         std::memory_order_relaxed);
+}
+
+ShardedVoteCounter::Shard &
+ShardedVoteCounter::shardOf(std::string_view user)
+{
+  // The maps use the low bits of the same hash for their buckets - pick the
+  // shard from the mixed high bits.
+  auto hash = static_cast<std::uint64_t>(UserName::Hash{}(user));
+  auto mixed = (hash * 0x9E3779B97F4A7C15ULL) >> 32;
+  return this->shards_[mixed % this->shardCount_];
+}
+
+void ShardedVoteCounter::Shard::prune(std::uint64_t current,
+                                      std::size_t minSize)
+{
+  // Like `VoteCounter::prune`: at least half of the entries are from older
+  // epochs.
+  auto votes = this->epoch == current ? this->epochVotes : 0;
+  if (this->votes.size() < minSize || this->votes.size() < 2 * votes)
+  {
+    return;
+  }
+  std::erase_if(this->votes, [current](const auto &entry)
+                { return entry.second != current; });
+}
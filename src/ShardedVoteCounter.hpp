@@ -0,0 +1,90 @@
+#pragma once
+
+#include "UserName.hpp"
+#include "VoteCounter.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+/// Counts the votes of unique users from any number of threads.
+///
+/// Users are partitioned by the hash of their name into shards, each with its
+/// own lock, set of voters and counter, so threads voting for different users
+/// rarely wait for each other. The shards share a single tally of the
+/// current epoch and its votes, updated with a relaxed compare-and-swap. The
+/// vote that takes the tally to the threshold starts the next epoch in the
+/// same step - it's the only one that gets `ThresholdReached`.
+///
+/// Unlike `VoteCounter`, there are no stale votes and voting can't be
+/// disabled - the caller filters those before voting.
+class ShardedVoteCounter
+{
+public:
+  using Result = VoteCounter::Result;
+
+  /// `shards = 0` creates a shard per hardware thread.
+  explicit ShardedVoteCounter(std::size_t threshold, std::size_t shards = 0);
+
+  ShardedVoteCounter(const ShardedVoteCounter &) = delete;
+  ShardedVoteCounter(ShardedVoteCounter &&) noexcept = delete;
+  ShardedVoteCounter &operator=(const ShardedVoteCounter &) = delete;
+  ShardedVoteCounter &operator=(ShardedVoteCounter &&) noexcept = delete;
+
+  /// Returns `Duplicate`, `Counted` or `ThresholdReached`. Thread-safe.
+  Result vote(std::string_view user);
+
+  /// Starts a new epoch.
+  void reset();
+
+  std::size_t count() const;
+  std::uint64_t epoch() const;
+
+  std::size_t threshold() const
+  {
+    return this->threshold_.load(std::memory_order_relaxed);
+  }
+  void setThreshold(std::size_t threshold);
+
+  std::size_t shards() const { return this->shardCount_; }
+  /// Votes counted by `shard` over all epochs
+  std::uint64_t counted(std::size_t shard) const
+  {
+    return this->shards_[shard].counted.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct alignas(64) Shard
+  {
+    std::mutex mutex;
+    std::pmr::unsynchronized_pool_resource pool;
+    /// User -> epoch of their last vote
+    std::pmr::unordered_map<UserName, std::uint64_t, UserName::Hash,
+                            std::equal_to<>>
+        votes{&this->pool};
+    /// Votes in `epoch` - to decide when to prune
+    std::uint64_t epoch = 0;
+    std::size_t epochVotes = 0;
+    std::atomic<std::uint64_t> counted{0};
+
+    /// Prunes once there are at least `minSize` users.
+    void prune(std::uint64_t current, std::size_t minSize);
+  };
+
+  Shard &shardOf(std::string_view user);
+
+  std::unique_ptr<Shard[]> shards_;
+  std::size_t shardCount_;
+  /// `VoteCounter::PRUNE_SIZE`, split between the shards
+  std::size_t pruneSize_;
+
+  /// The epoch (upper 32 bits) and the votes in it (lower 32 bits)
+  alignas(64) std::atomic<std::uint64_t> tally_{0};
+  std::atomic<std::size_t> threshold_;
+};
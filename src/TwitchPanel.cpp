@@ -1,31 +1,65 @@
 #include "TwitchPanel.hpp"
 
+#include "LogView.hpp"
+#include "trace/Trace.hpp"
+
 #include <wx/button.h>
 #include <wx/checkbox.h>
+#include <wx/gauge.h>
 #include <wx/log.h>
 #include <wx/sizer.h>
 #include <wx/spinctrl.h>
 #include <wx/stattext.h>
 #include <wx/textctrl.h>
 
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
 namespace
 {
 
 constexpr auto BORDER_X = wxRIGHT | wxLEFT;
+constexpr auto DEBOUNCE = std::chrono::seconds(1);
+/// Vote changes are shown at most 10 times per second
+constexpr auto REFRESH_INTERVAL = std::chrono::milliseconds(100);
+/// A crash loses at most this much of the votes
+constexpr auto VOTES_SAVE_INTERVAL = std::chrono::seconds(1);
+/// Saved votes older than this are for a track that's long over, even if the
+/// media app didn't report a track (yet).
+constexpr auto MAX_RESTORE_AGE = std::chrono::minutes(10);
+
+double roundToTenths(double value) { return std::round(value * 10.0) / 10.0; }
+
+std::chrono::system_clock::time_point
+toSystemTime(std::chrono::steady_clock::time_point at)
+{
+  return std::chrono::system_clock::now() -
+         std::chrono::duration_cast<std::chrono::system_clock::duration>(
+             std::chrono::steady_clock::now() - at);
+}
 
 } // namespace
 
-TwitchPanel::TwitchPanel(wxWindow *parent, AppContextPtr app,
-                         winrt::com_ptr<GsmtcWorker> gsmtc,
+TwitchPanel::TwitchPanel(wxWindow *parent, Clock &clock, AppContextPtr app,
+                         std::shared_ptr<MediaController> media,
                          winrt::com_ptr<AppSettings> settings)
     : wxPanel(parent),
-      commandDebouncer_(this, Id::CommandDebounceTimer),
-      thresholdDebouncer_(this, Id::ThresholdDebounceTimer),
-      settingsDebouncer_(this, Id::SettingsDebounceTimer),
+      commandDebouncer_(clock, DEBOUNCE, [this] { this->emitRules(); }),
+      thresholdDebouncer_(clock, DEBOUNCE, [this] { this->applyThreshold(); }),
+      settingsSave_(clock, DEBOUNCE, [this] { this->doSave(); }),
+      votesSave_(clock, VOTES_SAVE_INTERVAL, [this] { this->saveVotes(); }),
+      refresh_(clock, REFRESH_INTERVAL, [this] { this->refreshVotes(); }),
+      clock_(clock),
       app_(std::move(app)),
-      rules_(this->app_->readRules()),
-      gsmtc_(std::move(gsmtc)),
-      settings_(std::move(settings))
+      rules_(AppSettings::defaultRules()),
+      media_(std::move(media)),
+      skips_(this->media_, std::shared_ptr<Metrics>(this->app_,
+                                                    &this->app_->metrics())),
+      settings_(std::move(settings)),
+      voteBatch_([this]
+                 { this->CallAfter([this] { this->drainVotes(); }); }),
+      votes_(this->rules_.threshold)
 {
   auto *sizerPanel = new wxBoxSizer(wxVERTICAL);
 
@@ -37,6 +71,10 @@ TwitchPanel::TwitchPanel(wxWindow *parent, AppContextPtr app,
   channelBox->Add(this->channelCtrl_, 1);
   channelBox->AddSpacer(5);
   channelBox->Add(new wxButton(this, Id::ConnectBtn, "Connect"));
+  channelBox->AddSpacer(5);
+  this->compressBox_ = new wxCheckBox(this, Id::CompressChk, "Compress");
+  this->compressBox_->SetValue(this->app_->readCompression().enabled);
+  channelBox->Add(this->compressBox_, 0, wxALIGN_CENTER);
   sizerPanel->Add(channelBox, 0, wxEXPAND | wxRIGHT, 3);
   sizerPanel->AddSpacer(10);
 
@@ -65,6 +103,11 @@ TwitchPanel::TwitchPanel(wxWindow *parent, AppContextPtr app,
   this->currentVotesLabel_ =
       new wxStaticText(this, wxID_ANY, "Current Votes: 0");
   voteBox->Add(this->currentVotesLabel_, 0, wxALIGN_CENTER);
+  this->voteProgress_ =
+      new wxGauge(this, wxID_ANY, static_cast<int>(this->votes_.threshold()));
+  voteBox->Add(this->voteProgress_, 0, wxEXPAND | wxTOP, 5);
+  this->voteRateLabel_ = new wxStaticText(this, wxID_ANY, "0.0 votes/s");
+  voteBox->Add(this->voteRateLabel_, 0, wxALIGN_CENTER | wxTOP, 5);
   votePerms->Add(voteBox, 1, wxALIGN_CENTER | BORDER_X, 5);
 
   // Permissions (Subs/Non-Subs)
@@ -91,57 +134,181 @@ TwitchPanel::TwitchPanel(wxWindow *parent, AppContextPtr app,
   sizerPanel->AddSpacer(10);
 
   // Logs
-  auto *logCtrl =
-      new wxTextCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition,
-                     wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY);
-  // TODO: delete?
-  wxLog::SetActiveTarget(new wxLogTextCtrl(logCtrl));
   auto *logBox = new wxStaticBoxSizer(wxHORIZONTAL, this, "Logs");
-  logBox->Add(logCtrl, 1, wxEXPAND);
+  logBox->Add(new LogView(this), 1, wxEXPAND);
   sizerPanel->Add(logBox, 1, wxEXPAND | wxRIGHT, 3);
 
   this->SetSizer(sizerPanel);
 
   this->Bind(
-      wxEVT_TIMER, [this](auto) { this->emitRules(); },
-      Id::CommandDebounceTimer);
-  this->Bind(
-      wxEVT_TEXT, [this](auto) { this->commandDebouncer_.StartOnce(1000); },
+      wxEVT_TEXT, [this](auto) { this->commandDebouncer_.trigger(); },
       Id::CommandBox);
 
-  this->Bind(VOTE_EVENT,
-             [this](const VoteEvent &event) { this->onVote(event.user()); });
+  this->shownVotes_ = this->snapshotVotes();
+  this->media_->setTrackChangedHandler(
+      [this](const MediaState &state)
+      {
+        auto at = std::chrono::steady_clock::now();
+        this->CallAfter([this, at, title = state.title]
+                        { this->onTrackChanged(at, title); });
+      });
+  this->app_->setHandler(&this->voteBatch_);
+}
 
-  this->app_->setHandler(this);
-  this->emitRules();
+TwitchPanel::~TwitchPanel()
+{
+  this->media_->setTrackChangedHandler(nullptr);
+  if (this->votesSave_.isPending())
+  {
+    this->saveVotes();
+  }
 }
 
-void TwitchPanel::onVote(const std::string &user)
+void TwitchPanel::loadRules(Rules rules)
 {
-  if (!this->enabled_)
+  this->rules_ = std::move(rules);
+  // ChangeValue doesn't emit wxEVT_TEXT, so this doesn't trigger a save
+  this->channelCtrl_->ChangeValue(this->rules_.channel);
+  this->commandCtrl_->ChangeValue(this->rules_.command);
+  this->allowSubsBox_->SetValue(this->rules_.allowSubs);
+  this->allowNonSubsBox_->SetValue(this->rules_.allowNonSubs);
+  this->minVotesCtrl_->SetValue(static_cast<int>(this->rules_.threshold));
+  this->votes_.setThreshold(this->rules_.threshold);
+  this->queueRefresh();
+
+  this->rulesLoaded_ = true;
+  this->app_->setRules(this->rules_);
+}
+
+void TwitchPanel::restoreVotes(VoteState votes)
+{
+  if (std::chrono::system_clock::now() - votes.savedAt > MAX_RESTORE_AGE)
   {
+    wxLogMessage("Not restoring votes - they're too old");
     return;
   }
-
-  auto [_, inserted] = this->votes_.emplace(user);
-  if (!inserted)
+  if (votes.savedAt < this->epochStartedAt_)
+  {
+    wxLogMessage("Not restoring votes - they were reset since");
+    return;
+  }
+  if (!this->trackTitle_.empty() && this->trackTitle_ != votes.title)
   {
+    wxLogMessage("Not restoring votes - the track changed");
     return;
   }
-  this->currentVotes_ += 1;
-  this->currentVotesLabel_->SetLabel(
-      std::format("Current Votes: {}", this->currentVotes_));
+  if (this->trackTitle_.empty())
+  {
+    this->restoredTrack_ = votes.title;
+  }
+  this->trackTitle_ = std::move(votes.title);
+
+  this->votes_.restore(votes.voters);
+  this->votes_.setEnabled(votes.enabled);
+  this->toggleBtn_->SetLabel(votes.enabled ? "Disable" : "Enable");
+  this->queueRefresh();
+  wxLogMessage("Restored %d votes", static_cast<int>(this->votes_.count()));
+}
 
-  if (this->currentVotes_ >= this->rules_.threshold)
+void TwitchPanel::setOverlay(OverlayServer *overlay)
+{
+  this->overlay_ = overlay;
+  if (this->overlay_ != nullptr)
   {
+    this->overlay_->publish(this->shownVotes_);
+  }
+}
+
+void TwitchPanel::drainVotes()
+{
+  this->voteBatch_.take(this->drainedVotes_);
+
+  std::uint32_t counted = 0;
+  for (const auto &vote : this->drainedVotes_)
+  {
+    if (this->onVote(vote))
+    {
+      counted++;
+    }
+  }
+  this->drainedVotes_.clear();
+
+  if (counted > 0)
+  {
+    this->voteRate_.add(this->clock_.now(), counted);
+    this->queueRefresh();
+    this->queueVoteSave();
+  }
+}
+
+bool TwitchPanel::onVote(const Vote &vote)
+{
+  auto &metrics = this->app_->metrics();
+  metrics.record(Metrics::Stage::UiApply,
+                 std::chrono::steady_clock::now() - vote.publishedAt);
+
+  switch (this->votes_.vote(vote.user, vote.receivedAt))
+  {
+  case VoteCounter::Result::Ignored:
+  case VoteCounter::Result::Stale:
+    break;
+  case VoteCounter::Result::Duplicate:
+    metrics.add(Metrics::Counter::Duplicates);
+    break;
+  case VoteCounter::Result::Counted:
+    return true;
+  case VoteCounter::Result::ThresholdReached:
     wxLogMessage("Votes reached!");
-    this->gsmtc_->skipSong();
+    this->skipSong(vote);
     this->resetVotes();
+    return true;
   }
+  return false;
+}
+
+void TwitchPanel::onTrackChanged(std::chrono::steady_clock::time_point at,
+                                 const std::string &title)
+{
+  auto previous = std::exchange(this->trackTitle_, title);
+  if (std::exchange(this->restoredTrack_, {}) == title)
+  {
+    return; // the restored votes are for this track
+  }
+  this->votes_.startEpoch(at);
+  // The first track was already playing when we started - the saved votes
+  // might be for it.
+  if (!previous.empty())
+  {
+    this->epochStartedAt_ = toSystemTime(at);
+  }
+  this->queueRefresh();
+  this->queueVoteSave();
+  wxLogMessage("Now playing %s - reset votes", wxString::FromUTF8(title));
+}
+
+void TwitchPanel::skipSong(const Vote &lastVote)
+{
+  TraceSpan span("skip", "ui");
+  if (this->skips_.request() == SkipDispatcher::Result::Coalesced)
+  {
+    wxLogMessage("Already skipping");
+    return;
+  }
+  if (this->overlay_ != nullptr)
+  {
+    this->overlay_->publishSkip();
+  }
+  this->app_->metrics().record(Metrics::Stage::VoteToSkip,
+                               std::chrono::steady_clock::now() -
+                                   lastVote.receivedAt);
 }
 
 void TwitchPanel::emitRules()
 {
+  if (!this->rulesLoaded_)
+  {
+    return;
+  }
   this->rules_ = Rules{
       .command = this->commandCtrl_->GetValue().ToStdString(),
       .channel = this->channelCtrl_->GetValue().ToStdString(),
@@ -158,71 +325,155 @@ void TwitchPanel::permissionsUpdated(wxCommandEvent & /*evt*/)
 {
   this->emitRules();
 }
+void TwitchPanel::compressionUpdated(wxCommandEvent & /*evt*/)
+{
+  auto compression = this->app_->readCompression();
+  compression.enabled = this->compressBox_->GetValue();
+  this->app_->setCompression(compression);
+  wxLogMessage(compression.enabled ? "Enabled chat compression"
+                                   : "Disabled chat compression");
+}
 void TwitchPanel::thresholdUpdated(wxSpinEvent & /*evt*/)
 {
-  this->thresholdDebouncer_.StartOnce(1000);
+  this->thresholdDebouncer_.trigger();
 }
 
-void TwitchPanel::applyThreshold(wxTimerEvent & /*evt*/)
+void TwitchPanel::applyThreshold()
 {
   this->rules_.threshold =
       static_cast<size_t>(std::max(this->minVotesCtrl_->GetValue(), 1));
-  if (this->currentVotes_ >= this->rules_.threshold)
+  this->votes_.setThreshold(this->rules_.threshold);
+  if (this->votes_.count() >= this->votes_.threshold())
   {
     this->resetVotes();
   }
+  this->queueRefresh();
   this->queueSave();
 }
 
 void TwitchPanel::resetVotes()
 {
-  this->currentVotes_ = 0;
-  this->votes_.clear(); // TODO: resize?
-  this->currentVotesLabel_->SetLabel(
-      std::format("Current Votes: {}", this->currentVotes_));
+  this->votes_.reset();
+  this->epochStartedAt_ = std::chrono::system_clock::now();
+  this->queueRefresh();
+  this->queueVoteSave();
   wxLogMessage("Reset votes");
 }
 
 void TwitchPanel::resetVotes(wxCommandEvent & /*evt*/) { this->resetVotes(); }
 
-void TwitchPanel::doSave(wxTimerEvent & /*evt*/)
+void TwitchPanel::doSave() { this->settings_->save(this->rules_); }
+
+void TwitchPanel::queueSave()
 {
-  this->settings_->writeBackground(this->rules_);
+  if (this->rulesLoaded_)
+  {
+    this->settingsSave_.trigger();
+  }
 }
 
-void TwitchPanel::queueSave()
+void TwitchPanel::queueVoteSave()
 {
-  if (!this->settingsDebouncer_.IsRunning())
+  // Until the rules are loaded, the saved votes weren't restored yet
+  if (this->rulesLoaded_)
   {
-    this->settingsDebouncer_.StartOnce(1000);
+    this->votesSave_.trigger();
   }
 }
 
+void TwitchPanel::saveVotes()
+{
+  this->votesSave_.cancel();
+  this->settings_->saveVotes(VoteState{
+      .savedAt = std::chrono::system_clock::now(),
+      .title = this->trackTitle_,
+      .enabled = this->votes_.enabled(),
+      .voters = this->votes_.voters(),
+  });
+}
+
 void TwitchPanel::toggleState(wxCommandEvent & /*evt*/)
 {
-  if (this->enabled_)
+  this->queueVoteSave();
+  if (this->votes_.enabled())
   {
-    this->enabled_ = false;
+    this->votes_.setEnabled(false);
     this->toggleBtn_->SetLabel("Enable");
+    this->queueRefresh();
     wxLogMessage("Disabled voting");
   }
   else
   {
-    this->enabled_ = true;
+    this->votes_.setEnabled(true);
     this->toggleBtn_->SetLabel("Disable");
+    this->queueRefresh();
     wxLogMessage("Enabled voting");
   }
 }
 
+VoteSnapshot TwitchPanel::snapshotVotes() const
+{
+  return {
+      .count = this->votes_.count(),
+      .threshold = this->votes_.threshold(),
+      .enabled = this->votes_.enabled(),
+      .rate = roundToTenths(this->voteRate_.perSecond(this->clock_.now())),
+  };
+}
+
+void TwitchPanel::queueRefresh()
+{
+  this->refresh_.trigger();
+}
+
+void TwitchPanel::refreshVotes()
+{
+  auto votes = this->snapshotVotes();
+  const auto &shown = this->shownVotes_;
+
+  if (votes.count != shown.count)
+  {
+    this->currentVotesLabel_->SetLabel(
+        std::format("Current Votes: {}", votes.count));
+  }
+  if (votes.threshold != shown.threshold)
+  {
+    this->voteProgress_->SetRange(static_cast<int>(votes.threshold));
+  }
+  if (votes.count != shown.count || votes.threshold != shown.threshold)
+  {
+    this->voteProgress_->SetValue(
+        static_cast<int>(std::min(votes.count, votes.threshold)));
+  }
+  if (votes.enabled != shown.enabled)
+  {
+    this->voteProgress_->Enable(votes.enabled);
+  }
+  if (votes.rate != shown.rate)
+  {
+    this->voteRateLabel_->SetLabel(std::format("{:.1f} votes/s", votes.rate));
+  }
+  this->shownVotes_ = votes;
+  if (this->overlay_ != nullptr)
+  {
+    this->overlay_->publish(votes);
+  }
+
+  // keep sampling until the rate decayed
+  if (votes.rate > 0)
+  {
+    this->queueRefresh();
+  }
+}
+
 // clang-format off
 wxBEGIN_EVENT_TABLE(TwitchPanel, wxPanel)
     EVT_BUTTON(Id::ConnectBtn, TwitchPanel::connect)
     EVT_TEXT_ENTER(Id::ChannelBox, TwitchPanel::connect)
     EVT_CHECKBOX(Id::AllowSubsChk, TwitchPanel::permissionsUpdated)
     EVT_CHECKBOX(Id::AllowNonSubsChk, TwitchPanel::permissionsUpdated)
+    EVT_CHECKBOX(Id::CompressChk, TwitchPanel::compressionUpdated)
     EVT_SPINCTRL(Id::ThresholdBox, TwitchPanel::thresholdUpdated)
-    EVT_TIMER(Id::ThresholdDebounceTimer, TwitchPanel::applyThreshold)
-    EVT_TIMER(Id::SettingsDebounceTimer, TwitchPanel::doSave)
     EVT_BUTTON(Id::ToggleStateBtn, TwitchPanel::toggleState)
     EVT_BUTTON(Id::ResetVotesBtn, TwitchPanel::resetVotes)
 wxEND_EVENT_TABLE()
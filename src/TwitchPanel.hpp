@@ -2,24 +2,48 @@
 
 #include "AppContext.hpp"
 #include "Settings.hpp"
-#include "gsmtc/GsmtcWorker.hpp"
+#include "VoteBatch.hpp"
+#include "VoteCounter.hpp"
+#include "VoteRate.hpp"
+#include "VoteState.hpp"
+#include "media/MediaController.hpp"
+#include "media/SkipDispatcher.hpp"
+#include "overlay/OverlayServer.hpp"
+#include "time/Clock.hpp"
+#include "time/Debouncer.hpp"
 
 #include <wx/panel.h>
-#include <wx/timer.h>
 
-#include <unordered_set>
+#include <vector>
 
 class wxStaticText;
 class wxTextCtrl;
 class wxCheckBox;
 class wxSpinCtrl;
+class wxGauge;
 
 class TwitchPanel : public wxPanel
 {
 public:
-  TwitchPanel(wxWindow *parent, AppContextPtr app,
-              winrt::com_ptr<GsmtcWorker> gsmtc,
+  TwitchPanel(wxWindow *parent, Clock &clock, AppContextPtr app,
+              std::shared_ptr<MediaController> media,
               winrt::com_ptr<AppSettings> settings);
+  ~TwitchPanel() override;
+
+  TwitchPanel(const TwitchPanel &) = delete;
+  TwitchPanel(TwitchPanel &&) noexcept = delete;
+  TwitchPanel &operator=(const TwitchPanel &) = delete;
+  TwitchPanel &operator=(TwitchPanel &&) noexcept = delete;
+
+  /// Shows the loaded settings and joins the channel. Until then, the
+  /// defaults are shown and edits are neither applied nor saved.
+  void loadRules(Rules rules);
+  /// Restores the votes saved by the last run, unless another track is
+  /// playing by now, the votes were reset after they were saved or they're
+  /// too old. Call it after `loadRules()`.
+  void restoreVotes(VoteState votes);
+  /// Pushes the votes and skips to `overlay` (which must outlive the panel).
+  void setOverlay(OverlayServer *overlay);
 
 private:
   enum Id
@@ -32,50 +56,82 @@ private:
     AllowNonSubsChk,
     ToggleStateBtn,
     ResetVotesBtn,
-
-    CommandDebounceTimer = 0x2000,
-    ThresholdDebounceTimer,
-    SettingsDebounceTimer,
+    CompressChk,
   };
 
   void connect(wxCommandEvent &evt);
   void permissionsUpdated(wxCommandEvent &evt);
+  /// Reconnects with or without `permessage-deflate`.
+  void compressionUpdated(wxCommandEvent &evt);
   void thresholdUpdated(wxSpinEvent &evt);
-  void applyThreshold(wxTimerEvent &evt);
+  void applyThreshold();
 
   void resetVotes();
   void resetVotes(wxCommandEvent &evt);
 
-  void onVote(const std::string &user);
+  /// Applies all votes published since the last call.
+  void drainVotes();
+  /// Returns whether the vote was counted.
+  bool onVote(const Vote &vote);
+  /// Starts a new vote epoch - votes received before `at` don't count.
+  void onTrackChanged(std::chrono::steady_clock::time_point at,
+                      const std::string &title);
+  void skipSong(const Vote &lastVote);
 
   void emitRules();
   void queueSave();
-  void doSave(wxTimerEvent &evt);
+  void doSave();
+  /// Saves the votes at most once per `VOTES_SAVE_INTERVAL`.
+  void queueVoteSave();
+  void saveVotes();
 
   void toggleState(wxCommandEvent &evt);
 
+  VoteSnapshot snapshotVotes() const;
+  void queueRefresh();
+  void refreshVotes();
+
   wxStaticText *currentVotesLabel_ = nullptr;
+  wxStaticText *voteRateLabel_ = nullptr;
+  wxGauge *voteProgress_ = nullptr;
   wxTextCtrl *channelCtrl_ = nullptr;
   wxTextCtrl *commandCtrl_ = nullptr;
   wxCheckBox *allowNonSubsBox_ = nullptr;
   wxCheckBox *allowSubsBox_ = nullptr;
+  wxCheckBox *compressBox_ = nullptr;
   wxSpinCtrl *minVotesCtrl_ = nullptr;
   wxButton *toggleBtn_ = nullptr;
 
-  wxTimer commandDebouncer_;
-  wxTimer thresholdDebouncer_;
-  wxTimer settingsDebouncer_;
-
-  size_t currentVotes_ = 0;
-  bool enabled_ = true;
+  Debouncer commandDebouncer_;
+  Debouncer thresholdDebouncer_;
+  Throttle settingsSave_;
+  Throttle votesSave_;
+  Throttle refresh_;
 
+  Clock &clock_;
   AppContextPtr app_;
   Rules rules_;
+  bool rulesLoaded_ = false;
 
-  winrt::com_ptr<GsmtcWorker> gsmtc_;
+  std::shared_ptr<MediaController> media_;
+  SkipDispatcher skips_;
   winrt::com_ptr<AppSettings> settings_;
 
-  std::unordered_set<std::string> votes_;
+  VoteBatch voteBatch_;
+  /// The batch being applied - kept to reuse its capacity
+  std::vector<Vote> drainedVotes_;
+  VoteCounter votes_;
+  /// The title of the current track - the saved votes are for this track
+  std::string trackTitle_;
+  /// Set while the votes were restored but the media app didn't report the
+  /// track yet
+  std::string restoredTrack_;
+  /// When the current epoch started - on the clock of `VoteState::savedAt`
+  std::chrono::system_clock::time_point epochStartedAt_{};
+  VoteRate voteRate_;
+  /// What's currently shown
+  VoteSnapshot shownVotes_;
+  OverlayServer *overlay_ = nullptr;
 
   wxDECLARE_EVENT_TABLE();
 };
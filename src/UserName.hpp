@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+/// A Twitch login stored inline, so votes can be passed around and counted
+/// without touching the heap.
+///
+/// Logins are at most 25 characters - longer names are truncated.
+class UserName
+{
+public:
+  static constexpr std::size_t MAX_SIZE = 31;
+
+  UserName() = default;
+  explicit UserName(std::string_view name)
+      : size_(static_cast<std::uint8_t>(std::min(name.size(), MAX_SIZE)))
+  {
+    std::copy_n(name.data(), this->size_, this->data_.data());
+  }
+
+  std::string_view view() const { return {this->data_.data(), this->size_}; }
+  operator std::string_view() const { return this->view(); }
+
+  bool operator==(const UserName &other) const
+  {
+    return this->view() == other.view();
+  }
+
+  /// Transparent, so maps keyed by `UserName` can be searched with a
+  /// `std::string_view`.
+  struct Hash
+  {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view name) const
+    {
+      return std::hash<std::string_view>{}(name);
+    }
+  };
+
+private:
+  std::array<char, MAX_SIZE> data_{};
+  std::uint8_t size_ = 0;
+};
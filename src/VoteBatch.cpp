@@ -0,0 +1,26 @@
+#include "VoteBatch.hpp"
+
+#include <utility>
+
+VoteBatch::VoteBatch(std::function<void()> wake) : wake_(std::move(wake)) {}
+
+void VoteBatch::publishVote(Vote vote)
+{
+  bool wake = false;
+  {
+    std::lock_guard lock(this->mtx_);
+    this->pending_.push_back(std::move(vote));
+    wake = !std::exchange(this->woken_, true);
+  }
+  if (wake)
+  {
+    this->wake_();
+  }
+}
+
+void VoteBatch::take(std::vector<Vote> &out)
+{
+  std::lock_guard lock(this->mtx_);
+  std::swap(out, this->pending_);
+  this->woken_ = false;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "VoteSink.hpp"
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/// Collects the votes published on the IO thread until the UI thread takes
+/// them.
+///
+/// `wake` is called once for the first vote of a batch - more votes only get
+/// appended until the batch is taken, so the UI thread gets one wake-up per
+/// batch instead of one event per vote.
+class VoteBatch : public VoteSink
+{
+public:
+  explicit VoteBatch(std::function<void()> wake);
+
+  void publishVote(Vote vote) override;
+
+  /// Swaps the pending votes with `out` (which should be empty), so both
+  /// vectors keep their capacity. The next vote wakes the UI thread again.
+  void take(std::vector<Vote> &out);
+
+private:
+  std::function<void()> wake_;
+
+  std::mutex mtx_;
+  std::vector<Vote> pending_;
+  bool woken_ = false;
+};
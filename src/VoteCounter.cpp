@@ -0,0 +1,111 @@
+#include "VoteCounter.hpp"
+
+#include <algorithm>
+
+VoteCounter::VoteCounter(std::size_t threshold)
+    : votes_(&this->pool_),
+      threshold_(std::max<std::size_t>(threshold, 1))
+{
+  this->votes_.reserve(PRUNE_SIZE);
+}
+
+VoteCounter::Result VoteCounter::vote(std::string_view user)
+{
+  return this->vote(user, TimePoint::max());
+}
+
+VoteCounter::Result VoteCounter::vote(std::string_view user, TimePoint castAt)
+{
+  if (!this->enabled_)
+  {
+    return Result::Ignored;
+  }
+  if (castAt < this->epochStart_)
+  {
+    return Result::Stale;
+  }
+
+  auto it = this->votes_.find(user);
+  if (it == this->votes_.end())
+  {
+    this->prune();
+    this->votes_.emplace(UserName(user), this->epoch_);
+  }
+  else if (it->second == this->epoch_)
+  {
+    return Result::Duplicate;
+  }
+  else
+  {
+    it->second = this->epoch_;
+  }
+
+  if (++this->count_ >= this->threshold_)
+  {
+    this->reset();
+    return Result::ThresholdReached;
+  }
+  return Result::Counted;
+}
+
+void VoteCounter::reset()
+{
+  this->epoch_++;
+  this->count_ = 0;
+}
+
+void VoteCounter::startEpoch(TimePoint since)
+{
+  this->epochStart_ = std::max(this->epochStart_, since);
+  this->reset();
+}
+
+std::vector<UserName> VoteCounter::voters() const
+{
+  std::vector<UserName> voters;
+  voters.reserve(this->count_);
+  for (const auto &[user, epoch] : this->votes_)
+  {
+    if (epoch == this->epoch_)
+    {
+      voters.emplace_back(user);
+    }
+  }
+  return voters;
+}
+
+void VoteCounter::restore(std::span<const UserName> voters)
+{
+  this->reset();
+  if (voters.size() >= this->threshold_)
+  {
+    return;
+  }
+  for (const auto &user : voters)
+  {
+    this->prune();
+    auto [it, inserted] = this->votes_.emplace(user, this->epoch_);
+    if (inserted || it->second != this->epoch_)
+    {
+      it->second = this->epoch_;
+      this->count_++;
+    }
+  }
+}
+
+void VoteCounter::setThreshold(std::size_t threshold)
+{
+  this->threshold_ = std::max<std::size_t>(threshold, 1);
+}
+
+void VoteCounter::prune()
+{
+  // Amortized O(1): at least half of the entries are from older epochs.
+  if (this->votes_.size() < PRUNE_SIZE ||
+      this->votes_.size() < 2 * this->count_)
+  {
+    return;
+  }
+  std::erase_if(this->votes_, [epoch = this->epoch_](const auto &entry)
+                { return entry.second != epoch; });
+}
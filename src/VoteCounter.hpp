@@ -0,0 +1,105 @@
+#pragma once
+
+#include "UserName.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// The vote state the UI shows - sampled at a capped rate instead of being
+/// rendered on every vote.
+struct VoteSnapshot
+{
+  std::size_t count = 0;
+  std::size_t threshold = 1;
+  bool enabled = true;
+  /// Votes per second, rounded to tenths
+  double rate = 0;
+
+  bool operator==(const VoteSnapshot &) const = default;
+};
+
+/// Counts the votes of unique users until the threshold is reached.
+///
+/// Votes are grouped into epochs (usually one per track). Starting a new
+/// epoch is O(1) - votes from older epochs are only ignored, and dropped
+/// once they make up most of the set.
+///
+/// Users are stored inline in nodes from a pool owned by the counter. Once
+/// the set has reached its working size, voting doesn't allocate.
+class VoteCounter
+{
+public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  /// Older votes are only dropped once there are at least this many users.
+  static constexpr std::size_t PRUNE_SIZE = 4096;
+
+  enum class Result
+  {
+    /// Voting is disabled
+    Ignored,
+    /// The vote was cast before the current epoch started
+    Stale,
+    /// The user already voted
+    Duplicate,
+    Counted,
+    ThresholdReached,
+  };
+
+  explicit VoteCounter(std::size_t threshold);
+
+  VoteCounter(const VoteCounter &) = delete;
+  VoteCounter(VoteCounter &&) noexcept = delete;
+  VoteCounter &operator=(const VoteCounter &) = delete;
+  VoteCounter &operator=(VoteCounter &&) noexcept = delete;
+
+  /// Once the threshold is reached, a new epoch is started.
+  Result vote(std::string_view user);
+  /// Like `vote(user)`, but votes cast before the current epoch started are
+  /// stale. This keeps votes that were still in flight when the track changed
+  /// from counting towards the next one.
+  Result vote(std::string_view user, TimePoint castAt);
+
+  /// Starts a new epoch.
+  void reset();
+  /// Starts a new epoch that only accepts votes cast at or after `since`.
+  void startEpoch(TimePoint since);
+
+  /// The users that voted in the current epoch.
+  std::vector<UserName> voters() const;
+  /// Starts a new epoch in which `voters` already voted. If they reach the
+  /// threshold, the epoch stays empty instead.
+  void restore(std::span<const UserName> voters);
+
+  std::size_t count() const { return this->count_; }
+  std::uint64_t epoch() const { return this->epoch_; }
+
+  std::size_t threshold() const { return this->threshold_; }
+  void setThreshold(std::size_t threshold);
+
+  bool enabled() const { return this->enabled_; }
+  void setEnabled(bool enabled) { this->enabled_ = enabled; }
+
+private:
+  void prune();
+
+  /// Pruned nodes go back here and are reused for new users
+  std::pmr::unsynchronized_pool_resource pool_;
+  /// User -> epoch of their last vote
+  std::pmr::unordered_map<UserName, std::uint64_t, UserName::Hash,
+                          std::equal_to<>>
+      votes_;
+  std::uint64_t epoch_ = 0;
+  TimePoint epochStart_{};
+  std::size_t count_ = 0;
+
+  std::size_t threshold_;
+  bool enabled_ = true;
+};
@@ -1,3 +0,0 @@
-#include "VoteEvent.hpp"
-
-wxDEFINE_EVENT(VOTE_EVENT, VoteEvent);
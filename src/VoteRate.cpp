@@ -0,0 +1,37 @@
+#include "VoteRate.hpp"
+
+void VoteRate::add(Clock::TimePoint now, std::uint32_t count)
+{
+  auto slot = slotOf(now);
+  auto &bucket =
+      this->buckets_[static_cast<std::size_t>(slot) % BUCKET_COUNT];
+  if (bucket.slot != slot)
+  {
+    bucket = {.slot = slot, .count = 0};
+  }
+  bucket.count += count;
+}
+
+double VoteRate::perSecond(Clock::TimePoint now) const
+{
+  auto current = slotOf(now);
+  std::uint64_t total = 0;
+  for (const auto &bucket : this->buckets_)
+  {
+    // stale buckets haven't been overwritten yet
+    if (bucket.slot > current - static_cast<std::int64_t>(BUCKET_COUNT) &&
+        bucket.slot <= current)
+    {
+      total += bucket.count;
+    }
+  }
+  return static_cast<double>(total) /
+         std::chrono::duration<double>(WINDOW).count();
+}
+
+std::int64_t VoteRate::slotOf(Clock::TimePoint time)
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             time.time_since_epoch()) /
+         BUCKET;
+}
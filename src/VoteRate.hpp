@@ -0,0 +1,35 @@
+#pragma once
+
+#include "time/Clock.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/// Counts votes in a sliding window of fixed-size buckets to get the current
+/// votes per second. Adding is O(1), reading is O(`BUCKET_COUNT`).
+class VoteRate
+{
+public:
+  static constexpr auto BUCKET = std::chrono::milliseconds(250);
+  static constexpr std::size_t BUCKET_COUNT = 20;
+  static constexpr auto WINDOW = BUCKET * BUCKET_COUNT;
+
+  void add(Clock::TimePoint now, std::uint32_t count = 1);
+  /// Votes per second over the last `WINDOW`.
+  double perSecond(Clock::TimePoint now) const;
+
+  void reset() { this->buckets_ = {}; }
+
+private:
+  struct Bucket
+  {
+    /// Index of the time slot this bucket currently counts
+    std::int64_t slot = -1;
+    std::uint32_t count = 0;
+  };
+
+  static std::int64_t slotOf(Clock::TimePoint time);
+
+  std::array<Bucket, BUCKET_COUNT> buckets_{};
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "UserName.hpp"
+
+#include <chrono>
+
+struct Vote
+{
+  UserName user;
+  /// When the frame containing the vote was read from the socket
+  std::chrono::steady_clock::time_point receivedAt;
+  /// When the vote was handed to the `VoteSink`
+  std::chrono::steady_clock::time_point publishedAt;
+};
+
+class VoteSink
+{
+public:
+  virtual ~VoteSink() = default;
+
+  /// Called on the IO thread for every message that matches the rules.
+  virtual void publishVote(Vote vote) = 0;
+};
@@ -0,0 +1,105 @@
+#include "VoteState.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+
+constexpr std::array<char, 8> MAGIC = {'S', 'M', 'S', 'V', 'O', 'T', 'E', 1};
+constexpr std::size_t HEADER_SIZE = 24;
+
+template <typename T> void appendRaw(std::string &out, T value)
+{
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> T readRaw(const char *data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+} // namespace
+
+std::string encodeVoteState(const VoteState &state)
+{
+  auto title = std::string_view(state.title)
+                   .substr(0, std::numeric_limits<std::uint16_t>::max());
+
+  std::string out;
+  out.reserve(HEADER_SIZE + title.size() +
+              state.voters.size() * (UserName::MAX_SIZE + 1));
+  out.append(MAGIC.data(), MAGIC.size());
+  appendRaw(out, static_cast<std::uint64_t>(
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         state.savedAt.time_since_epoch())
+                         .count()));
+  appendRaw(out, static_cast<std::uint32_t>(state.voters.size()));
+  appendRaw(out, static_cast<std::uint16_t>(title.size()));
+  appendRaw(out, static_cast<std::uint8_t>(state.enabled));
+  appendRaw(out, std::uint8_t{0});
+  out.append(title);
+
+  for (const auto &voter : state.voters)
+  {
+    auto name = voter.view();
+    appendRaw(out, static_cast<std::uint8_t>(name.size()));
+    out.append(name);
+  }
+  return out;
+}
+
+std::optional<VoteState> decodeVoteState(std::string_view data)
+{
+  if (data.size() < HEADER_SIZE ||
+      std::memcmp(data.data(), MAGIC.data(), MAGIC.size()) != 0)
+  {
+    return std::nullopt;
+  }
+
+  auto saved = readRaw<std::uint64_t>(data.data() + 8);
+  auto voterCount = readRaw<std::uint32_t>(data.data() + 16);
+  auto titleSize = readRaw<std::uint16_t>(data.data() + 20);
+  auto enabled = readRaw<std::uint8_t>(data.data() + 22);
+  data.remove_prefix(HEADER_SIZE);
+  if (data.size() < titleSize)
+  {
+    return std::nullopt;
+  }
+
+  VoteState state{
+      .savedAt = std::chrono::system_clock::time_point(
+          std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              std::chrono::nanoseconds(saved))),
+      .title = std::string(data.substr(0, titleSize)),
+      .enabled = enabled != 0,
+  };
+  data.remove_prefix(titleSize);
+
+  // every voter takes at least a byte
+  state.voters.reserve(std::min<std::size_t>(voterCount, data.size()));
+  for (std::uint32_t i = 0; i < voterCount; i++)
+  {
+    if (data.empty())
+    {
+      return std::nullopt;
+    }
+    auto size = static_cast<std::uint8_t>(data.front());
+    if (size > UserName::MAX_SIZE || data.size() < 1U + size)
+    {
+      return std::nullopt;
+    }
+    state.voters.emplace_back(data.substr(1, size));
+    data.remove_prefix(1U + size);
+  }
+  if (!data.empty())
+  {
+    return std::nullopt;
+  }
+  return state;
+}
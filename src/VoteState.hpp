@@ -0,0 +1,33 @@
+#pragma once
+
+#include "UserName.hpp"
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Vote states are stored as a 24 byte header, the track title and the
+// voters:
+//
+//   header: "SMSVOTE" 0x01 | u64 saved (ns since the Unix epoch)
+//           | u32 voters | u16 title size | u8 enabled | u8 reserved
+//   title:  bytes
+//   voter:  u8 size | bytes
+//
+// Integers are stored in native byte order.
+
+/// The votes of the current epoch, saved so a restart doesn't lose them.
+struct VoteState
+{
+  std::chrono::system_clock::time_point savedAt;
+  /// The track the votes are for
+  std::string title;
+  bool enabled = true;
+  std::vector<UserName> voters;
+};
+
+std::string encodeVoteState(const VoteState &state);
+/// Returns `std::nullopt` if `data` isn't a (complete) vote state.
+std::optional<VoteState> decodeVoteState(std::string_view data);
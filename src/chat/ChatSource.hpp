@@ -0,0 +1,44 @@
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+
+#include <cstddef>
+#include <string_view>
+
+class VoteEngine;
+
+/// A chat message as the vote engine sees it, independent of where it came
+/// from. The views are only valid while the batch is delivered.
+struct ChatMessage
+{
+  /// The login of the sender
+  std::string_view user;
+  std::string_view content;
+  /// Identifies the message across sources (Twitch's `id` tag) - empty if
+  /// the source doesn't know it
+  std::string_view id;
+  bool isSub = false;
+};
+
+/// Something that delivers chat messages to a `VoteEngine` - a Twitch
+/// channel, a replay or a stand-in for tests.
+///
+/// Sources run as coroutines on the IO thread, so they don't need any
+/// locking. A source delivers its messages in batches (e.g. one per frame)
+/// through `VoteEngine::deliver()`.
+class ChatSource
+{
+public:
+  virtual ~ChatSource() = default;
+
+  /// Delivers messages as `source` until the source ran out or `stop()` was
+  /// called.
+  virtual boost::asio::awaitable<void> run(VoteEngine &engine,
+                                           std::size_t source) = 0;
+  /// Cancels whatever the source is waiting for - `run()` returns soon
+  /// after.
+  virtual void stop() = 0;
+
+  /// Called on the IO thread when the rules or the compression changed.
+  virtual void settingsChanged() {}
+};
@@ -0,0 +1,114 @@
+#include "chat/VoteEngine.hpp"
+
+#include "UserName.hpp"
+#include "trace/Startup.hpp"
+
+#include <algorithm>
+
+VoteEngine::VoteEngine(AppContextPtr app, Rules rules,
+                       UserRateLimiter *limiter)
+    : app_(std::move(app)),
+      rules_(std::move(rules)),
+      limiter_(limiter),
+      recent_(RECENT_IDS / WAYS)
+{
+}
+
+std::size_t VoteEngine::addSource()
+{
+  this->delivered_.emplace_back(0);
+  return this->delivered_.size() - 1;
+}
+
+void VoteEngine::deliver(std::size_t source,
+                         std::span<const ChatMessage> messages,
+                         TimePoint receivedAt)
+{
+  using Stage = Metrics::Stage;
+  using Counter = Metrics::Counter;
+  auto &metrics = this->app_->metrics();
+
+  if (messages.empty())
+  {
+    return;
+  }
+  Startup::reach(Startup::Milestone::FirstMessage);
+
+  // a single source never repeats itself
+  bool dedup = this->delivered_.size() > 1;
+  auto before = std::chrono::steady_clock::now();
+  for (const auto &msg : messages)
+  {
+    if (dedup && !msg.id.empty() && !this->remember(msg.id))
+    {
+      metrics.add(Counter::DuplicateMessages);
+      continue;
+    }
+    this->delivered_[source]++;
+
+    if (this->limiter_ != nullptr)
+    {
+      auto checked = this->limiter_->check(msg.user, receivedAt);
+      if (checked == UserRateLimiter::Result::Evicted)
+      {
+        metrics.add(Counter::RateLimiterEvictions);
+      }
+      else if (checked == UserRateLimiter::Result::Limited)
+      {
+        metrics.add(Counter::RateLimited);
+        if (msg.content.starts_with(this->rules_.command))
+        {
+          metrics.add(Counter::RateLimitedVotes);
+        }
+        continue;
+      }
+    }
+
+    bool pass = (this->rules_.allowSubs && msg.isSub) ||
+                (this->rules_.allowNonSubs && !msg.isSub);
+    pass = pass && msg.content.starts_with(this->rules_.command);
+
+    auto matchedAt = std::chrono::steady_clock::now();
+    metrics.record(Stage::Match, matchedAt - before);
+    before = matchedAt;
+
+    if (pass)
+    {
+      metrics.add(Counter::Votes);
+      this->app_->publishVote(Vote{
+          .user = UserName(msg.user),
+          .receivedAt = receivedAt,
+          .publishedAt = matchedAt,
+      });
+      before = std::chrono::steady_clock::now();
+      metrics.record(Stage::Publish, before - matchedAt);
+    }
+  }
+}
+
+bool VoteEngine::remember(std::string_view id)
+{
+  auto key = std::max<std::uint64_t>(UserName::Hash{}(id), 1);
+  auto &set = this->recent_[key % this->recent_.size()];
+  auto now = this->inserted_;
+
+  std::size_t oldest = 0;
+  for (std::size_t i = 0; i < WAYS; i++)
+  {
+    if (set.ids[i] == key)
+    {
+      return false;
+    }
+    // unsigned, so this is correct across the wrap
+    if (set.ids[i] == 0 ||
+        (set.ids[oldest] != 0 &&
+         now - set.insertedAt[i] > now - set.insertedAt[oldest]))
+    {
+      oldest = i;
+    }
+  }
+  set.ids[oldest] = key;
+  set.insertedAt[oldest] = now;
+  this->inserted_++;
+  return true;
+}
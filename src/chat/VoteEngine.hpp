@@ -0,0 +1,84 @@
+#pragma once
+
+#include "AppContext.hpp"
+#include "Rules.hpp"
+#include "chat/ChatSource.hpp"
+#include "irc/UserRateLimiter.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/// Merges the messages of all chat sources into one stream of votes.
+///
+/// Every batch is handled at once on the IO thread, so the messages of a
+/// source keep the order it delivered them in, while batches of different
+/// sources interleave. With more than one source, messages another source
+/// already delivered are dropped by their ID - e.g. when a channel is joined
+/// on two connections. The remaining messages are checked against the rate
+/// limit and the rules, and votes are published to the `AppContext`.
+///
+/// The recently seen IDs live in a fixed-size table split into sets of
+/// `WAYS` entries (like in `UserRateLimiter`), so deduplicating doesn't
+/// allocate. An ID is forgotten once `RECENT_IDS` newer ones pushed it out of
+/// its set.
+class VoteEngine
+{
+public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  static constexpr std::size_t WAYS = 4;
+  static constexpr std::size_t RECENT_IDS = 8192;
+
+  /// Messages from users over the `limiter`'s rate are dropped before they
+  /// are matched.
+  VoteEngine(AppContextPtr app, Rules rules,
+             UserRateLimiter *limiter = nullptr);
+
+  VoteEngine(const VoteEngine &) = delete;
+  VoteEngine(VoteEngine &&) noexcept = delete;
+  VoteEngine &operator=(const VoteEngine &) = delete;
+  VoteEngine &operator=(VoteEngine &&) noexcept = delete;
+
+  /// Returns the ID to pass to `deliver()`.
+  std::size_t addSource();
+  std::size_t sources() const { return this->delivered_.size(); }
+  /// Messages `source` delivered first (i.e. that weren't duplicates)
+  std::uint64_t delivered(std::size_t source) const
+  {
+    return this->delivered_[source];
+  }
+
+  Metrics &metrics() { return this->app_->metrics(); }
+
+  const Rules &rules() const { return this->rules_; }
+  void setRules(Rules rules) { this->rules_ = std::move(rules); }
+
+  /// Handles `messages` that `source` received at `receivedAt`.
+  void deliver(std::size_t source, std::span<const ChatMessage> messages,
+               TimePoint receivedAt);
+
+private:
+  struct alignas(64) IdSet
+  {
+    /// 0 = empty
+    std::array<std::uint64_t, WAYS> ids{};
+    /// When the ID was inserted (in IDs seen so far)
+    std::array<std::uint32_t, WAYS> insertedAt{};
+  };
+
+  /// Remembers `id` - returns false if it was already seen.
+  bool remember(std::string_view id);
+
+  AppContextPtr app_;
+  Rules rules_;
+  UserRateLimiter *limiter_;
+
+  std::vector<std::uint64_t> delivered_;
+  std::vector<IdSet> recent_;
+  std::uint32_t inserted_ = 0;
+};
@@ -1,88 +1,270 @@
 #include "gsmtc/GsmtcWorker.hpp"
 
-#include <wx/log.h>
+#include "log/Log.hpp"
+#include "trace/Trace.hpp"
+
+#include <algorithm>
 
 using namespace winrt::Windows::Foundation;
 using namespace winrt::Windows::Media::Control;
-using namespace std::string_literals;
 
-GsmtcWorker::GsmtcWorker() : manager_(nullptr) {}
+namespace
+{
+
+PlaybackStatus toPlaybackStatus(
+    GlobalSystemMediaTransportControlsSessionPlaybackStatus status)
+{
+  using Status = GlobalSystemMediaTransportControlsSessionPlaybackStatus;
+  switch (status)
+  {
+  case Status::Playing:
+    return PlaybackStatus::Playing;
+  case Status::Paused:
+    return PlaybackStatus::Paused;
+  case Status::Stopped:
+  case Status::Closed:
+    return PlaybackStatus::Stopped;
+  default:
+    return PlaybackStatus::Unknown;
+  }
+}
+
+} // namespace
 
 IAsyncAction GsmtcWorker::init()
 {
-  auto lifetime = this->get_strong();
+  auto lifetime = this->shared_from_this();
   try
   {
     this->manager_ = co_await GlobalSystemMediaTransportControlsSessionManager::
         RequestAsync();
+    this->sessionChanged_ = this->manager_.CurrentSessionChanged(
+        winrt::auto_revoke,
+        [weak = this->weak_from_this()](const auto &, const auto &)
+        {
+          if (auto self = weak.lock())
+          {
+            self->updateSession();
+          }
+        });
+    this->updateSession();
+  }
+  catch (const winrt::hresult_error &ex)
+  {
+    Log::error("Failed to get GSMTC manager: {}",
+               winrt::to_string(ex.message()));
   }
   catch (const std::exception &ex)
   {
-    wxLogMessage("Failed to get GSMTC manager: %s", ex.what());
+    Log::error("Failed to get GSMTC manager: {}", ex.what());
   }
 }
 
-winrt::fire_and_forget GsmtcWorker::skipSong()
+MediaState GsmtcWorker::state() const
 {
-  auto lifetime = this->get_strong();
-  try
+  std::lock_guard lock(this->mtx_);
+  return this->state_;
+}
+
+void GsmtcWorker::skip(SkipCallback done) { this->doSkip(std::move(done)); }
+
+void GsmtcWorker::updateSession()
+{
+  auto session = this->manager_.GetCurrentSession();
+
+  // The old revokers are destroyed after the lock is released.
+  Session::PlaybackInfoChanged_revoker playbackInfoChanged;
+  Session::MediaPropertiesChanged_revoker mediaPropertiesChanged;
+  Session::TimelinePropertiesChanged_revoker timelineChanged;
   {
-    if (!this->manager_)
+    std::lock_guard lock(this->mtx_);
+    if (session == this->session_)
     {
-      wxLogMessage("No GSMTC manager found");
-      co_return;
+      return;
     }
+    playbackInfoChanged = std::move(this->playbackInfoChanged_);
+    mediaPropertiesChanged = std::move(this->mediaPropertiesChanged_);
+    timelineChanged = std::move(this->timelineChanged_);
 
-    co_await winrt::resume_background();
-
-    auto session = this->manager_.GetCurrentSession();
+    this->session_ = session;
+    this->state_ = {.hasSession = static_cast<bool>(session)};
+    this->seekTarget_.reset();
     if (!session)
     {
-      wxLogMessage("No app is playing any song");
+      return;
+    }
+
+    auto weak = this->weak_from_this();
+    this->playbackInfoChanged_ = session.PlaybackInfoChanged(
+        winrt::auto_revoke,
+        [weak](const Session &sender, const auto &)
+        {
+          if (auto self = weak.lock())
+          {
+            self->updatePlaybackInfo(sender);
+          }
+        });
+    this->mediaPropertiesChanged_ = session.MediaPropertiesChanged(
+        winrt::auto_revoke,
+        [weak](const Session &sender, const auto &)
+        {
+          if (auto self = weak.lock())
+          {
+            self->updateMediaProperties(sender);
+          }
+        });
+    this->timelineChanged_ = session.TimelinePropertiesChanged(
+        winrt::auto_revoke,
+        [weak](const Session &sender, const auto &)
+        {
+          if (auto self = weak.lock())
+          {
+            self->updateTimeline(sender);
+          }
+        });
+  }
+
+  this->updatePlaybackInfo(session);
+  this->updateTimeline(session);
+  this->updateMediaProperties(session);
+}
+
+void GsmtcWorker::updatePlaybackInfo(const Session &session)
+{
+  auto status = PlaybackStatus::Unknown;
+  auto info = session.GetPlaybackInfo();
+  if (info)
+  {
+    status = toPlaybackStatus(info.PlaybackStatus());
+  }
+
+  std::lock_guard lock(this->mtx_);
+  if (session == this->session_)
+  {
+    this->state_.status = status;
+  }
+}
+
+void GsmtcWorker::updateTimeline(const Session &session)
+{
+  std::optional<TimeSpan> target;
+  auto timeline = session.GetTimelineProperties();
+  if (timeline)
+  {
+    target = std::max(timeline.MaxSeekTime(), timeline.EndTime());
+  }
+
+  std::lock_guard lock(this->mtx_);
+  if (session == this->session_)
+  {
+    this->seekTarget_ = target;
+  }
+}
+
+winrt::fire_and_forget GsmtcWorker::updateMediaProperties(Session session)
+{
+  auto lifetime = this->shared_from_this();
+  try
+  {
+    auto properties = co_await session.TryGetMediaPropertiesAsync();
+    if (!properties)
+    {
       co_return;
     }
-    auto playbackInfo = session.GetPlaybackInfo();
-    if (playbackInfo)
+    auto title = winrt::to_string(properties.Title());
+
+    std::optional<MediaState> changed;
     {
-      if (playbackInfo.PlaybackStatus() !=
-          GlobalSystemMediaTransportControlsSessionPlaybackStatus::Playing)
+      std::lock_guard lock(this->mtx_);
+      if (session == this->session_ && title != this->state_.title)
       {
-        wxLogMessage("Current app isn't playing any song");
-        co_return;
+        this->state_.title = std::move(title);
+        if (!this->state_.title.empty())
+        {
+          changed = this->state_;
+        }
       }
     }
-
-    std::string title = "[?]"s;
-    auto mediaProperties = co_await session.TryGetMediaPropertiesAsync();
-    if (mediaProperties)
+    if (changed)
     {
-      title = winrt::to_string(mediaProperties.Title());
+      this->notifyTrackChanged(*changed);
     }
+  }
+  catch (const winrt::hresult_error &ex)
+  {
+    Log::warn("Failed to get media properties: {}",
+              winrt::to_string(ex.message()));
+  }
+}
+
+winrt::fire_and_forget GsmtcWorker::doSkip(SkipCallback done)
+{
+  auto lifetime = this->shared_from_this();
+  co_await winrt::resume_background();
+  AsyncTraceSpan span("skip", "media");
+
+  Session session{nullptr};
+  MediaState state;
+  std::optional<TimeSpan> seekTarget;
+  {
+    std::lock_guard lock(this->mtx_);
+    session = this->session_;
+    state = this->state_;
+    seekTarget = this->seekTarget_;
+  }
+  if (state.title.empty())
+  {
+    state.title = "[?]";
+  }
 
-    // This is specifically for YouTube which does not register
-    // a handler for 'nexttrack' and for some reason, GSMTC thinks
-    // we skip the current song.
-    //
-    // Here, we try to seek to the end of the song first and then skip it.
-    auto tl = session.GetTimelineProperties();
-    if (tl)
+  auto outcome = SkipOutcome::Failed;
+  try
+  {
+    if (!session)
     {
-      auto target = std::max(tl.MaxSeekTime(), tl.EndTime());
-      co_await session.TryChangePlaybackPositionAsync(target.count());
+      Log::info("No app is playing any song");
+      outcome = SkipOutcome::NoSession;
     }
-
-    auto skipped = co_await session.TrySkipNextAsync();
-    if (skipped)
+    else if (state.status != PlaybackStatus::Unknown &&
+             state.status != PlaybackStatus::Playing)
     {
-      wxLogMessage("Skipped %s", title);
+      Log::info("Current app isn't playing any song");
+      outcome = SkipOutcome::NotPlaying;
     }
     else
     {
-      wxLogMessage("Failed to skip %s", title);
+      // This is specifically for YouTube which does not register
+      // a handler for 'nexttrack' and for some reason, GSMTC thinks
+      // we skip the current song.
+      //
+      // Here, we try to seek to the end of the song first and then skip it.
+      if (seekTarget)
+      {
+        co_await session.TryChangePlaybackPositionAsync(seekTarget->count());
+      }
+
+      if (co_await session.TrySkipNextAsync())
+      {
+        Log::info("Skipped {}", state.title);
+        outcome = SkipOutcome::Skipped;
+      }
+      else
+      {
+        Log::warn("Failed to skip {}", state.title);
+      }
     }
   }
+  catch (const winrt::hresult_error &ex)
+  {
+    Log::error("Failed to skip song: {}", winrt::to_string(ex.message()));
+  }
   catch (const std::exception &ex)
   {
-    wxLogMessage("Failed to skip song: %s", ex.what());
+    Log::error("Failed to skip song: {}", ex.what());
+  }
+
+  if (done)
+  {
+    done(outcome);
   }
 }
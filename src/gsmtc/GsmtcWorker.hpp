@@ -1,19 +1,56 @@
 #pragma once
 
+#include "media/MediaController.hpp"
+
 #include <winrt/Windows.Foundation.h>
 #include <winrt/Windows.Media.Control.h>
 
-class GsmtcWorker
-    : public winrt::implements<GsmtcWorker,
-                               winrt::Windows::Foundation::IInspectable>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+/// Controls the current session of the Global System Media Transport
+/// Controls (GSMTC).
+///
+/// The current session, its playback status, title and timeline are cached
+/// and updated by the manager's/session's change events (on WinRT's thread
+/// pool), so a skip only has to talk to an already known session. A new
+/// title counts as a new track.
+class GsmtcWorker : public MediaController,
+                    public std::enable_shared_from_this<GsmtcWorker>
 {
 public:
-  GsmtcWorker();
+  GsmtcWorker() = default;
+
+  /// Must be called once the worker is owned by a `shared_ptr`.
   winrt::Windows::Foundation::IAsyncAction init();
 
-  winrt::fire_and_forget skipSong();
+  MediaState state() const override;
+  void skip(SkipCallback done) override;
 
 private:
-  winrt::Windows::Media::Control::
-      GlobalSystemMediaTransportControlsSessionManager manager_;
+  using Manager = winrt::Windows::Media::Control::
+      GlobalSystemMediaTransportControlsSessionManager;
+  using Session =
+      winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSession;
+  using TimeSpan = winrt::Windows::Foundation::TimeSpan;
+
+  void updateSession();
+  void updatePlaybackInfo(const Session &session);
+  void updateTimeline(const Session &session);
+  winrt::fire_and_forget updateMediaProperties(Session session);
+
+  winrt::fire_and_forget doSkip(SkipCallback done);
+
+  Manager manager_{nullptr};
+  Manager::CurrentSessionChanged_revoker sessionChanged_;
+
+  mutable std::mutex mtx_;
+  Session session_{nullptr};
+  Session::PlaybackInfoChanged_revoker playbackInfoChanged_;
+  Session::MediaPropertiesChanged_revoker mediaPropertiesChanged_;
+  Session::TimelinePropertiesChanged_revoker timelineChanged_;
+  MediaState state_;
+  /// Where to seek to before skipping (see `doSkip`)
+  std::optional<TimeSpan> seekTarget_;
 };
@@ -0,0 +1,24 @@
+#include "irc/Backoff.hpp"
+
+#include <algorithm>
+
+Backoff::Backoff(Duration initial, Duration max, std::uint32_t seed)
+    : initial_(initial),
+      max_(max),
+      rng_(seed)
+{
+}
+
+Backoff::Duration Backoff::next()
+{
+  auto delay = this->initial_;
+  for (std::uint32_t i = 0; i < this->attempts_ && delay < this->max_; i++)
+  {
+    delay *= 2;
+  }
+  delay = std::min(delay, this->max_);
+  this->attempts_++;
+
+  std::uniform_int_distribution<Duration::rep> jitter(0, delay.count() / 2);
+  return delay - Duration(jitter(this->rng_));
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+/// Exponential backoff with jitter for reconnects.
+///
+/// The n-th delay is drawn from [d/2, d] where d = min(max, initial * 2^n).
+class Backoff
+{
+public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  Backoff(Duration initial, Duration max,
+          std::uint32_t seed = std::random_device{}());
+
+  Duration next();
+  void reset() { this->attempts_ = 0; }
+
+  std::uint32_t attempts() const { return this->attempts_; }
+
+private:
+  Duration initial_;
+  Duration max_;
+  std::uint32_t attempts_ = 0;
+  std::minstd_rand rng_;
+};
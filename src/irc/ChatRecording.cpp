@@ -0,0 +1,137 @@
+#include "irc/ChatRecording.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+
+constexpr std::array<char, 8> MAGIC = {'S', 'M', 'S', 'R', 'E', 'C', 0, 1};
+constexpr std::size_t HEADER_SIZE = 16;
+constexpr std::size_t FRAME_HEADER_SIZE = 16;
+constexpr std::size_t ALIGNMENT = 8;
+
+constexpr std::size_t padding(std::size_t size)
+{
+  return (ALIGNMENT - (size % ALIGNMENT)) % ALIGNMENT;
+}
+
+template <typename T> void writeRaw(std::ofstream &out, T value)
+{
+  out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> T readRaw(const char *data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+} // namespace
+
+ChatRecorder::ChatRecorder(const std::filesystem::path &path)
+    : out_(path, std::ios::binary | std::ios::trunc),
+      start_(std::chrono::steady_clock::now()),
+      lastFlush_(this->start_)
+{
+  if (!this->out_)
+  {
+    throw std::runtime_error("Failed to create " + path.string());
+  }
+
+  auto startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+  this->out_.write(MAGIC.data(), MAGIC.size());
+  writeRaw(this->out_, static_cast<std::uint64_t>(startNs));
+}
+
+void ChatRecorder::append(std::string_view frame,
+                          std::chrono::steady_clock::time_point receivedAt)
+{
+  auto offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      receivedAt - this->start_);
+  writeRaw(this->out_, static_cast<std::uint64_t>(offset.count()));
+  writeRaw(this->out_, static_cast<std::uint32_t>(frame.size()));
+  writeRaw(this->out_, std::uint32_t{0});
+  this->out_.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+
+  constexpr std::array<char, ALIGNMENT> zeros{};
+  this->out_.write(zeros.data(),
+                   static_cast<std::streamsize>(padding(frame.size())));
+
+  // The rest is written when the client is stopped and destroys the
+  // recorder - flushing only limits what a crash loses.
+  if (receivedAt - this->lastFlush_ > std::chrono::seconds(1))
+  {
+    this->out_.flush();
+    this->lastFlush_ = receivedAt;
+  }
+}
+
+ChatReplay::ChatReplay(const std::filesystem::path &path)
+    : file_(path.string().c_str(), boost::interprocess::read_only),
+      region_(this->file_, boost::interprocess::read_only),
+      pos_(HEADER_SIZE)
+{
+  if (this->region_.get_size() < HEADER_SIZE ||
+      std::memcmp(this->region_.get_address(), MAGIC.data(), MAGIC.size()) !=
+          0)
+  {
+    throw std::runtime_error(path.string() + " is not a recording");
+  }
+}
+
+std::optional<ChatReplay::Frame> ChatReplay::next()
+{
+  const auto *base = static_cast<const char *>(this->region_.get_address());
+  auto size = this->region_.get_size();
+  if (this->pos_ + FRAME_HEADER_SIZE > size)
+  {
+    return std::nullopt;
+  }
+
+  auto offset = readRaw<std::uint64_t>(base + this->pos_);
+  auto frameSize = readRaw<std::uint32_t>(base + this->pos_ + 8);
+  auto dataPos = this->pos_ + FRAME_HEADER_SIZE;
+  if (dataPos + frameSize > size)
+  {
+    return std::nullopt; // truncated
+  }
+
+  this->pos_ = dataPos + frameSize + padding(frameSize);
+  return Frame{
+      .offset = std::chrono::nanoseconds(offset),
+      .data = {base + dataPos, frameSize},
+  };
+}
+
+void ChatReplay::rewind()
+{
+  this->pos_ = HEADER_SIZE;
+  this->pending_.clear();
+  this->budget_ = ReceiveBudget();
+}
+
+MessageHandler::Result
+ChatReplay::feed(const Frame &frame, MessageHandler &handler,
+                 std::chrono::steady_clock::time_point receivedAt)
+{
+  this->replies_.clear();
+  if (this->pending_.empty())
+  {
+    auto data = frame.data.substr(this->budget_.skip(frame.data));
+    auto result = handler.handle(data, receivedAt, this->replies_);
+    auto rest = data.substr(result.consumed);
+    this->pending_.assign(rest.substr(this->budget_.limit(rest)));
+    return result;
+  }
+
+  this->pending_.append(frame.data);
+  auto result = handler.handle(this->pending_, receivedAt, this->replies_);
+  this->pending_.erase(0, result.consumed);
+  this->pending_.erase(0, this->budget_.limit(this->pending_));
+  return result;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "irc/MessageHandler.hpp"
+#include "irc/ReceiveBudget.hpp"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// A recording is a 16 byte header followed by 8 byte aligned frames:
+//
+//   header: "SMSREC" 0x00 0x01 | u64 start (ns since the Unix epoch)
+//   frame:  u64 offset (ns since start) | u32 size | u32 reserved | data
+//
+// Integers are stored in native byte order.
+
+/// Appends raw WebSocket frames to a recording.
+class ChatRecorder
+{
+public:
+  /// Throws if the file can't be created.
+  explicit ChatRecorder(const std::filesystem::path &path);
+
+  void append(std::string_view frame,
+              std::chrono::steady_clock::time_point receivedAt);
+
+private:
+  std::ofstream out_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point lastFlush_;
+};
+
+/// Reads a recording through a memory mapping.
+class ChatReplay
+{
+public:
+  struct Frame
+  {
+    std::chrono::nanoseconds offset;
+    std::string_view data;
+  };
+
+  /// Throws if the file can't be mapped or isn't a recording.
+  explicit ChatReplay(const std::filesystem::path &path);
+
+  std::optional<Frame> next();
+  void rewind();
+
+  /// Feeds `frame` into `handler`. Messages split across frames are
+  /// reassembled (within a `ReceiveBudget`), replies are discarded.
+  MessageHandler::Result feed(const Frame &frame, MessageHandler &handler,
+                              std::chrono::steady_clock::time_point receivedAt);
+
+private:
+  boost::interprocess::file_mapping file_;
+  boost::interprocess::mapped_region region_;
+  std::size_t pos_;
+
+  std::string pending_;
+  std::pmr::string replies_;
+  ReceiveBudget budget_;
+};
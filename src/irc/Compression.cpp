@@ -0,0 +1,75 @@
+#include "irc/Compression.hpp"
+
+#include "irc/OptionSpec.hpp"
+
+namespace
+{
+
+using namespace std::string_view_literals;
+
+bool parseWindowBits(std::string_view value, int &target)
+{
+  int bits = 0;
+  if (!parseNumber(value, bits) || bits < Compression::MIN_WINDOW_BITS ||
+      bits > Compression::MAX_WINDOW_BITS)
+  {
+    return false;
+  }
+  target = bits;
+  return true;
+}
+
+} // namespace
+
+std::optional<Compression> Compression::parse(std::string_view spec)
+{
+  Compression compression;
+  for (auto [key, value] : splitOptions(spec))
+  {
+    bool ok = true;
+    if (key == "on"sv)
+    {
+      compression.enabled = true;
+    }
+    else if (key == "off"sv)
+    {
+      compression.enabled = false;
+    }
+    else if (key == "window"sv)
+    {
+      ok = parseWindowBits(value, compression.serverMaxWindowBits) &&
+           parseWindowBits(value, compression.clientMaxWindowBits);
+    }
+    else if (key == "server-window"sv)
+    {
+      ok = parseWindowBits(value, compression.serverMaxWindowBits);
+    }
+    else if (key == "client-window"sv)
+    {
+      ok = parseWindowBits(value, compression.clientMaxWindowBits);
+    }
+    else if (key == "no-context-takeover"sv)
+    {
+      compression.serverNoContextTakeover = true;
+      compression.clientNoContextTakeover = true;
+    }
+    else if (key == "server-no-context-takeover"sv)
+    {
+      compression.serverNoContextTakeover = true;
+    }
+    else if (key == "client-no-context-takeover"sv)
+    {
+      compression.clientNoContextTakeover = true;
+    }
+    else
+    {
+      ok = false;
+    }
+
+    if (!ok)
+    {
+      return std::nullopt;
+    }
+  }
+  return compression;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+/// `permessage-deflate` (RFC 7692) settings of the chat WebSocket.
+///
+/// IRC lines with tags compress well, so compression is on by default. Smaller
+/// windows and no context takeover use less memory per connection at the cost
+/// of a worse ratio.
+struct Compression
+{
+  static constexpr int MIN_WINDOW_BITS = 9;
+  static constexpr int MAX_WINDOW_BITS = 15;
+
+  bool enabled = true;
+  /// The server compresses with a window of 2^bits bytes
+  int serverMaxWindowBits = MAX_WINDOW_BITS;
+  /// We compress with a window of 2^bits bytes
+  int clientMaxWindowBits = MAX_WINDOW_BITS;
+  /// Asks the server to start every message with an empty window
+  bool serverNoContextTakeover = false;
+  bool clientNoContextTakeover = false;
+
+  bool operator==(const Compression &) const = default;
+
+  /// Parses a comma separated list of `on`, `off`, `window=<bits>`,
+  /// `server-window=<bits>`, `client-window=<bits>`, `no-context-takeover`,
+  /// `server-no-context-takeover` and `client-no-context-takeover`
+  /// (e.g. `window=12,no-context-takeover`).
+  static std::optional<Compression> parse(std::string_view spec);
+};
@@ -0,0 +1,100 @@
+#include "irc/ConnectionHealth.hpp"
+
+#include <charconv>
+
+namespace
+{
+
+/// The average moves by 1/weight of the difference per sample
+constexpr std::size_t RTT_WEIGHT = 4;
+constexpr std::size_t LAG_WEIGHT = 16;
+/// Samples before the baseline is set
+constexpr std::size_t RTT_WARM_UP = 2;
+constexpr std::size_t LAG_WARM_UP = 16;
+
+} // namespace
+
+void ConnectionHealth::Signal::add(Duration sample, std::size_t weight,
+                                   std::size_t warmUp)
+{
+  if (!this->value)
+  {
+    this->value = sample;
+  }
+  else
+  {
+    *this->value +=
+        (sample - *this->value) / static_cast<Duration::rep>(weight);
+  }
+
+  this->samples++;
+  if (this->samples >= warmUp &&
+      (!this->baseline || *this->value < *this->baseline))
+  {
+    this->baseline = this->value;
+  }
+}
+
+bool ConnectionHealth::Signal::degraded(Duration slack) const
+{
+  return this->value && this->baseline &&
+         *this->value - *this->baseline > slack;
+}
+
+ConnectionHealth::ConnectionHealth(Config config) : config_(config) {}
+
+std::optional<std::uint64_t> ConnectionHealth::ping(TimePoint now)
+{
+  if (this->pendingSince_)
+  {
+    return std::nullopt; // the timeout is measured from the first one
+  }
+  this->pendingSince_ = now;
+  return ++this->lastPing_;
+}
+
+std::optional<ConnectionHealth::Duration>
+ConnectionHealth::pong(std::string_view payload, TimePoint now)
+{
+  std::uint64_t id = 0;
+  auto [ptr, ec] =
+      std::from_chars(payload.data(), payload.data() + payload.size(), id);
+  if (ec != std::errc{} || id != this->lastPing_ || !this->pendingSince_)
+  {
+    return std::nullopt; // not ours
+  }
+
+  auto rtt = now - *this->pendingSince_;
+  this->pendingSince_.reset();
+  this->rtt_.add(rtt, RTT_WEIGHT, RTT_WARM_UP);
+  return rtt;
+}
+
+void ConnectionHealth::deliveryLag(std::chrono::milliseconds lag)
+{
+  this->lag_.add(lag, LAG_WEIGHT, LAG_WARM_UP);
+  this->freshLag_++;
+}
+
+ConnectionHealth::Verdict ConnectionHealth::check(TimePoint now)
+{
+  if (this->pendingSince_ &&
+      now - *this->pendingSince_ > this->config_.pongTimeout)
+  {
+    return Verdict::Unhealthy;
+  }
+
+  bool degraded = this->rtt_.degraded(RTT_SLACK) ||
+                  (this->freshLag_ > 0 && this->lag_.degraded(LAG_SLACK));
+  this->freshLag_ = 0;
+  if (!degraded)
+  {
+    this->degraded_ = 0;
+    return Verdict::Healthy;
+  }
+
+  this->degraded_++;
+  return this->degraded_ >= this->config_.degradedChecks
+             ? Verdict::Unhealthy
+             : Verdict::Degraded;
+}
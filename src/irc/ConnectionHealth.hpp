@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/// Tracks the latency of a single chat connection and decides when it should
+/// be replaced.
+///
+/// Two signals are smoothed: the round-trip time of our own PINGs and the
+/// delivery lag of chat messages (receive time - `tmi-sent-ts`). Both are
+/// compared against the best value seen on this connection rather than
+/// against fixed limits - the lag includes the clock offset to Twitch, which
+/// cancels out this way. A connection is degraded once either signal is
+/// more than its slack above the baseline, and should be replaced after
+/// `degradedChecks` degraded checks in a row or if a PING goes unanswered.
+class ConnectionHealth
+{
+public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+  using Duration = std::chrono::steady_clock::duration;
+
+  static constexpr auto RTT_SLACK = std::chrono::milliseconds(300);
+  static constexpr auto LAG_SLACK = std::chrono::seconds(2);
+
+  struct Config
+  {
+    /// How often a PING is sent (and the health checked)
+    std::chrono::milliseconds pingInterval = std::chrono::seconds(15);
+    /// A PING that isn't answered within this means the connection is dead
+    std::chrono::milliseconds pongTimeout = std::chrono::seconds(10);
+    /// Replace the connection after this many degraded checks in a row
+    std::size_t degradedChecks = 4;
+
+    bool operator==(const Config &) const = default;
+  };
+
+  enum class Verdict : std::uint8_t
+  {
+    Healthy,
+    Degraded,
+    /// Replace the connection
+    Unhealthy,
+  };
+
+  explicit ConnectionHealth(Config config);
+
+  /// Returns the payload of the PING to send now - or nothing if the last
+  /// one is still unanswered.
+  std::optional<std::uint64_t> ping(TimePoint now);
+  /// Handles the payload of a PONG. Returns the round-trip time if it
+  /// answered our PING.
+  std::optional<Duration> pong(std::string_view payload, TimePoint now);
+  /// The delivery lag of the newest message in a frame (may be negative if
+  /// our clock is behind).
+  void deliveryLag(std::chrono::milliseconds lag);
+
+  /// Called before every PING.
+  Verdict check(TimePoint now);
+
+  const Config &config() const { return this->config_; }
+  /// Smoothed round-trip time
+  std::optional<Duration> rtt() const { return this->rtt_.value; }
+  /// Smoothed delivery lag
+  std::optional<Duration> lag() const { return this->lag_.value; }
+
+private:
+  /// An exponentially weighted moving average and the lowest value it had
+  struct Signal
+  {
+    std::optional<Duration> value;
+    std::optional<Duration> baseline;
+    std::size_t samples = 0;
+
+    void add(Duration sample, std::size_t weight, std::size_t warmUp);
+    bool degraded(Duration slack) const;
+  };
+
+  Config config_;
+  Signal rtt_;
+  Signal lag_;
+  /// Lag samples since the last check - stale lag doesn't count
+  std::size_t freshLag_ = 0;
+
+  std::uint64_t lastPing_ = 0;
+  std::optional<TimePoint> pendingSince_;
+  std::size_t degraded_ = 0;
+};
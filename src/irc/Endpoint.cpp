@@ -0,0 +1,59 @@
+#include "irc/Endpoint.hpp"
+
+namespace
+{
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+} // namespace
+
+Endpoint Endpoint::twitch()
+{
+  return {
+      .host = "irc-ws.chat.twitch.tv"s,
+      .port = "443"s,
+      .path = "/"s,
+      .secure = true,
+  };
+}
+
+std::optional<Endpoint> Endpoint::parse(std::string_view url)
+{
+  Endpoint endpoint;
+  if (url.starts_with("wss://"sv))
+  {
+    endpoint.secure = true;
+    endpoint.port = "443"s;
+    url.remove_prefix(6);
+  }
+  else if (url.starts_with("ws://"sv))
+  {
+    endpoint.secure = false;
+    endpoint.port = "80"s;
+    url.remove_prefix(5);
+  }
+  else
+  {
+    return std::nullopt;
+  }
+
+  auto slash = url.find('/');
+  auto authority = url.substr(0, slash);
+  endpoint.path =
+      slash == std::string_view::npos ? "/"s : std::string(url.substr(slash));
+
+  auto colon = authority.rfind(':');
+  if (colon != std::string_view::npos)
+  {
+    endpoint.port = std::string(authority.substr(colon + 1));
+    authority = authority.substr(0, colon);
+  }
+  if (authority.empty() || endpoint.port.empty())
+  {
+    return std::nullopt;
+  }
+  endpoint.host = std::string(authority);
+
+  return endpoint;
+}
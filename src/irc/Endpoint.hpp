@@ -0,0 +1,18 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+struct Endpoint
+{
+  std::string host;
+  std::string port;
+  std::string path;
+  bool secure = true;
+
+  static Endpoint twitch();
+
+  /// Parses a `ws://` or `wss://` URL (e.g. `ws://127.0.0.1:6667/`).
+  static std::optional<Endpoint> parse(std::string_view url);
+};
@@ -0,0 +1,33 @@
+#include "irc/FrameArena.hpp"
+
+FrameArena::FrameArena()
+    : arena_(this->buffer_.data(), this->buffer_.size(), &this->upstream_)
+{
+}
+
+bool FrameArena::reset()
+{
+  this->arena_.release();
+  bool overflowed = this->upstream_.allocations != this->lastOverflows_;
+  this->lastOverflows_ = this->upstream_.allocations;
+  return overflowed;
+}
+
+void *FrameArena::Upstream::do_allocate(std::size_t bytes,
+                                        std::size_t alignment)
+{
+  this->allocations++;
+  return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void FrameArena::Upstream::do_deallocate(void *ptr, std::size_t bytes,
+                                         std::size_t alignment)
+{
+  std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+}
+
+bool FrameArena::Upstream::do_is_equal(
+    const memory_resource &other) const noexcept
+{
+  return this == &other;
+}
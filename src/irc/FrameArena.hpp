@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+
+/// Memory for everything that only lives while a single frame is handled
+/// (e.g. the replies to it).
+///
+/// Allocations are bumped out of an inline buffer and dropped all at once by
+/// `reset()`. Only frames that outgrow the buffer reach the heap.
+class FrameArena
+{
+public:
+  static constexpr std::size_t INLINE_SIZE = 16 * 1024;
+
+  FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena(FrameArena &&) noexcept = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+  FrameArena &operator=(FrameArena &&) noexcept = delete;
+
+  std::pmr::memory_resource *resource() { return &this->arena_; }
+
+  /// Releases everything allocated since the last reset. Returns true if the
+  /// frame didn't fit into the inline buffer.
+  bool reset();
+
+  /// Number of heap allocations the arena made
+  std::size_t overflows() const { return this->upstream_.allocations; }
+
+private:
+  /// Counts the allocations that went past the inline buffer.
+  class Upstream : public std::pmr::memory_resource
+  {
+  public:
+    std::size_t allocations = 0;
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void *ptr, std::size_t bytes,
+                       std::size_t alignment) override;
+    bool do_is_equal(const memory_resource &other) const noexcept override;
+  };
+
+  alignas(std::max_align_t) std::array<std::byte, INLINE_SIZE> buffer_;
+  Upstream upstream_;
+  std::pmr::monotonic_buffer_resource arena_;
+  std::size_t lastOverflows_ = 0;
+};
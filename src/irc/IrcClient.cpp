@@ -1,27 +1,51 @@
 #include "irc/IrcClient.hpp"
 
-#include "irc/IrcParser.hpp"
+#include "chat/ChatSource.hpp"
+#include "chat/VoteEngine.hpp"
+#include "irc/Backoff.hpp"
+#include "irc/ChatRecording.hpp"
+#include "irc/ConnectionHealth.hpp"
+#include "irc/Endpoint.hpp"
+#include "irc/FrameArena.hpp"
+#include "irc/MessageHandler.hpp"
+#include "irc/ReceiveBudget.hpp"
+#include "irc/Reconnector.hpp"
+#include "log/Log.hpp"
+#include "time/AsioClock.hpp"
+#include "trace/Startup.hpp"
+#include "trace/Trace.hpp"
 
 #ifdef __clang__
 #define BOOST_ASIO_HAS_CO_AWAIT 1
 #endif
 
-#include <wx/log.h>
-
 #include <boost/asio.hpp>
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/co_spawn.hpp>
 #include <boost/asio/detached.hpp>
-#include <boost/asio/experimental/awaitable_operators.hpp>
 #include <boost/asio/experimental/channel.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/use_awaitable.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
+
+#ifdef _WIN32
 #include <boost/wintls.hpp>
+#endif
 
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <optional>
 #include <print>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
+#ifdef _WIN32
 namespace boost::beast
 {
 
@@ -77,11 +101,14 @@ void async_teardown(role_type role, boost::wintls::stream<AsyncStream> &stream,
 }
 
 } // namespace boost::beast
+#endif
 
 namespace
 {
 
+#ifdef _WIN32
 namespace wintls = boost::wintls;
+#endif
 namespace ip = boost::asio::ip;
 namespace asio = boost::asio;
 namespace beast = boost::beast;
@@ -95,22 +122,55 @@ using asio::use_awaitable;
 using asio::experimental::channel;
 using boost::system::error_code;
 using ip::tcp;
-using WebSocketStream =
-    websocket::stream<wintls::stream<beast::tcp_stream::rebind_executor<
-        asio::use_awaitable_t<>::executor_with_default<asio::any_io_executor>>::
-                                         other>>;
 
-using namespace boost::asio::experimental::awaitable_operators;
+/// How long a graceful close may take before reconnecting
+constexpr auto CLOSE_TIMEOUT = std::chrono::seconds(5);
+
+/// Doesn't limit anything, but counts the bytes read from the socket. With
+/// compression, these are fewer than the payload bytes.
+class WireCounter
+{
+public:
+  void setMetrics(Metrics *metrics) { this->metrics_ = metrics; }
+
+private:
+  friend class beast::rate_policy_access;
+
+  static constexpr std::size_t ALL = std::numeric_limits<std::size_t>::max();
+
+  std::size_t available_read_bytes() const noexcept { return ALL; }
+  std::size_t available_write_bytes() const noexcept { return ALL; }
+  void transfer_read_bytes(std::size_t n) const noexcept
+  {
+    if (this->metrics_ != nullptr)
+    {
+      this->metrics_->add(Metrics::Counter::WireBytes, n);
+    }
+  }
+  void transfer_write_bytes(std::size_t /*n*/) const noexcept {}
+  void on_timer() const noexcept {}
+
+  Metrics *metrics_ = nullptr;
+};
+
+using TcpStream = beast::basic_stream<
+    tcp, asio::use_awaitable_t<>::executor_with_default<asio::any_io_executor>,
+    WireCounter>;
+using PlainWebSocketStream = websocket::stream<TcpStream>;
+#ifdef _WIN32
+using TlsWebSocketStream = websocket::stream<wintls::stream<TcpStream>>;
+#endif
+
 using namespace std::string_literals;
 
 void fail(beast::error_code ec, char const *what)
 {
-  wxLogMessage("%s: %s", what, ec.message());
+  Log::error("{}: {}", what, ec.message());
 }
 
 void fail(const std::exception &ex, char const *what)
 {
-  wxLogMessage("%s: %s", what, ex.what());
+  Log::error("{}: {}", what, ex.what());
 }
 
 asio::redirect_error_t<asio::use_awaitable_t<asio::any_io_executor>>
@@ -119,6 +179,12 @@ await_ec(auto &target)
   return asio::redirect_error(use_awaitable, target);
 }
 
+std::string_view bufferView(const beast::flat_buffer &buf)
+{
+  auto data = buf.cdata();
+  return {static_cast<const char *>(data.data()), data.size()};
+}
+
 auto logOrDie(auto action)
 {
   return [action](const std::exception_ptr &e) noexcept
@@ -137,110 +203,261 @@ auto logOrDie(auto action)
   };
 }
 
-struct Endpoint
-{
-  std::string host;
-  std::string port;
-  std::string path;
-};
-
-class WebSocketSession
+template <typename Stream> class WebSocketSession
 {
 public:
-  WebSocketSession(AppContextPtr app, io_context &ctx,
-                   wintls::context &sslContext);
+  /// Joins `channel`, or the channel from the rules if it's empty.
+  template <typename... StreamArgs>
+  WebSocketSession(AppContextPtr app, io_context &ctx, Clock &clock,
+                   VoteEngine &engine, std::size_t source,
+                   std::optional<std::string> channel,
+                   const ConnectionHealth::Config &health,
+                   ChatRecorder *recorder, StreamArgs &...streamArgs);
 
   awaitable<void> run(const Endpoint &endpoint);
   awaitable<void> teardown();
 
+  /// Cancels whatever the session is waiting for. An open connection is
+  /// then closed gracefully, but only for `STOP_CLOSE_TIMEOUT`.
+  void stop();
+  /// Reconnects if the compression changed, or joins another channel if the
+  /// rules did.
+  void settingsChanged() { this->settingsChanged_.try_send(); }
+  /// The connection was closed because the compression changed - there's
+  /// nothing to back off from.
+  bool closedForSettings() const { return this->closedForSettings_; }
+
+  /// Completes once the tasks spawned by `run()` returned.
+  awaitable<void> joinTasks();
+
 private:
   awaitable<void> connect(const Endpoint &endpoint);
   awaitable<void> initConnection();
   awaitable<void> listenIrc();
-  awaitable<error_code> parseMessages(beast::flat_buffer &buf);
+  awaitable<error_code>
+  parseMessages(beast::flat_buffer &buf,
+                std::chrono::steady_clock::time_point receivedAt);
 
   awaitable<void> feedMessages();
+  /// Sends a PING every `pingInterval` and closes the connection once it's
+  /// unhealthy.
+  awaitable<void> monitorHealth();
+
+  awaitable<error_code> write(std::string_view msg);
 
-  awaitable<error_code> write(const std::string &msg);
+  const std::string &targetChannel() const
+  {
+    return this->fixedChannel_ ? *this->fixedChannel_ : this->rules_.channel;
+  }
+
+  static constexpr bool IS_TLS =
+      !std::is_same_v<typename Stream::next_layer_type, TcpStream>;
 
   AppContextPtr app_;
   Rules rules_;
+  Compression compression_;
+  std::optional<std::string> fixedChannel_;
   std::string lastChannel_;
+  ConnectionHealth health_;
+  MessageHandler handler_;
+  /// Reset after each frame is handled
+  FrameArena arena_;
+  ReceiveBudget budget_;
+  ChatRecorder *recorder_;
+  bool stopping_ = false;
+  bool closedForSettings_ = false;
+
+  tcp::resolver resolver_;
+  Stream ws_;
 
-  WebSocketStream ws_;
-
-  asio::deadline_timer lifetime_;
   channel<void()> writeLock_;
+  /// Also sent by `teardown()` to end `feedMessages()`
+  channel<void()> settingsChanged_;
+  /// Sent by `pingTimer_` and by `teardown()`
+  channel<void()> pingDue_;
+  /// Times the pings and stamps the frames checked by `health_`
+  Clock &clock_;
+  Timer pingTimer_;
+  /// Every task spawned by `run()` sends once it returned
+  channel<void()> taskDone_;
+  std::size_t tasks_ = 0;
+  bool closing_ = false;
+  /// Expires once the connection is closed
+  asio::steady_timer closed_;
 };
 
-WebSocketSession::WebSocketSession(AppContextPtr app, io_context &ctx,
-                                   wintls::context &sslContext)
+template <typename Stream>
+template <typename... StreamArgs>
+WebSocketSession<Stream>::WebSocketSession(
+    AppContextPtr app, io_context &ctx, Clock &clock, VoteEngine &engine,
+    std::size_t source, std::optional<std::string> channel,
+    const ConnectionHealth::Config &health, ChatRecorder *recorder,
+    StreamArgs &...streamArgs)
     : app_(std::move(app)),
       rules_(this->app_->readRules()),
-      ws_(ctx, sslContext),
-      lifetime_(ctx, boost::posix_time::pos_infin),
-      writeLock_(ctx, 1)
+      compression_(this->app_->readCompression()),
+      fixedChannel_(std::move(channel)),
+      health_(health),
+      handler_(engine, source, &this->health_),
+      recorder_(recorder),
+      resolver_(ctx),
+      ws_(ctx, streamArgs...),
+      writeLock_(ctx, 1),
+      settingsChanged_(ctx, 1),
+      pingDue_(ctx, 1),
+      clock_(clock),
+      pingTimer_(this->clock_, [this] { this->pingDue_.try_send(); }),
+      taskDone_(ctx, 2),
+      closed_(ctx, asio::steady_timer::time_point::max())
 {
 }
 
-awaitable<void> WebSocketSession::run(const Endpoint &endpoint)
+template <typename Stream>
+awaitable<void> WebSocketSession<Stream>::run(const Endpoint &endpoint)
 {
   co_await this->connect(endpoint);
-  co_spawn(co_await asio::this_coro::executor, this->feedMessages(),
-           logOrDie("feed"));
+  if (this->stopping_)
+  {
+    co_await this->teardown();
+    co_return;
+  }
+  auto executor = co_await asio::this_coro::executor;
+  auto spawnTask = [&](awaitable<void> task, const char *action)
+  {
+    this->tasks_++;
+    co_spawn(executor, std::move(task),
+             [this, log = logOrDie(action)](std::exception_ptr ex)
+             {
+               log(ex);
+               this->taskDone_.try_send();
+             });
+  };
+  spawnTask(this->feedMessages(), "feed");
+  spawnTask(this->monitorHealth(), "health");
   co_await this->listenIrc();
   co_await this->teardown();
+  co_await this->joinTasks();
 }
 
-awaitable<void> WebSocketSession::teardown()
+template <typename Stream>
+awaitable<void> WebSocketSession<Stream>::joinTasks()
 {
+  // the tasks reference the session
+  for (; this->tasks_ > 0; this->tasks_--)
+  {
+    error_code ec;
+    co_await this->taskDone_.async_receive(await_ec(ec));
+  }
+}
+
+template <typename Stream>
+awaitable<void> WebSocketSession<Stream>::teardown()
+{
+  if (this->closing_)
+  {
+    // `stop()` is already closing the connection - wait for it
+    error_code ec;
+    co_await this->closed_.async_wait(await_ec(ec));
+    co_return;
+  }
+  this->closing_ = true;
 
   try
   {
-    this->lifetime_.cancel();
+    // wake up the tasks - they return once they see `closing_`
+    this->settingsChanged_.try_send();
+    this->pingTimer_.stop();
+    this->pingDue_.try_send();
 
     if (!this->ws_.is_open())
     { // already closed
+      this->closed_.expires_at(asio::steady_timer::time_point::min());
       co_return;
     }
 
+    // Don't wait for a server that doesn't answer the close. The websocket
+    // uses the handshake timeout for the close as well - unlike a timeout on
+    // the socket, it also ends a read that's already pending.
+    auto timeout =
+        websocket::stream_base::timeout::suggested(beast::role_type::client);
+    timeout.handshake_timeout =
+        this->stopping_ ? IrcClient::STOP_CLOSE_TIMEOUT : CLOSE_TIMEOUT;
+    this->ws_.set_option(timeout);
+
     // Close the WebSocket connection
     co_await this->ws_.async_close(websocket::close_code::normal);
-    wxLogMessage("Closed connection gracefully");
+    Log::info("Closed connection gracefully");
   }
   catch (const std::exception &ex)
   {
-    wxLogMessage("Failed to close connection: %s", ex.what());
+    Log::warn("Failed to close connection: {}", ex.what());
   }
+  // completes all current and future waits
+  this->closed_.expires_at(asio::steady_timer::time_point::min());
 }
 
-awaitable<void> WebSocketSession::connect(const Endpoint &endpoint)
+template <typename Stream> void WebSocketSession<Stream>::stop()
 {
-  wxLogMessage("Resolving %s:%s", endpoint.host, endpoint.port);
+  this->stopping_ = true;
+  // A pending lookup is only abandoned - the resolver thread still waits
+  // for it.
+  this->resolver_.cancel();
+
+  if (!this->ws_.is_open() || this->closing_)
+  {
+    // Still connecting or already closing (maybe with the longer timeout)
+    beast::get_lowest_layer(this->ws_).cancel();
+    return;
+  }
+  // A pending read completes once the server answered the close. Cancelling
+  // it instead would fail the stream, so no close frame could be sent.
+  co_spawn(this->ws_.get_executor(), this->teardown(), logOrDie("close"));
+}
+
+template <typename Stream>
+awaitable<void> WebSocketSession<Stream>::connect(const Endpoint &endpoint)
+{
+  AsyncTraceSpan span("connect");
+  Log::info("Resolving {}:{}", endpoint.host, endpoint.port);
 
-  auto tcpResolver = tcp::resolver(co_await asio::this_coro::executor);
   error_code resolveError;
-  auto target = co_await tcpResolver.async_resolve(endpoint.host, endpoint.port,
-                                                   await_ec(resolveError));
+  auto target = co_await this->resolver_.async_resolve(
+      endpoint.host, endpoint.port, await_ec(resolveError));
   if (resolveError)
   {
     fail(resolveError, "resolve");
     co_return;
   }
-  wxLogMessage("Connecting to %s:%s/%s", endpoint.host, endpoint.port,
-               endpoint.path);
+  Log::info("Connecting to {}:{}{}", endpoint.host, endpoint.port,
+            endpoint.path);
 
   // Make the connection on the IP address we get from a lookup
   auto tcpEndpoint =
       co_await beast::get_lowest_layer(this->ws_).async_connect(target);
 
-  // Set SNI Hostname (many hosts need this to handshake successfully)
-  this->ws_.next_layer().set_server_hostname(endpoint.host);
-  this->ws_.next_layer().set_certificate_revocation_check(true);
+  if constexpr (IS_TLS)
+  {
+    // Set SNI Hostname (many hosts need this to handshake successfully)
+    this->ws_.next_layer().set_server_hostname(endpoint.host);
+    this->ws_.next_layer().set_certificate_revocation_check(true);
+  }
 
   // Set a timeout on the operation
   beast::get_lowest_layer(this->ws_).expires_after(std::chrono::seconds(30));
 
+  beast::get_lowest_layer(this->ws_).rate_policy().setMetrics(
+      &this->app_->metrics());
+
+  websocket::permessage_deflate deflate;
+  deflate.client_enable = this->compression_.enabled;
+  deflate.server_max_window_bits = this->compression_.serverMaxWindowBits;
+  deflate.client_max_window_bits = this->compression_.clientMaxWindowBits;
+  deflate.server_no_context_takeover =
+      this->compression_.serverNoContextTakeover;
+  deflate.client_no_context_takeover =
+      this->compression_.clientNoContextTakeover;
+  this->ws_.set_option(deflate);
+
   // Set a decorator to change the User-Agent of the handshake
   this->ws_.set_option(websocket::stream_base::decorator(
       [](websocket::request_type &req)
@@ -249,16 +466,21 @@ awaitable<void> WebSocketSession::connect(const Endpoint &endpoint)
                 std::format("{} SkipMySong", BOOST_BEAST_VERSION_STRING));
       }));
 
-  // Perform the SSL handshake
-  boost::system::error_code sslHandshakeError;
-  co_await this->ws_.next_layer().async_handshake(
-      wintls::handshake_type::client, await_ec(sslHandshakeError));
-  if (sslHandshakeError)
+#ifdef _WIN32
+  if constexpr (IS_TLS)
   {
-    fail(sslHandshakeError, "TLS handshake");
-    co_return;
+    // Perform the SSL handshake
+    boost::system::error_code sslHandshakeError;
+    co_await this->ws_.next_layer().async_handshake(
+        wintls::handshake_type::client, await_ec(sslHandshakeError));
+    if (sslHandshakeError)
+    {
+      fail(sslHandshakeError, "TLS handshake");
+      co_return;
+    }
+    Log::info("Completed TLS handshake");
   }
-  wxLogMessage("Completed TLS handshake");
+#endif
 
   // Turn off the timeout on the tcp_stream, because
   // the websocket stream has its own timeout system.
@@ -279,44 +501,96 @@ awaitable<void> WebSocketSession::connect(const Endpoint &endpoint)
   }
   this->ws_.text(true);
 
-  wxLogMessage("Completed WS handshake");
+  Log::info("Completed WS handshake");
+  Startup::reach(Startup::Milestone::Connected);
 
   co_await this->initConnection();
 }
 
-awaitable<void> WebSocketSession::initConnection()
+template <typename Stream>
+awaitable<void> WebSocketSession<Stream>::initConnection()
 {
   co_await this->write("CAP REQ :twitch.tv/tags\r\n"s);
   co_await this->write("PASS oauth:\r\n"s);
   co_await this->write("NICK justinfan12345\r\n"s);
-  if (!this->rules_.channel.empty())
+  if (!this->targetChannel().empty())
   {
-    this->lastChannel_ = this->rules_.channel;
-    wxLogMessage("JOIN #%s", this->rules_.channel);
-    co_await this->write(std::format("JOIN #{}\n", this->rules_.channel));
+    this->lastChannel_ = this->targetChannel();
+    Log::info("JOIN #{}", this->targetChannel());
+    co_await this->write(std::format("JOIN #{}\n", this->targetChannel()));
   }
 }
 
-awaitable<void> WebSocketSession::listenIrc()
+template <typename Stream>
+awaitable<void> WebSocketSession<Stream>::listenIrc()
 {
   try
   {
-    beast::flat_buffer buf;
+    auto &metrics = this->app_->metrics();
+    // Reused for all frames - it holds at most one frame and the incomplete
+    // message before it.
+    beast::flat_buffer buf(ReceiveBudget::MAX_BUFFER);
+    this->ws_.read_message_max(ReceiveBudget::MAX_FRAME);
     for (;;)
     {
       error_code ec;
-      co_await this->ws_.async_read(buf, await_ec(ec));
+      auto size = co_await this->ws_.async_read(buf, await_ec(ec));
       if (ec.value() == asio::error::eof)
       {
         co_return;
       }
+      if (ec == websocket::error::message_too_big)
+      {
+        metrics.add(Metrics::Counter::OversizedFrames);
+      }
+      if (ec && this->stopping_)
+      {
+        co_return;
+      }
       if (ec)
       {
-        wxLogMessage("Failed to read -> [%d] %s", ec.value(), ec.message());
+        Log::warn("Failed to read -> [{}] {}", ec.value(), ec.message());
         co_return;
       }
 
-      co_await this->parseMessages(buf);
+      auto receivedAt = this->clock_.now();
+      AsyncTraceSpan span("frame");
+      metrics.add(Metrics::Counter::Frames);
+      metrics.add(Metrics::Counter::Bytes, size);
+      metrics.raise(Metrics::Gauge::ReceiveBufferPeak, buf.size());
+      metrics.set(Metrics::Gauge::ReceiveBufferCapacity, buf.capacity());
+      if (this->recorder_ != nullptr)
+      {
+        auto data = buf.cdata();
+        this->recorder_->append(
+            {static_cast<const char *>(data.data()) + data.size() - size,
+             size},
+            receivedAt);
+      }
+
+      if (auto skipped = this->budget_.skip(bufferView(buf)))
+      {
+        buf.consume(skipped);
+        metrics.add(Metrics::Counter::ShedBytes, skipped);
+      }
+
+      ec = co_await this->parseMessages(buf, receivedAt);
+      if (auto dropped = this->budget_.limit(bufferView(buf)))
+      {
+        Log::warn("Dropping a message larger than {} bytes",
+                  ReceiveBudget::MAX_PENDING);
+        buf.consume(dropped);
+        metrics.add(Metrics::Counter::OversizedMessages);
+        metrics.add(Metrics::Counter::ShedBytes, dropped);
+      }
+      if (this->arena_.reset())
+      {
+        metrics.add(Metrics::Counter::ArenaOverflows);
+      }
+      if (ec)
+      {
+        co_return;
+      }
     }
   }
   catch (const std::exception &ex)
@@ -326,49 +600,46 @@ awaitable<void> WebSocketSession::listenIrc()
   }
 }
 
-awaitable<error_code> WebSocketSession::parseMessages(beast::flat_buffer &buf)
+template <typename Stream>
+awaitable<error_code>
+WebSocketSession<Stream>::parseMessages(
+    beast::flat_buffer &buf, std::chrono::steady_clock::time_point receivedAt)
 {
-  auto read = buf.cdata();
+  std::pmr::string replies(this->arena_.resource());
+  MessageHandler::Result result;
+  {
+    TraceSpan span("parse");
+    result = this->handler_.handle(bufferView(buf), receivedAt, replies);
+  }
+  buf.consume(result.consumed);
 
-  std::pair<std::optional<IrcMessage>, std::size_t> parsed;
-  while ((parsed = parseIrcMessage(
-              {reinterpret_cast<const char *>(read.data()), read.size()}))
-             .second != 0)
+  if (!replies.empty())
   {
-    if (parsed.first)
+    auto ec = co_await this->write(replies);
+    if (ec)
     {
-      const auto &msg = parsed.first;
-      if (msg->isPing)
-      {
-        auto ec = co_await this->write(std::format("PONG :{}\n", msg->content));
-        if (ec)
-        {
-          co_return ec;
-        }
-      }
-      else
-      {
-        bool pass = (this->rules_.allowSubs && msg->isSub) ||
-                    (this->rules_.allowNonSubs && !msg->isSub);
-        pass = pass && msg->content.starts_with(this->rules_.command);
-
-        if (pass)
-        {
-          this->app_->publishVote(std::string(msg->user));
-        }
-      }
+      co_return ec;
     }
-    buf.consume(parsed.second);
-    read = buf.cdata();
+  }
+  if (result.reconnect)
+  {
+    Log::info("Server requested a reconnect");
+    co_return error_code{asio::error::connection_reset};
   }
 
   co_return error_code{};
 }
 
-awaitable<error_code> WebSocketSession::write(const std::string &msg)
+template <typename Stream>
+awaitable<error_code>
+WebSocketSession<Stream>::write(std::string_view msg)
 {
+  AsyncTraceSpan span("write");
   error_code ec;
-  co_await this->writeLock_.async_send(await_ec(ec)); // lock
+  {
+    AsyncTraceSpan lockSpan("writeLock");
+    co_await this->writeLock_.async_send(await_ec(ec)); // lock
+  }
   if (ec)
   {
     co_return ec;
@@ -377,113 +648,504 @@ awaitable<error_code> WebSocketSession::write(const std::string &msg)
   this->writeLock_.try_receive([](auto...) {}); // unlock
   if (ec)
   {
-    wxLogMessage("Failed to send -> [%d] %s", ec.value(), ec.message());
+    Log::warn("Failed to send -> [{}] {}", ec.value(), ec.message());
   }
   co_return ec;
 }
 
-awaitable<void> WebSocketSession::feedMessages()
+template <typename Stream>
+awaitable<void> WebSocketSession<Stream>::feedMessages()
 {
   try
   {
     for (;;)
     {
-      error_code ecRules;
-      error_code ecTimer;
-      auto event = co_await (
-          this->app_->rulesChanged().async_receive(await_ec(ecRules)) ||
-          this->lifetime_.async_wait(await_ec(ecTimer)));
-      if (event.index() == 1)
+      error_code ec;
+      co_await this->settingsChanged_.async_receive(await_ec(ec));
+      if (this->closing_)
+      {
+        co_return;
+      }
+      if (this->app_->readCompression() != this->compression_)
       {
-        co_return; // we got woken up
+        // The extension is negotiated in the handshake
+        Log::info("Compression changed - reconnecting");
+        this->closedForSettings_ = true;
+        beast::get_lowest_layer(this->ws_).cancel();
+        continue;
       }
 
-      // we got a ping, let's update the rules
+      // the rules might have changed (the engine already got them)
+      AsyncTraceSpan span("updateRules");
       this->rules_ = this->app_->readRules();
-      if (this->lastChannel_ != this->rules_.channel)
+      if (this->lastChannel_ != this->targetChannel())
       {
         auto last = std::move(this->lastChannel_);
-        this->lastChannel_ = this->rules_.channel;
+        this->lastChannel_ = this->targetChannel();
         if (!last.empty())
         {
-          wxLogMessage("PART #%s", last);
+          Log::info("PART #{}", last);
           co_await this->write(std::format("PART #{}\r\n", last));
         }
-        wxLogMessage("JOIN #%s", this->rules_.channel);
-        co_await this->write(std::format("JOIN #{}\r\n", this->rules_.channel));
+        Log::info("JOIN #{}", this->targetChannel());
+        co_await this->write(
+            std::format("JOIN #{}\r\n", this->targetChannel()));
       }
     }
   }
   catch (const boost::system::system_error &e)
   {
-    wxLogMessage("Failed to feed messages: [%d] %s", e.code().value(),
-                 e.code().message());
+    Log::error("Failed to feed messages: [{}] {}", e.code().value(),
+               e.code().message());
   }
   catch (const std::exception &ex)
   {
-    wxLogMessage("Failed to feed messages: %s", ex.what());
+    Log::error("Failed to feed messages: {}", ex.what());
+  }
+}
+
+template <typename Stream>
+awaitable<void> WebSocketSession<Stream>::monitorHealth()
+{
+  auto &metrics = this->app_->metrics();
+  while (!this->closing_)
+  {
+    this->pingTimer_.start(this->health_.config().pingInterval);
+    error_code ec;
+    co_await this->pingDue_.async_receive(await_ec(ec));
+    if (this->closing_)
+    {
+      co_return;
+    }
+
+    auto now = this->clock_.now();
+    if (this->health_.check(now) == ConnectionHealth::Verdict::Unhealthy)
+    {
+      auto toMs = [](std::optional<ConnectionHealth::Duration> value)
+      {
+        return value ? std::chrono::duration_cast<std::chrono::milliseconds>(
+                           *value)
+                           .count()
+                     : -1;
+      };
+      Log::warn("Connection is unhealthy (rtt={}ms lag={}ms) - reconnecting",
+                toMs(this->health_.rtt()), toMs(this->health_.lag()));
+      metrics.add(Metrics::Counter::UnhealthyReconnects);
+      beast::get_lowest_layer(this->ws_).cancel();
+      co_return;
+    }
+    if (auto id = this->health_.ping(now))
+    {
+      co_await this->write(std::format("PING :{}\r\n", *id));
+    }
   }
 }
 
+/// A Twitch channel - the one from the rules or a fixed one. Reconnects with
+/// a backoff until it's stopped.
+class TwitchSource : public ChatSource
+{
+public:
+  /// Joins `channel`, or the channel from the rules if it's empty. Create it
+  /// on the IO thread - setting up the TLS context takes a while.
+  TwitchSource(AppContextPtr app, io_context &ctx, Endpoint endpoint,
+               std::optional<std::string> channel,
+               ConnectionHealth::Config health, ChatRecorder *recorder)
+      : app_(std::move(app)),
+        ctx_(ctx),
+        clock_(ctx.get_executor()),
+        reconnector_(this->clock_,
+                     Backoff(std::chrono::seconds(1), std::chrono::minutes(2)),
+                     [this] { this->reconnectDue_.try_send(); }),
+        reconnectDue_(ctx, 1),
+        endpoint_(std::move(endpoint)),
+        channel_(std::move(channel)),
+        health_(health),
+        recorder_(recorder)
+  {
+#ifdef _WIN32
+    this->sslContext_.use_default_certificates(true);
+    this->sslContext_.verify_server_certificate(true);
+#endif
+  }
+
+  awaitable<void> run(VoteEngine &engine, std::size_t source) override
+  {
+    while (!this->stopping_)
+    {
+      this->reconnector_.connecting();
+      bool closedForSettings = false;
+      try
+      {
+        if (this->endpoint_.secure)
+        {
+#ifdef _WIN32
+          closedForSettings = co_await this->runSession<TlsWebSocketStream>(
+              engine, source, this->sslContext_);
+#else
+          throw std::runtime_error("Secure endpoints require WinTLS");
+#endif
+        }
+        else
+        {
+          closedForSettings =
+              co_await this->runSession<PlainWebSocketStream>(engine, source);
+        }
+      }
+      catch (const boost::system::system_error &ex)
+      {
+        // e.g. a refused connection - try again
+        if (!this->stopping_)
+        {
+          fail(ex, "session");
+        }
+      }
+      if (this->stopping_)
+      {
+        break;
+      }
+
+      if (closedForSettings)
+      {
+        this->reconnector_.restart();
+      }
+      else
+      {
+        this->app_->metrics().add(Metrics::Counter::Reconnects);
+        auto delay = this->reconnector_.disconnected();
+        Log::info("Reconnecting in {}ms",
+                  std::chrono::duration_cast<std::chrono::milliseconds>(delay)
+                      .count());
+      }
+      error_code ec;
+      co_await this->reconnectDue_.async_receive(await_ec(ec));
+    }
+  }
+
+  void stop() override
+  {
+    this->stopping_ = true;
+    this->reconnector_.cancel();
+    this->reconnectDue_.try_send();
+    if (this->session_.stop)
+    {
+      this->session_.stop();
+    }
+  }
+
+  void settingsChanged() override
+  {
+    if (this->session_.settingsChanged)
+    {
+      this->session_.settingsChanged();
+    }
+  }
+
+private:
+  /// Returns whether the session was closed because the settings changed.
+  template <typename Stream, typename... StreamArgs>
+  awaitable<bool> runSession(VoteEngine &engine, std::size_t source,
+                             StreamArgs &...streamArgs)
+  {
+    WebSocketSession<Stream> sess{this->app_,    this->ctx_,
+                                  this->clock_,  engine,
+                                  source,        this->channel_,
+                                  this->health_, this->recorder_,
+                                  streamArgs...};
+    this->session_ = Session{
+        .stop = [&sess] { sess.stop(); },
+        .settingsChanged = [&sess] { sess.settingsChanged(); },
+    };
+    try
+    {
+      co_await sess.run(this->endpoint_);
+    }
+    catch (...)
+    {
+      this->session_ = {};
+      throw;
+    }
+    this->session_ = {};
+    co_return sess.closedForSettings();
+  }
+
+  AppContextPtr app_;
+  io_context &ctx_;
+  AsioClock clock_;
+  Reconnector reconnector_;
+  /// Sent by `reconnector_` and by `stop()`
+  channel<void()> reconnectDue_;
+  Endpoint endpoint_;
+  std::optional<std::string> channel_;
+  ConnectionHealth::Config health_;
+  ChatRecorder *recorder_;
+  bool stopping_ = false;
+
+  struct Session
+  {
+    std::function<void()> stop;
+    std::function<void()> settingsChanged;
+  };
+  /// Set while a session is running
+  Session session_;
+#ifdef _WIN32
+  wintls::context sslContext_{wintls::method::system_default};
+#endif
+};
+
+/// Replays a recording (see `ChatRecorder`) - in real time or as fast as
+/// possible.
+class ReplaySource : public ChatSource
+{
+public:
+  /// At full speed, the replay yields to other handlers (e.g. `stop()`)
+  /// after this many frames.
+  static constexpr std::size_t YIELD_EVERY = 64;
+
+  ReplaySource(io_context &ctx, std::filesystem::path path, bool realTime)
+      : timer_(ctx),
+        path_(std::move(path)),
+        realTime_(realTime)
+  {
+  }
+
+  awaitable<void> run(VoteEngine &engine, std::size_t source) override
+  {
+    ChatReplay replay(this->path_);
+    MessageHandler handler(engine, source);
+    Log::info("Replaying {}", this->path_.string());
+
+    auto executor = co_await asio::this_coro::executor;
+    auto start = std::chrono::steady_clock::now();
+    std::size_t frames = 0;
+    while (auto frame = replay.next())
+    {
+      if (this->realTime_)
+      {
+        this->timer_.expires_at(start + frame->offset);
+        error_code ec;
+        co_await this->timer_.async_wait(await_ec(ec));
+      }
+      else if (++frames % YIELD_EVERY == 0)
+      {
+        co_await asio::post(executor, use_awaitable);
+      }
+      if (this->stopping_)
+      {
+        co_return;
+      }
+      replay.feed(*frame, handler, std::chrono::steady_clock::now());
+    }
+    Log::info("Finished replay");
+  }
+
+  void stop() override
+  {
+    this->stopping_ = true;
+    this->timer_.cancel();
+  }
+
+private:
+  /// Cancelled in `stop()`
+  asio::steady_timer timer_;
+  std::filesystem::path path_;
+  bool realTime_;
+  bool stopping_ = false;
+};
+
 } // namespace
 
 class IrcClientPrivate
 {
 public:
-  IrcClientPrivate(AppContextPtr app, io_context &ctx,
-                   wintls::context &sslContext)
-      : ctx_(ctx),
-        sslContext_(sslContext),
-        app_(std::move(app)){};
+  IrcClientPrivate()
+      : app_(std::make_shared<AppContext>(this->ctx_.get_executor(), nullptr))
+  {
+  }
 
-  awaitable<void> runLoop(const Endpoint &endpoint)
+  /// Runs on the IO thread. The sources return after this, and then the
+  /// context is stopped (others may still use it - e.g. the overlay).
+  void stop()
   {
+    if (this->stopping_)
+    {
+      return;
+    }
+    Log::info("Stopping");
+    this->stopping_ = true;
+    this->app_->rulesChanged().cancel();
+    this->app_->compressionChanged().cancel();
+    if (this->running_ == 0)
+    {
+      this->ctx_.stop();
+      return;
+    }
+    for (const auto &source : this->sources_)
+    {
+      source->stop();
+    }
+  }
 
+  /// Called once a source returned.
+  void sourceDone()
+  {
+    this->running_--;
+    if (this->running_ == 0 && this->stopping_)
+    {
+      this->ctx_.stop();
+    }
+  }
+
+  /// Runs on the IO thread, so the UI doesn't wait for it.
+  void prepare(const Endpoint &endpoint, const IrcClientOptions &options)
+  {
+    if (!options.recordPath.empty())
+    {
+      try
+      {
+        this->recorder_ = std::make_unique<ChatRecorder>(options.recordPath);
+        Log::info("Recording chat to {}", options.recordPath.string());
+      }
+      catch (const std::exception &ex)
+      {
+        fail(ex, "record");
+      }
+    }
+
+    if (options.userRateLimit)
+    {
+      this->limiter_ =
+          std::make_unique<UserRateLimiter>(*options.userRateLimit);
+      Log::info("Limiting users to {} messages/s (burst {})",
+                options.userRateLimit->rate, options.userRateLimit->burst);
+    }
+    this->engine_ = std::make_unique<VoteEngine>(
+        this->app_, this->app_->readRules(), this->limiter_.get());
+
+    // only the main source is recorded - a replay can't tell sources apart
+    if (options.replayPath.empty())
+    {
+      this->sources_.emplace_back(std::make_unique<TwitchSource>(
+          this->app_, this->ctx_, endpoint, std::nullopt, options.health,
+          this->recorder_.get()));
+    }
+    else
+    {
+      this->sources_.emplace_back(std::make_unique<ReplaySource>(
+          this->ctx_, options.replayPath, options.replayRealTime));
+    }
+    for (const auto &channel : options.extraChannels)
+    {
+      Log::info("Also listening to #{}", channel);
+      this->sources_.emplace_back(std::make_unique<TwitchSource>(
+          this->app_, this->ctx_, endpoint, channel, options.health,
+          nullptr));
+    }
+  }
+
+  /// Hands new rules to the engine and the sources.
+  awaitable<void> watchRules()
+  {
     for (;;)
     {
-      // TODO: add backoff
+      error_code ec;
+      co_await this->app_->rulesChanged().async_receive(await_ec(ec));
+      if (ec)
+      {
+        co_return; // stopping
+      }
+      this->engine_->setRules(this->app_->readRules());
+      for (const auto &source : this->sources_)
+      {
+        source->settingsChanged();
+      }
+    }
+  }
 
-      WebSocketSession sess{this->app_, this->ctx_, this->sslContext_};
-      co_await sess.run(endpoint);
+  awaitable<void> watchCompression()
+  {
+    for (;;)
+    {
+      error_code ec;
+      co_await this->app_->compressionChanged().async_receive(await_ec(ec));
+      if (ec)
+      {
+        co_return; // stopping
+      }
+      for (const auto &source : this->sources_)
+      {
+        source->settingsChanged();
+      }
     }
   }
 
 private:
-  io_context &ctx_;
-  wintls::context &sslContext_;
+  io_context ctx_;
+  bool stopping_ = false;
+  /// Sources that didn't return yet
+  std::size_t running_ = 0;
 
   AppContextPtr app_;
+  std::unique_ptr<ChatRecorder> recorder_;
+  std::unique_ptr<UserRateLimiter> limiter_;
+  std::unique_ptr<VoteEngine> engine_;
+  std::vector<std::unique_ptr<ChatSource>> sources_;
 
   friend class IrcClient;
 };
 
-IrcClient::IrcClient() = default;
-IrcClient::~IrcClient() = default;
-void IrcClient::run(const std::function<void(AppContextPtr)> &init)
-{
-  io_context ctx;
+IrcClient::IrcClient() : private_(std::make_unique<IrcClientPrivate>()) {}
+IrcClient::~IrcClient() { this->stop(); }
 
-  AppContextPtr app = std::make_shared<AppContext>(ctx.get_executor(), nullptr);
-  init(app);
+AppContextPtr IrcClient::app() const { return this->private_->app_; }
+
+asio::any_io_executor IrcClient::executor() const
+{
+  return this->private_->ctx_.get_executor();
+}
 
-  wintls::context sslCtx{wintls::method::system_default};
-  sslCtx.use_default_certificates(true);
-  sslCtx.verify_server_certificate(true);
+void IrcClient::start(const Endpoint &endpoint,
+                      const IrcClientOptions &options)
+{
+  assert(!this->thread_.joinable());
+  this->thread_ = std::thread([this, endpoint, options]
+                              { this->run(endpoint, options); });
+}
 
-  this->private_ = std::make_unique<IrcClientPrivate>(app, ctx, sslCtx);
+void IrcClient::stop()
+{
+  if (!this->thread_.joinable())
+  {
+    return;
+  }
   auto *d = this->private_.get();
+  asio::post(d->ctx_, [d] { d->stop(); });
+  this->thread_.join();
+}
 
-  Endpoint twitch = {
-      .host = "irc-ws.chat.twitch.tv"s,
-      .port = "443"s,
-      .path = "/"s,
-  };
+void IrcClient::run(const Endpoint &endpoint, const IrcClientOptions &options)
+{
+  Log::setThreadName("IO");
+  Tracer::setThreadName("IO");
 
+  auto *d = this->private_.get();
   try
   {
-    co_spawn(ctx, d->runLoop(twitch), logOrDie("main loop"));
+    d->prepare(endpoint, options);
+    co_spawn(d->ctx_, d->watchRules(), logOrDie("rules"));
+    co_spawn(d->ctx_, d->watchCompression(), logOrDie("compression"));
+    for (const auto &source : d->sources_)
+    {
+      d->running_++;
+      co_spawn(d->ctx_, source->run(*d->engine_, d->engine_->addSource()),
+               [d, log = logOrDie("source")](const std::exception_ptr &e)
+               {
+                 log(e);
+                 d->sourceDone();
+               });
+    }
 
-    ctx.run();
+    d->ctx_.run();
   }
   catch (const std::exception &ex)
   {
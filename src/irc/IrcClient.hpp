@@ -1,18 +1,85 @@
 #pragma once
 
 #include "AppContext.hpp"
+#include "irc/ConnectionHealth.hpp"
+#include "irc/Endpoint.hpp"
+#include "irc/UserRateLimiter.hpp"
+
+#include <boost/asio/any_io_executor.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct IrcClientOptions
+{
+  /// Append every received frame to this file (see `ChatRecorder`)
+  std::filesystem::path recordPath;
+
+  /// Replay this recording instead of connecting to the endpoint
+  std::filesystem::path replayPath;
+  bool replayRealTime = true;
+
+  /// Drop messages from users that send more than this. The limits are kept
+  /// across reconnects.
+  std::optional<UserRateLimiter::Config> userRateLimit;
+
+  /// Channels to listen to in addition to the one from the rules, each on
+  /// its own connection. Votes from all of them are counted together - a
+  /// message that arrives on two connections only counts once.
+  std::vector<std::string> extraChannels;
+
+  /// When a connection is replaced because its latency degraded
+  ConnectionHealth::Config health;
+};
 
 class IrcClientPrivate;
+/// Connects to Twitch's chat (or replays a recording) on its own IO thread.
+/// Every connection (or replay) is a `ChatSource` that delivers its messages
+/// to a shared `VoteEngine`.
+///
+/// The context from `app()` uses the client's `io_context` - all references
+/// to it must be dropped before the client is destroyed.
 class IrcClient
 {
 public:
+  /// How long `stop()` waits for the server to answer the close
+  static constexpr auto STOP_CLOSE_TIMEOUT = std::chrono::milliseconds(50);
+
   IrcClient();
+  /// Stops the client.
   ~IrcClient();
 
-  void run(const std::function<void(AppContextPtr)> &init);
+  IrcClient(const IrcClient &) = delete;
+  IrcClient(IrcClient &&) noexcept = delete;
+  IrcClient &operator=(const IrcClient &) = delete;
+  IrcClient &operator=(IrcClient &&) noexcept = delete;
+
+  /// Shared with the UI - it exists before `start()` is called, so the UI
+  /// doesn't have to wait for the IO thread.
+  AppContextPtr app() const;
+  /// The executor of the IO thread
+  boost::asio::any_io_executor executor() const;
+
+  /// Starts the IO thread, which sets up the TLS context and connects (or
+  /// replays).
+  void start(const Endpoint &endpoint, const IrcClientOptions &options);
+
+  /// Cancels everything the client is waiting for and joins the IO thread.
+  /// An open connection is closed gracefully, but the server only gets
+  /// `STOP_CLOSE_TIMEOUT` to answer. Only a DNS lookup in progress can delay
+  /// this further.
+  void stop();
 
 private:
+  void run(const Endpoint &endpoint, const IrcClientOptions &options);
+
   std::unique_ptr<IrcClientPrivate> private_;
+  std::thread thread_;
 
   friend class IrcClientPrivate;
 };
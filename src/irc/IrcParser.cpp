@@ -1,10 +1,43 @@
 #include "irc/IrcParser.hpp"
 
+#include <charconv>
+
 namespace
 {
 
 using namespace std::string_view_literals;
 
+/// Picks the tags we need from `key=value;key=value`.
+void parseTags(std::string_view tags, IrcMessage &msg)
+{
+  while (!tags.empty())
+  {
+    auto semi = tags.find(';');
+    auto tag = tags.substr(0, semi);
+    tags = semi == std::string_view::npos ? ""sv : tags.substr(semi + 1);
+
+    auto eq = tag.find('=');
+    if (eq == std::string_view::npos)
+    {
+      continue;
+    }
+    auto key = tag.substr(0, eq);
+    auto value = tag.substr(eq + 1);
+    if (key == "badges"sv)
+    {
+      msg.isSub = value.contains("subscriber"sv);
+    }
+    else if (key == "id"sv)
+    {
+      msg.id = value;
+    }
+    else if (key == "tmi-sent-ts"sv)
+    {
+      std::from_chars(value.data(), value.data() + value.size(), msg.sentTs);
+    }
+  }
+}
+
 } // namespace
 
 std::pair<std::optional<IrcMessage>, std::size_t>
@@ -30,13 +63,7 @@ parseIrcMessage(std::string_view buffer)
       return needMoreData;
     }
     std::string_view tags{buffer.data() + 1, space - 1};
-    auto badgeStart = tags.find("badges="sv);
-    if (badgeStart != std::string_view::npos)
-    {
-      auto fromBadge = tags.substr(badgeStart + 7);
-      auto badgeEnd = fromBadge.find(';');
-      msg.isSub = fromBadge.substr(0, badgeEnd).contains("subscriber"sv);
-    }
+    parseTags(tags, msg);
     consumed += space + 1;
     buffer = buffer.substr(space + 1);
   }
@@ -48,21 +75,17 @@ parseIrcMessage(std::string_view buffer)
 
   if (buffer[0] == ':')
   {
-    auto excl = buffer.find('!');
-    if (excl == npos)
+    auto space = buffer.find(' ');
+    if (space == npos)
     {
       return needMoreData;
     }
-    if (excl > 1)
+    // only users have a `nick!user@host` prefix
+    auto excl = buffer.substr(0, space).find('!');
+    if (excl != npos && excl > 1)
     {
       msg.user = buffer.substr(1, excl - 1);
     }
-
-    auto space = buffer.find(' ');
-    if (space == npos)
-    {
-      return needMoreData;
-    }
     consumed += space + 1;
     buffer = buffer.substr(space + 1);
   }
@@ -84,6 +107,20 @@ parseIrcMessage(std::string_view buffer)
         msg.content = buffer.substr(6, clrf - 6);
         return {msg, consumed};
       }
+      if (buffer.starts_with("PONG "sv))
+      {
+        // PONG <server> :<payload>
+        auto line = buffer.substr(0, clrf);
+        auto col = line.find(" :"sv);
+        msg.isPong = true;
+        msg.content = col == npos ? line.substr(5) : line.substr(col + 2);
+        return {msg, consumed};
+      }
+      if (buffer.starts_with("RECONNECT"sv))
+      {
+        msg.isReconnect = true;
+        return {msg, consumed};
+      }
       return {std::nullopt, consumed};
     }
     return needMoreData;
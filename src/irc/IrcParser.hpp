@@ -2,6 +2,7 @@
 
 #include <boost/beast/core/flat_buffer.hpp>
 
+#include <cstdint>
 #include <optional>
 #include <string_view>
 #include <tuple>
@@ -10,8 +11,16 @@ struct IrcMessage
 {
   bool isSub = false;
   bool isPing = false;
+  /// `content` is the payload of our PING
+  bool isPong = false;
+  bool isReconnect = false;
   std::string_view user;
   std::string_view content;
+  /// The `id` tag (empty if there's none)
+  std::string_view id;
+  /// The `tmi-sent-ts` tag in milliseconds since the epoch (0 if there's
+  /// none)
+  std::int64_t sentTs = 0;
 };
 
 std::pair<std::optional<IrcMessage>, std::size_t>
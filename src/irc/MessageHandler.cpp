@@ -0,0 +1,112 @@
+#include "irc/MessageHandler.hpp"
+
+#include "chat/VoteEngine.hpp"
+#include "irc/IrcParser.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace
+{
+
+std::int64_t toEpochMs(std::chrono::system_clock::time_point time)
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+MessageHandler::MessageHandler(VoteEngine &engine, std::size_t source,
+                               ConnectionHealth *health)
+    : engine_(&engine),
+      source_(source),
+      health_(health)
+{
+}
+
+MessageHandler::Result
+MessageHandler::handle(std::string_view data,
+                       std::chrono::steady_clock::time_point receivedAt,
+                       std::pmr::string &replies)
+{
+  using Stage = Metrics::Stage;
+  auto &metrics = this->engine_->metrics();
+
+  Result result;
+  auto before = std::chrono::steady_clock::now();
+  metrics.record(Stage::Read, before - receivedAt);
+
+  // `tmi-sent-ts` is on Twitch's clock
+  std::int64_t receivedMs = 0;
+  std::optional<std::chrono::milliseconds> lastLag;
+  if (this->health_ != nullptr)
+  {
+    receivedMs = toEpochMs(std::chrono::system_clock::now()) -
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                     before - receivedAt)
+                     .count();
+  }
+
+  this->batch_.clear();
+  std::pair<std::optional<IrcMessage>, std::size_t> parsed;
+  while ((parsed = parseIrcMessage(data)).second != 0)
+  {
+    data.remove_prefix(parsed.second);
+    result.consumed += parsed.second;
+    if (!parsed.first)
+    {
+      continue;
+    }
+
+    auto parsedAt = std::chrono::steady_clock::now();
+    metrics.record(Stage::Parse, parsedAt - before);
+    before = parsedAt;
+
+    const auto &msg = parsed.first;
+    result.messages++;
+    if (msg->isPing)
+    {
+      replies.append("PONG :").append(msg->content).append("\n");
+    }
+    else if (msg->isPong)
+    {
+      if (this->health_ != nullptr)
+      {
+        if (auto rtt = this->health_->pong(msg->content, receivedAt))
+        {
+          metrics.record(Stage::PingRtt, *rtt);
+        }
+      }
+    }
+    else if (msg->isReconnect)
+    {
+      result.reconnect = true;
+      break;
+    }
+    else
+    {
+      if (this->health_ != nullptr && msg->sentTs != 0)
+      {
+        lastLag = std::chrono::milliseconds(receivedMs - msg->sentTs);
+        metrics.record(Stage::DeliveryLag, *lastLag);
+      }
+      this->batch_.emplace_back(ChatMessage{
+          .user = msg->user,
+          .content = msg->content,
+          .id = msg->id,
+          .isSub = msg->isSub,
+      });
+    }
+  }
+
+  if (lastLag)
+  {
+    this->health_->deliveryLag(*lastLag);
+  }
+  this->engine_->deliver(this->source_, this->batch_, receivedAt);
+  metrics.add(Metrics::Counter::Messages, result.messages);
+  return result;
+}
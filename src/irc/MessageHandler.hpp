@@ -0,0 +1,46 @@
+#pragma once
+
+#include "chat/ChatSource.hpp"
+#include "irc/ConnectionHealth.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Turns raw IRC data into chat messages for a `VoteEngine` and replies.
+///
+/// This is the part of `WebSocketSession` that doesn't need a socket, so it
+/// can also be fed from a `ChatReplay`.
+class MessageHandler
+{
+public:
+  struct Result
+  {
+    /// Number of bytes that were handled (only complete messages are handled)
+    std::size_t consumed = 0;
+    std::size_t messages = 0;
+    bool reconnect = false;
+  };
+
+  /// Delivers the PRIVMSGs to `engine` as `source`. On a live connection,
+  /// PONGs and the delivery lag of messages are reported to `health`.
+  MessageHandler(VoteEngine &engine, std::size_t source,
+                 ConnectionHealth *health = nullptr);
+
+  /// Handles all complete messages in `data` - the PRIVMSGs are delivered as
+  /// one batch. Replies to the server (PONGs) are appended to `replies` -
+  /// usually allocated from a `FrameArena`.
+  Result handle(std::string_view data,
+                std::chrono::steady_clock::time_point receivedAt,
+                std::pmr::string &replies);
+
+private:
+  VoteEngine *engine_;
+  std::size_t source_;
+  ConnectionHealth *health_;
+  /// Reused for every batch, so it only allocates while it grows
+  std::vector<ChatMessage> batch_;
+};
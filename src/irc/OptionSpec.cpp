@@ -0,0 +1,21 @@
+#include "irc/OptionSpec.hpp"
+
+std::vector<OptionItem> splitOptions(std::string_view spec)
+{
+  std::vector<OptionItem> items;
+  while (!spec.empty())
+  {
+    auto comma = spec.find(',');
+    auto item = spec.substr(0, comma);
+    spec = comma == std::string_view::npos ? std::string_view{}
+                                           : spec.substr(comma + 1);
+
+    auto eq = item.find('=');
+    items.push_back({
+        .key = item.substr(0, eq),
+        .value = eq == std::string_view::npos ? std::string_view{}
+                                              : item.substr(eq + 1),
+    });
+  }
+  return items;
+}
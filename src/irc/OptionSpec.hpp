@@ -0,0 +1,24 @@
+#pragma once
+
+#include <charconv>
+#include <string_view>
+#include <vector>
+
+/// An item of an option list - `value` is empty if the item has no `=`.
+struct OptionItem
+{
+  std::string_view key;
+  std::string_view value;
+};
+
+/// Splits a comma separated list of `key` and `key=value` items (e.g.
+/// `rate=0.5,burst=3`). The items reference `spec`.
+std::vector<OptionItem> splitOptions(std::string_view spec);
+
+/// Parses all of `value` as a number.
+template <typename T> bool parseNumber(std::string_view value, T &target)
+{
+  auto [ptr, ec] =
+      std::from_chars(value.data(), value.data() + value.size(), target);
+  return ec == std::errc{} && ptr == value.data() + value.size();
+}
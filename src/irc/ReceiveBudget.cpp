@@ -0,0 +1,30 @@
+#include "irc/ReceiveBudget.hpp"
+
+ReceiveBudget::ReceiveBudget(std::size_t maxPending) : maxPending_(maxPending)
+{
+}
+
+std::size_t ReceiveBudget::skip(std::string_view data)
+{
+  if (!this->skipping_)
+  {
+    return 0;
+  }
+  auto newline = data.find('\n');
+  if (newline == std::string_view::npos)
+  {
+    return data.size();
+  }
+  this->skipping_ = false;
+  return newline + 1;
+}
+
+std::size_t ReceiveBudget::limit(std::string_view rest)
+{
+  if (rest.size() <= this->maxPending_)
+  {
+    return 0;
+  }
+  this->skipping_ = true;
+  return rest.size();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+/// Limits how much a session buffers while waiting for the end of an IRC
+/// message.
+///
+/// Complete messages are handled as soon as they arrive, so only the tail of
+/// the last frame stays in the receive buffer. If that tail grows past the
+/// budget, it's dropped together with everything up to the next newline.
+class ReceiveBudget
+{
+public:
+  /// Largest WebSocket frame that's accepted
+  static constexpr std::size_t MAX_FRAME = 1024 * 1024;
+  /// Largest incomplete message that's kept across frames
+  static constexpr std::size_t MAX_PENDING = 64 * 1024;
+  /// The receive buffer never grows past this
+  static constexpr std::size_t MAX_BUFFER = MAX_FRAME + MAX_PENDING;
+
+  explicit ReceiveBudget(std::size_t maxPending = MAX_PENDING);
+
+  /// Returns how many bytes at the start of `data` belong to a message that
+  /// was dropped. Call it before handling newly received data.
+  std::size_t skip(std::string_view data);
+
+  /// Returns how many bytes of the unhandled `rest` to drop - either none or
+  /// all of them. Call it after handling the data.
+  std::size_t limit(std::string_view rest);
+
+  /// True while the rest of a dropped message is being skipped
+  bool skipping() const { return this->skipping_; }
+
+private:
+  std::size_t maxPending_;
+  bool skipping_ = false;
+};
@@ -0,0 +1,38 @@
+#include "irc/Reconnector.hpp"
+
+Reconnector::Reconnector(Clock &clock, Backoff backoff,
+                         std::function<void()> reconnect)
+    : clock_(clock),
+      backoff_(std::move(backoff)),
+      timer_(clock, std::move(reconnect)),
+      connectingSince_(clock.now())
+{
+}
+
+void Reconnector::connecting()
+{
+  this->connectingSince_ = this->clock_.now();
+}
+
+Clock::Duration Reconnector::disconnected()
+{
+  this->resetIfStable();
+  auto delay = this->backoff_.next();
+  this->timer_.start(delay);
+  return delay;
+}
+
+void Reconnector::restart()
+{
+  this->resetIfStable();
+  this->timer_.start(Clock::Duration::zero());
+}
+
+void Reconnector::resetIfStable()
+{
+  // only back off if we can't keep a connection
+  if (this->clock_.now() - this->connectingSince_ > STABLE_AFTER)
+  {
+    this->backoff_.reset();
+  }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "irc/Backoff.hpp"
+#include "time/Clock.hpp"
+
+#include <chrono>
+#include <functional>
+
+/// Decides when a chat source reconnects, on a `Clock`.
+///
+/// After a connection ended, `reconnect` runs once the next `Backoff` delay
+/// passed. The backoff only grows while connections don't stay up - it's
+/// reset once a connection lasted `STABLE_AFTER`.
+class Reconnector
+{
+public:
+  static constexpr auto STABLE_AFTER = std::chrono::minutes(1);
+
+  Reconnector(Clock &clock, Backoff backoff, std::function<void()> reconnect);
+
+  /// A connection attempt starts now.
+  void connecting();
+  /// The connection ended - schedules `reconnect` and returns the delay.
+  Clock::Duration disconnected();
+  /// The connection was closed on purpose (e.g. the settings changed) -
+  /// schedules `reconnect` right away without growing the backoff.
+  void restart();
+  void cancel() { this->timer_.stop(); }
+
+  bool isPending() const { return this->timer_.isRunning(); }
+  const Backoff &backoff() const { return this->backoff_; }
+
+private:
+  void resetIfStable();
+
+  Clock &clock_;
+  Backoff backoff_;
+  Timer timer_;
+  Clock::TimePoint connectingSince_;
+};
@@ -0,0 +1,111 @@
+#include "irc/UserRateLimiter.hpp"
+
+#include "UserName.hpp"
+#include "irc/OptionSpec.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+using namespace std::string_view_literals;
+
+/// Tokens are stored in millionths of a message
+constexpr double TOKEN = 1'000'000.0;
+constexpr std::uint32_t COST = 1'000'000;
+
+} // namespace
+
+std::optional<UserRateLimiter::Config>
+UserRateLimiter::Config::parse(std::string_view spec)
+{
+  Config config;
+  for (auto [key, value] : splitOptions(spec))
+  {
+    bool ok = false;
+    if (key == "rate"sv)
+    {
+      ok = parseNumber(value, config.rate) && config.rate > 0;
+    }
+    else if (key == "burst"sv)
+    {
+      ok = parseNumber(value, config.burst) && config.burst >= 1 &&
+           config.burst <= MAX_BURST;
+    }
+    else if (key == "users"sv)
+    {
+      ok = parseNumber(value, config.users) && config.users > 0;
+    }
+
+    if (!ok)
+    {
+      return std::nullopt;
+    }
+  }
+  return config;
+}
+
+UserRateLimiter::UserRateLimiter(Config config)
+    : config_(config),
+      capacity_(static_cast<std::uint32_t>(
+          std::clamp(config.burst, 1.0, MAX_BURST) * TOKEN)),
+      sets_(std::max<std::size_t>((config.users + WAYS - 1) / WAYS, 1))
+{
+  // Refilling more than a full bucket per millisecond makes no difference
+  auto refill = std::min(config.rate * TOKEN / 1000.0,
+                         static_cast<double>(this->capacity_));
+  this->refillPerMs_ =
+      std::max<std::uint64_t>(static_cast<std::uint64_t>(std::llround(refill)),
+                              1);
+  this->fillMs_ = this->capacity_ / this->refillPerMs_ + 1;
+}
+
+UserRateLimiter::Result UserRateLimiter::check(std::string_view user,
+                                               TimePoint now)
+{
+  if (!this->start_)
+  {
+    this->start_ = now;
+  }
+  auto nowMs = static_cast<std::uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(now -
+                                                            *this->start_)
+          .count());
+
+  auto key = std::max<std::uint64_t>(UserName::Hash{}(user), 1);
+  auto &set = this->sets_[key % this->sets_.size()];
+
+  Entry *oldest = nullptr;
+  for (auto &entry : set.entries)
+  {
+    if (entry.key == key)
+    {
+      // unsigned, so this is correct across the wrap
+      std::uint64_t elapsed =
+          std::min<std::uint32_t>(nowMs - entry.lastSeen, this->fillMs_);
+      entry.tokens = static_cast<std::uint32_t>(std::min<std::uint64_t>(
+          entry.tokens + elapsed * this->refillPerMs_, this->capacity_));
+      entry.lastSeen = nowMs;
+      if (entry.tokens < COST)
+      {
+        return Result::Limited;
+      }
+      entry.tokens -= COST;
+      return Result::Allowed;
+    }
+    if (oldest == nullptr || entry.key == 0 ||
+        (oldest->key != 0 && nowMs - entry.lastSeen > nowMs - oldest->lastSeen))
+    {
+      oldest = &entry;
+    }
+  }
+
+  auto result = oldest->key == 0 ? Result::Allowed : Result::Evicted;
+  *oldest = Entry{
+      .key = key,
+      .tokens = this->capacity_ - std::min(COST, this->capacity_),
+      .lastSeen = nowMs,
+  };
+  return result;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+/// Limits how many messages each user may send with a token bucket per user.
+///
+/// The buckets live in a fixed-size table (no allocations after
+/// construction) that is split into sets of `WAYS` entries, each a single
+/// cache line. A user is hashed to a set - if it's full, the user that
+/// wasn't seen for the longest time is evicted and starts with a full bucket
+/// when they return. Only used from the IO thread.
+class UserRateLimiter
+{
+public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  static constexpr std::size_t WAYS = 4;
+  static constexpr double MAX_BURST = 4000.0;
+
+  struct Config
+  {
+    /// Messages per second each user may send on average
+    double rate = 1.0;
+    /// Messages a user may send at once (at most `MAX_BURST`)
+    double burst = 5.0;
+    /// Users that are tracked (rounded up to a multiple of `WAYS`)
+    std::size_t users = 4096;
+
+    bool operator==(const Config &) const = default;
+
+    /// Parses a comma separated list of `rate=<msgs/s>`, `burst=<msgs>` and
+    /// `users=<n>` (e.g. `rate=0.5,burst=3`).
+    static std::optional<Config> parse(std::string_view spec);
+  };
+
+  enum class Result : std::uint8_t
+  {
+    Allowed,
+    /// Allowed, but another user had to be evicted
+    Evicted,
+    Limited,
+  };
+
+  explicit UserRateLimiter(Config config);
+
+  Result check(std::string_view user, TimePoint now);
+
+  const Config &config() const { return this->config_; }
+
+private:
+  struct Entry
+  {
+    /// 0 = empty
+    std::uint64_t key = 0;
+    /// In millionths of a message
+    std::uint32_t tokens = 0;
+    /// Milliseconds since `start_` (wraps after 49 days)
+    std::uint32_t lastSeen = 0;
+  };
+  struct alignas(64) Set
+  {
+    std::array<Entry, WAYS> entries;
+  };
+
+  Config config_;
+  std::uint32_t capacity_;
+  /// Millionths of a message that are refilled per millisecond (at most
+  /// `capacity_`)
+  std::uint64_t refillPerMs_ = 1;
+  /// An empty bucket is full after this many milliseconds
+  std::uint32_t fillMs_ = 0;
+  std::vector<Set> sets_;
+  std::optional<TimePoint> start_;
+};
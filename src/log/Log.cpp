@@ -0,0 +1,339 @@
+#include "log/Log.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using namespace std::string_view_literals;
+
+/// Records per thread - about 240 KiB.
+constexpr std::size_t RING_SIZE = 512;
+
+/// A single-producer single-consumer ring of records. The producer is the
+/// thread that owns it, the consumer is the logger thread.
+struct LogRing
+{
+  std::array<LogRecord, RING_SIZE> records;
+  alignas(64) std::atomic<std::uint64_t> head{0};
+  alignas(64) std::atomic<std::uint64_t> tail{0};
+  std::atomic<std::uint64_t> dropped{0};
+  /// Set once the owning thread exited
+  std::atomic<bool> closed{false};
+
+  std::mutex nameMtx;
+  std::string name;
+};
+
+class Logger
+{
+public:
+  void addSink(std::unique_ptr<LogSink> sink)
+  {
+    this->sinks_.emplace_back(std::move(sink));
+  }
+
+  void start()
+  {
+    this->stopping_ = false;
+    this->thread_ = std::thread([this] { this->run(); });
+  }
+
+  void stop()
+  {
+    if (!this->thread_.joinable())
+    {
+      return;
+    }
+    this->stopping_ = true;
+    this->wake();
+    this->thread_.join();
+  }
+
+  std::shared_ptr<LogRing> createRing()
+  {
+    auto ring = std::make_shared<LogRing>();
+    std::lock_guard lock(this->ringsMtx_);
+    ring->name = std::format("thread-{}", this->nextThread_++);
+    this->rings_.emplace_back(ring);
+    return ring;
+  }
+
+  void wake()
+  {
+    this->wakeups_.fetch_add(1, std::memory_order_release);
+    this->wakeups_.notify_one();
+  }
+
+private:
+  void run()
+  {
+    std::vector<std::shared_ptr<LogRing>> rings;
+    for (;;)
+    {
+      auto seen = this->wakeups_.load(std::memory_order_acquire);
+      bool stopping = this->stopping_.load();
+
+      {
+        std::lock_guard lock(this->ringsMtx_);
+        std::erase_if(this->rings_,
+                      [](const auto &ring)
+                      {
+                        return ring->closed.load() &&
+                               ring->tail.load() == ring->head.load();
+                      });
+        rings = this->rings_;
+      }
+
+      std::size_t drained = 0;
+      for (const auto &ring : rings)
+      {
+        drained += this->drain(*ring);
+      }
+      if (drained > 0)
+      {
+        for (const auto &sink : this->sinks_)
+        {
+          sink->flush();
+        }
+        continue;
+      }
+
+      if (stopping)
+      {
+        return;
+      }
+      this->wakeups_.wait(seen, std::memory_order_acquire);
+    }
+  }
+
+  std::size_t drain(LogRing &ring)
+  {
+    std::string thread;
+    {
+      std::lock_guard lock(ring.nameMtx);
+      thread = ring.name;
+    }
+
+    auto tail = ring.tail.load(std::memory_order_relaxed);
+    auto head = ring.head.load(std::memory_order_acquire);
+    for (auto i = tail; i < head; i++)
+    {
+      const auto &record = ring.records[i % RING_SIZE];
+      this->dispatch(record, thread, record.message());
+    }
+    ring.tail.store(head, std::memory_order_release);
+
+    auto dropped = ring.dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+    {
+      LogRecord record;
+      record.time = std::chrono::system_clock::now();
+      record.level = LogLevel::Warning;
+      this->dispatch(record, thread,
+                     std::format("Dropped {} log messages", dropped));
+    }
+    return head - tail;
+  }
+
+  void dispatch(const LogRecord &record, std::string_view thread,
+                std::string_view message)
+  {
+    for (const auto &sink : this->sinks_)
+    {
+      sink->write(record, thread, message);
+    }
+  }
+
+  std::vector<std::unique_ptr<LogSink>> sinks_;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<std::uint64_t> wakeups_{0};
+
+  std::mutex ringsMtx_;
+  std::vector<std::shared_ptr<LogRing>> rings_;
+  std::size_t nextThread_ = 1;
+};
+
+Logger &logger()
+{
+  // never destroyed - detached threads may log while the process exits
+  static auto *instance = new Logger;
+  return *instance;
+}
+
+/// Owned by each thread that logs - marks the ring as closed on exit.
+struct RingHandle
+{
+  RingHandle() : ring(logger().createRing()) {}
+  ~RingHandle() { this->ring->closed.store(true); }
+
+  RingHandle(const RingHandle &) = delete;
+  RingHandle(RingHandle &&) noexcept = delete;
+  RingHandle &operator=(const RingHandle &) = delete;
+  RingHandle &operator=(RingHandle &&) noexcept = delete;
+
+  std::shared_ptr<LogRing> ring;
+};
+
+LogRing &threadRing()
+{
+  thread_local RingHandle handle;
+  return *handle.ring;
+}
+
+std::string formatArg(const LogRecord &record, const LogRecord::Arg &arg,
+                      std::string_view spec)
+{
+  using Type = LogRecord::Arg::Type;
+
+  auto format = std::format("{{{}}}", spec);
+  auto formatValue = [&](auto value)
+  { return std::vformat(format, std::make_format_args(value)); };
+
+  switch (arg.type)
+  {
+  case Type::Int:
+    return formatValue(arg.i);
+  case Type::UInt:
+    return formatValue(arg.u);
+  case Type::Double:
+    return formatValue(arg.d);
+  case Type::Bool:
+    return formatValue(arg.b);
+  case Type::Text:
+    return formatValue(std::string_view{
+        record.text.data() + arg.text.offset, arg.text.size});
+  }
+  return {};
+}
+
+} // namespace
+
+std::string_view logLevelName(LogLevel level)
+{
+  switch (level)
+  {
+  case LogLevel::Debug:
+    return "debug"sv;
+  case LogLevel::Info:
+    return "info"sv;
+  case LogLevel::Warning:
+    return "warning"sv;
+  case LogLevel::Error:
+    return "error"sv;
+  }
+  return "unknown"sv;
+}
+
+void LogRecord::push(std::string_view value)
+{
+  if (this->argCount >= MAX_ARGS)
+  {
+    return;
+  }
+
+  auto size = std::min(value.size(), TEXT_CAPACITY - this->textSize);
+  this->truncated = this->truncated || size < value.size();
+  std::copy_n(value.data(), size, this->text.data() + this->textSize);
+
+  auto &arg = this->args[this->argCount++];
+  arg.type = Arg::Type::Text;
+  arg.text.offset = this->textSize;
+  arg.text.size = static_cast<std::uint16_t>(size);
+  this->textSize = static_cast<std::uint16_t>(this->textSize + size);
+}
+
+std::string LogRecord::message() const
+{
+  std::string out;
+  std::size_t nextArg = 0;
+  auto fmt = this->format;
+  while (!fmt.empty())
+  {
+    auto pos = fmt.find_first_of("{}");
+    out += fmt.substr(0, pos);
+    if (pos == std::string_view::npos)
+    {
+      break;
+    }
+
+    // escaped braces
+    if (pos + 1 < fmt.size() && fmt[pos + 1] == fmt[pos])
+    {
+      out += fmt[pos];
+      fmt.remove_prefix(pos + 2);
+      continue;
+    }
+
+    auto end = fmt.find('}', pos);
+    if (fmt[pos] == '}' || end == std::string_view::npos)
+    {
+      break; // already checked by std::format_string
+    }
+    if (nextArg < this->argCount)
+    {
+      out += formatArg(*this, this->args[nextArg++],
+                       fmt.substr(pos + 1, end - pos - 1));
+    }
+    fmt.remove_prefix(end + 1);
+  }
+
+  if (this->truncated)
+  {
+    out += " [truncated]"sv;
+  }
+  return out;
+}
+
+void Log::addSink(std::unique_ptr<LogSink> sink)
+{
+  logger().addSink(std::move(sink));
+}
+
+void Log::start()
+{
+  logger().start();
+  running_.store(true);
+}
+
+void Log::stop()
+{
+  running_.store(false);
+  logger().stop();
+}
+
+void Log::setThreadName(std::string_view name)
+{
+  auto &ring = threadRing();
+  std::lock_guard lock(ring.nameMtx);
+  ring.name = name;
+}
+
+LogRecord *Log::beginRecord()
+{
+  auto &ring = threadRing();
+  auto head = ring.head.load(std::memory_order_relaxed);
+  if (head - ring.tail.load(std::memory_order_acquire) >= RING_SIZE)
+  {
+    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  auto &record = ring.records[head % RING_SIZE];
+  record.time = std::chrono::system_clock::now();
+  record.argCount = 0;
+  record.textSize = 0;
+  record.truncated = false;
+  return &record;
+}
+
+void Log::commitRecord()
+{
+  auto &ring = threadRing();
+  ring.head.fetch_add(1, std::memory_order_release);
+  logger().wake();
+}
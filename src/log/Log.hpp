@@ -0,0 +1,205 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum class LogLevel : std::uint8_t
+{
+  Debug,
+  Info,
+  Warning,
+  Error,
+};
+
+std::string_view logLevelName(LogLevel level);
+
+/// A log call that hasn't been formatted yet. Records have a fixed size and
+/// live in a per-thread ring, so logging never allocates.
+struct LogRecord
+{
+  static constexpr std::size_t MAX_ARGS = 8;
+  static constexpr std::size_t TEXT_CAPACITY = 320;
+
+  struct Arg
+  {
+    enum class Type : std::uint8_t
+    {
+      Int,
+      UInt,
+      Double,
+      Bool,
+      Text,
+    };
+
+    Type type;
+    union
+    {
+      std::int64_t i;
+      std::uint64_t u;
+      double d;
+      bool b;
+      struct
+      {
+        std::uint16_t offset;
+        std::uint16_t size;
+      } text;
+    };
+  };
+
+  std::chrono::system_clock::time_point time;
+  /// Points to the (static) format string of the call site
+  std::string_view format;
+  LogLevel level = LogLevel::Info;
+  std::uint8_t argCount = 0;
+  std::uint16_t textSize = 0;
+  /// Set if a string argument didn't fit into `text`
+  bool truncated = false;
+
+  std::array<Arg, MAX_ARGS> args;
+  std::array<char, TEXT_CAPACITY> text;
+
+  void push(std::string_view value);
+  template <typename T> void push(const T &value);
+
+  /// Formats the message - called on the logger thread.
+  std::string message() const;
+};
+
+/// Receives formatted log messages on the logger thread.
+class LogSink
+{
+public:
+  virtual ~LogSink() = default;
+
+  virtual void write(const LogRecord &record, std::string_view thread,
+                     std::string_view message) = 0;
+  virtual void flush() {}
+};
+
+/// Structured, leveled logging that is cheap to call from the IO thread.
+///
+/// A call only copies its arguments into a fixed-size record in a lock-free
+/// ring owned by the calling thread. The logger thread formats the records
+/// later and hands them to the sinks, so the caller never formats, allocates
+/// or waits on the UI. Messages are dropped (and counted) if a ring is full.
+///
+/// Format strings use `std::format` syntax and must be string literals.
+class Log
+{
+public:
+  static void addSink(std::unique_ptr<LogSink> sink);
+  /// Starts the logger thread. Must be called after all sinks were added.
+  static void start();
+  /// Writes all pending messages and stops the logger thread.
+  static void stop();
+
+  static void setLevel(LogLevel level)
+  {
+    minLevel_.store(level, std::memory_order_relaxed);
+  }
+  /// Names the calling thread in the logs.
+  static void setThreadName(std::string_view name);
+
+  static bool enabled(LogLevel level)
+  {
+    return running_.load(std::memory_order_relaxed) &&
+           level >= minLevel_.load(std::memory_order_relaxed);
+  }
+
+  template <typename... Args>
+  static void write(LogLevel level, std::format_string<Args...> format,
+                    const Args &...args)
+  {
+    static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS,
+                  "Too many log arguments");
+    if (!enabled(level))
+    {
+      return;
+    }
+    auto *record = beginRecord();
+    if (record == nullptr)
+    {
+      return;
+    }
+    record->level = level;
+    record->format = format.get();
+    (record->push(args), ...);
+    commitRecord();
+  }
+
+  template <typename... Args>
+  static void debug(std::format_string<Args...> format, const Args &...args)
+  {
+    write(LogLevel::Debug, format, args...);
+  }
+  template <typename... Args>
+  static void info(std::format_string<Args...> format, const Args &...args)
+  {
+    write(LogLevel::Info, format, args...);
+  }
+  template <typename... Args>
+  static void warn(std::format_string<Args...> format, const Args &...args)
+  {
+    write(LogLevel::Warning, format, args...);
+  }
+  template <typename... Args>
+  static void error(std::format_string<Args...> format, const Args &...args)
+  {
+    write(LogLevel::Error, format, args...);
+  }
+
+private:
+  /// Returns a cleared record in the calling thread's ring or `nullptr` if
+  /// the ring is full.
+  static LogRecord *beginRecord();
+  static void commitRecord();
+
+  static inline std::atomic<bool> running_{false};
+  static inline std::atomic<LogLevel> minLevel_{LogLevel::Info};
+};
+
+template <typename T> void LogRecord::push(const T &value)
+{
+  if (this->argCount >= MAX_ARGS)
+  {
+    return;
+  }
+  auto &arg = this->args[this->argCount];
+
+  if constexpr (std::is_same_v<T, bool>)
+  {
+    arg.type = Arg::Type::Bool;
+    arg.b = value;
+  }
+  else if constexpr (std::signed_integral<T>)
+  {
+    arg.type = Arg::Type::Int;
+    arg.i = value;
+  }
+  else if constexpr (std::unsigned_integral<T>)
+  {
+    arg.type = Arg::Type::UInt;
+    arg.u = value;
+  }
+  else if constexpr (std::floating_point<T>)
+  {
+    arg.type = Arg::Type::Double;
+    arg.d = value;
+  }
+  else
+  {
+    static_assert(std::is_convertible_v<const T &, std::string_view>,
+                  "Unsupported log argument");
+    this->push(std::string_view{value});
+    return;
+  }
+  this->argCount++;
+}
@@ -0,0 +1,83 @@
+#include "log/LogHistory.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle)
+{
+  auto lower = [](char c)
+  { return std::tolower(static_cast<unsigned char>(c)); };
+  return !std::ranges::search(haystack, needle, {}, lower, lower).empty();
+}
+
+} // namespace
+
+bool LogFilter::matches(const LogEntry &entry) const
+{
+  return entry.level >= this->minLevel &&
+         (this->text.empty() || containsIgnoreCase(entry.message, this->text));
+}
+
+LogHistory::LogHistory(std::size_t capacity)
+    : capacity_(std::max<std::size_t>(capacity, 1))
+{
+  this->entries_.reserve(this->capacity_);
+}
+
+LogHistory::PushResult
+LogHistory::push(std::chrono::system_clock::time_point time, LogLevel level,
+                 std::string_view message)
+{
+  PushResult result;
+  auto seq = this->next_++;
+
+  if (this->entries_.size() < this->capacity_)
+  {
+    this->entries_.emplace_back();
+  }
+  else
+  {
+    // the entry at `seq` is about to be overwritten
+    auto evictedSeq = seq - this->capacity_;
+    if (!this->visible_.empty() && this->visible_.front() == evictedSeq)
+    {
+      this->visible_.pop_front();
+      result.evicted = true;
+    }
+  }
+
+  auto &entry = this->entries_[seq % this->capacity_];
+  entry.time = time;
+  entry.level = level;
+  entry.message.assign(message.substr(0, MAX_MESSAGE_SIZE));
+
+  if (this->filter_.matches(entry))
+  {
+    this->visible_.emplace_back(seq);
+    result.appended = true;
+  }
+  return result;
+}
+
+const LogEntry &LogHistory::at(std::size_t index) const
+{
+  return this->entry(this->visible_[index]);
+}
+
+void LogHistory::setFilter(LogFilter filter)
+{
+  this->filter_ = std::move(filter);
+  this->visible_.clear();
+
+  auto first = this->next_ - this->entries_.size();
+  for (auto seq = first; seq < this->next_; seq++)
+  {
+    if (this->filter_.matches(this->entry(seq)))
+    {
+      this->visible_.emplace_back(seq);
+    }
+  }
+}
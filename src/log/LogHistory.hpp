@@ -0,0 +1,76 @@
+#pragma once
+
+#include "log/Log.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct LogEntry
+{
+  std::chrono::system_clock::time_point time;
+  LogLevel level = LogLevel::Info;
+  std::string message;
+};
+
+struct LogFilter
+{
+  LogLevel minLevel = LogLevel::Debug;
+  /// Case-insensitive substring of the message, empty matches everything
+  std::string text;
+
+  bool matches(const LogEntry &entry) const;
+};
+
+/// The last `capacity` log entries in a ring, plus the sequence numbers of
+/// the entries that pass the current filter.
+///
+/// Pushing is O(1) and reuses the storage of the entry it replaces. A filter
+/// only indexes entries, it never copies them.
+class LogHistory
+{
+public:
+  /// Longer messages are truncated.
+  static constexpr std::size_t MAX_MESSAGE_SIZE = 1024;
+
+  struct PushResult
+  {
+    /// The new entry passed the filter
+    bool appended = false;
+    /// The oldest entry that passed the filter was evicted
+    bool evicted = false;
+  };
+
+  explicit LogHistory(std::size_t capacity);
+
+  PushResult push(std::chrono::system_clock::time_point time, LogLevel level,
+                  std::string_view message);
+
+  /// Number of entries that pass the filter.
+  std::size_t size() const { return this->visible_.size(); }
+  /// The `index`-th entry (oldest first) that passes the filter.
+  const LogEntry &at(std::size_t index) const;
+
+  const LogFilter &filter() const { return this->filter_; }
+  /// Rebuilds the index - O(capacity).
+  void setFilter(LogFilter filter);
+
+  std::size_t capacity() const { return this->capacity_; }
+
+private:
+  const LogEntry &entry(std::uint64_t seq) const
+  {
+    return this->entries_[seq % this->capacity_];
+  }
+
+  std::size_t capacity_;
+  std::vector<LogEntry> entries_;
+  /// Sequence number of the next entry
+  std::uint64_t next_ = 0;
+
+  LogFilter filter_;
+  std::deque<std::uint64_t> visible_;
+};
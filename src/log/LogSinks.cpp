@@ -0,0 +1,117 @@
+#include "log/LogSinks.hpp"
+
+#include <chrono>
+#include <format>
+#include <iterator>
+#include <print>
+#include <stdexcept>
+
+namespace
+{
+
+std::string_view::size_type nextSpecial(std::string_view s)
+{
+  for (std::size_t i = 0; i < s.size(); i++)
+  {
+    auto c = static_cast<unsigned char>(s[i]);
+    if (c < 0x20 || c == '"' || c == '\\')
+    {
+      return i;
+    }
+  }
+  return std::string_view::npos;
+}
+
+void appendJsonString(std::string &out, std::string_view s)
+{
+  out += '"';
+  for (;;)
+  {
+    auto pos = nextSpecial(s);
+    out += s.substr(0, pos);
+    if (pos == std::string_view::npos)
+    {
+      break;
+    }
+
+    switch (s[pos])
+    {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      std::format_to(std::back_inserter(out), "\\u{:04x}",
+                     static_cast<unsigned char>(s[pos]));
+      break;
+    }
+    s.remove_prefix(pos + 1);
+  }
+  out += '"';
+}
+
+/// UTC, millisecond precision
+std::string formatTime(std::chrono::system_clock::time_point time)
+{
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                time.time_since_epoch()) %
+            1000;
+  return std::format("{:%FT%T}.{:03}Z",
+                     std::chrono::floor<std::chrono::seconds>(time),
+                     ms.count());
+}
+
+} // namespace
+
+JsonLinesSink::JsonLinesSink(const std::filesystem::path &path)
+    : out_(path, std::ios::app | std::ios::binary)
+{
+  if (!this->out_)
+  {
+    throw std::runtime_error("Failed to open " + path.string());
+  }
+}
+
+void JsonLinesSink::write(const LogRecord &record, std::string_view thread,
+                          std::string_view message)
+{
+  this->line_.clear();
+  this->line_ += R"({"ts":")";
+  this->line_ += formatTime(record.time);
+  this->line_ += R"(","level":")";
+  this->line_ += logLevelName(record.level);
+  this->line_ += R"(","thread":)";
+  appendJsonString(this->line_, thread);
+  this->line_ += R"(,"msg":)";
+  appendJsonString(this->line_, message);
+  this->line_ += "}\n";
+  this->out_ << this->line_;
+}
+
+void JsonLinesSink::flush()
+{
+  this->out_.flush();
+}
+
+void StreamSink::write(const LogRecord &record, std::string_view thread,
+                       std::string_view message)
+{
+  std::println(this->file_, "{} [{}] [{}] {}", formatTime(record.time),
+               logLevelName(record.level), thread, message);
+}
+
+void StreamSink::flush()
+{
+  std::fflush(this->file_);
+}
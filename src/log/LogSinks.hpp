@@ -0,0 +1,38 @@
+#pragma once
+
+#include "log/Log.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+/// Writes one JSON object per line with the fields `ts` (UTC, ISO 8601),
+/// `level`, `thread` and `msg`.
+class JsonLinesSink : public LogSink
+{
+public:
+  /// Appends to `path` - throws if it can't be opened.
+  explicit JsonLinesSink(const std::filesystem::path &path);
+
+  void write(const LogRecord &record, std::string_view thread,
+             std::string_view message) override;
+  void flush() override;
+
+private:
+  std::ofstream out_;
+  std::string line_;
+};
+
+/// Writes human-readable lines to a `FILE` (usually `stderr`).
+class StreamSink : public LogSink
+{
+public:
+  explicit StreamSink(std::FILE *file) : file_(file) {}
+
+  void write(const LogRecord &record, std::string_view thread,
+             std::string_view message) override;
+  void flush() override;
+
+private:
+  std::FILE *file_;
+};
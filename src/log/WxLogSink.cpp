@@ -0,0 +1,24 @@
+#include "log/WxLogSink.hpp"
+
+#include <wx/log.h>
+
+void WxLogSink::write(const LogRecord &record, std::string_view /*thread*/,
+                      std::string_view message)
+{
+  wxString text = wxString::FromUTF8(message.data(), message.size());
+  switch (record.level)
+  {
+  case LogLevel::Debug:
+    wxLogDebug("%s", text);
+    break;
+  case LogLevel::Info:
+    wxLogMessage("%s", text);
+    break;
+  case LogLevel::Warning:
+    wxLogWarning("%s", text);
+    break;
+  case LogLevel::Error:
+    wxLogError("%s", text);
+    break;
+  }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "log/Log.hpp"
+
+/// Forwards log messages to wxLog (and thus to `LogView`). wx queues messages
+/// from non-UI threads, so the logger thread never touches the UI directly.
+class WxLogSink : public LogSink
+{
+public:
+  void write(const LogRecord &record, std::string_view thread,
+             std::string_view message) override;
+};
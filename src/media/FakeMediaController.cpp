@@ -0,0 +1,101 @@
+#include "media/FakeMediaController.hpp"
+
+FakeMediaController::FakeMediaController(Options options)
+    : options_(options),
+      worker_([this](const std::stop_token &stop) { this->run(stop); })
+{
+}
+
+FakeMediaController::~FakeMediaController()
+{
+  this->worker_.request_stop();
+  this->worker_.join();
+}
+
+MediaState FakeMediaController::state() const
+{
+  std::lock_guard lock(this->mtx_);
+  return this->state_;
+}
+
+void FakeMediaController::setState(MediaState state)
+{
+  bool trackChanged = false;
+  {
+    std::lock_guard lock(this->mtx_);
+    trackChanged = state.title != this->state_.title;
+    this->state_ = state;
+  }
+  if (trackChanged)
+  {
+    this->notifyTrackChanged(state);
+  }
+}
+
+void FakeMediaController::setFailing(bool failing)
+{
+  std::lock_guard lock(this->mtx_);
+  this->failing_ = failing;
+}
+
+void FakeMediaController::skip(SkipCallback done)
+{
+  {
+    std::lock_guard lock(this->mtx_);
+    this->pending_.emplace_back(std::move(done));
+  }
+  this->condvar_.notify_one();
+}
+
+std::uint64_t FakeMediaController::skips() const
+{
+  std::lock_guard lock(this->mtx_);
+  return this->skips_;
+}
+
+void FakeMediaController::run(const std::stop_token &stop)
+{
+  std::unique_lock lock(this->mtx_);
+  while (this->condvar_.wait(lock, stop,
+                             [this] { return !this->pending_.empty(); }))
+  {
+    auto done = std::move(this->pending_.front());
+    this->pending_.pop_front();
+
+    lock.unlock();
+    auto outcome = this->doSkip();
+    if (done)
+    {
+      done(outcome);
+    }
+    lock.lock();
+  }
+}
+
+SkipOutcome FakeMediaController::doSkip()
+{
+  if (!this->options_.cached)
+  {
+    std::this_thread::sleep_for(4 * this->options_.query);
+  }
+
+  auto state = this->state();
+  if (!state.hasSession)
+  {
+    return SkipOutcome::NoSession;
+  }
+  if (state.status != PlaybackStatus::Playing)
+  {
+    return SkipOutcome::NotPlaying;
+  }
+
+  std::this_thread::sleep_for(this->options_.seek + this->options_.skip);
+
+  std::lock_guard lock(this->mtx_);
+  if (this->failing_)
+  {
+    return SkipOutcome::Failed;
+  }
+  this->skips_++;
+  return SkipOutcome::Skipped;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "media/MediaController.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+/// A media controller for benchmarks. Skips run on a worker thread and take
+/// as long as the configured latencies.
+class FakeMediaController : public MediaController
+{
+public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  struct Options
+  {
+    /// Latency of a single session lookup (the current session, its
+    /// playback info, media properties or timeline)
+    Duration query{};
+    Duration seek{};
+    Duration skip{};
+    /// Without a cache, every skip looks up the session and its properties
+    /// first (four queries).
+    bool cached = true;
+  };
+
+  explicit FakeMediaController(Options options);
+  ~FakeMediaController() override;
+
+  FakeMediaController(const FakeMediaController &) = delete;
+  FakeMediaController(FakeMediaController &&) noexcept = delete;
+  FakeMediaController &operator=(const FakeMediaController &) = delete;
+  FakeMediaController &operator=(FakeMediaController &&) noexcept = delete;
+
+  MediaState state() const override;
+  /// Notifies the track-changed handler if the title changed.
+  void setState(MediaState state);
+
+  /// Makes the following skips fail.
+  void setFailing(bool failing);
+
+  void skip(SkipCallback done) override;
+
+  /// Number of successful skips.
+  std::uint64_t skips() const;
+
+private:
+  void run(const std::stop_token &stop);
+  SkipOutcome doSkip();
+
+  Options options_;
+
+  mutable std::mutex mtx_;
+  std::condition_variable_any condvar_;
+  std::deque<SkipCallback> pending_;
+  MediaState state_{
+      .hasSession = true,
+      .status = PlaybackStatus::Playing,
+      .title = "Fake Song",
+  };
+  bool failing_ = false;
+  std::uint64_t skips_ = 0;
+
+  std::jthread worker_;
+};
@@ -0,0 +1,32 @@
+#include "media/MediaController.hpp"
+
+std::string_view skipOutcomeName(SkipOutcome outcome)
+{
+  switch (outcome)
+  {
+  case SkipOutcome::Skipped:
+    return "skipped";
+  case SkipOutcome::NoSession:
+    return "no_session";
+  case SkipOutcome::NotPlaying:
+    return "not_playing";
+  case SkipOutcome::Failed:
+    return "failed";
+  }
+  return "unknown";
+}
+
+void MediaController::setTrackChangedHandler(TrackCallback handler)
+{
+  std::lock_guard lock(this->handlerMtx_);
+  this->trackChanged_ = std::move(handler);
+}
+
+void MediaController::notifyTrackChanged(const MediaState &state)
+{
+  std::lock_guard lock(this->handlerMtx_);
+  if (this->trackChanged_)
+  {
+    this->trackChanged_(state);
+  }
+}
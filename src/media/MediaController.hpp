@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+enum class PlaybackStatus
+{
+  Unknown,
+  Stopped,
+  Paused,
+  Playing,
+};
+
+enum class SkipOutcome
+{
+  Skipped,
+  /// No app has a media session
+  NoSession,
+  /// The current session isn't playing
+  NotPlaying,
+  Failed,
+};
+
+std::string_view skipOutcomeName(SkipOutcome outcome);
+
+/// The last known state of the current media session.
+struct MediaState
+{
+  bool hasSession = false;
+  PlaybackStatus status = PlaybackStatus::Unknown;
+  std::string title;
+};
+
+/// Controls the system's current media session.
+///
+/// Implementations keep the session and its state current through change
+/// notifications, so a skip doesn't have to look anything up first.
+class MediaController
+{
+public:
+  using SkipCallback = std::function<void(SkipOutcome)>;
+  using TrackCallback = std::function<void(const MediaState &state)>;
+
+  virtual ~MediaController() = default;
+
+  virtual MediaState state() const = 0;
+
+  /// Skips to the next track and returns immediately. `done` runs on an
+  /// arbitrary thread once the skip finished.
+  virtual void skip(SkipCallback done) = 0;
+
+  /// `handler` runs on an arbitrary thread whenever a new track starts. It's
+  /// called with an internal lock held, so it won't run anymore once
+  /// `setTrackChangedHandler(nullptr)` returned.
+  void setTrackChangedHandler(TrackCallback handler);
+
+protected:
+  void notifyTrackChanged(const MediaState &state);
+
+private:
+  std::mutex handlerMtx_;
+  TrackCallback trackChanged_;
+};
@@ -0,0 +1,592 @@
+#include "media/MprisController.hpp"
+
+#include "log/Log.hpp"
+#include "trace/Trace.hpp"
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include <dbus/dbus.h>
+
+#include <algorithm>
+#include <format>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace
+{
+
+namespace asio = boost::asio;
+
+using asio::awaitable;
+using asio::use_awaitable;
+using boost::system::error_code;
+using namespace std::string_view_literals;
+
+constexpr const char *MPRIS_PATH = "/org/mpris/MediaPlayer2";
+constexpr const char *PLAYER_INTERFACE = "org.mpris.MediaPlayer2.Player";
+constexpr std::string_view PLAYER_PREFIX = "org.mpris.MediaPlayer2.";
+constexpr auto CALL_TIMEOUT = std::chrono::seconds(5);
+
+struct PendingReply
+{
+  std::function<void(DBusMessage *)> handler;
+  std::shared_ptr<asio::steady_timer> timeout;
+};
+
+class BusError
+{
+public:
+  BusError() { dbus_error_init(&this->error_); }
+  ~BusError() { dbus_error_free(&this->error_); }
+
+  BusError(const BusError &) = delete;
+  BusError(BusError &&) noexcept = delete;
+  BusError &operator=(const BusError &) = delete;
+  BusError &operator=(BusError &&) noexcept = delete;
+
+  DBusError *get() { return &this->error_; }
+  bool isSet() const { return dbus_error_is_set(&this->error_) != 0; }
+  std::string_view message() const
+  {
+    return this->error_.message != nullptr ? this->error_.message : "";
+  }
+
+private:
+  DBusError error_;
+};
+
+std::optional<std::string_view> readString(DBusMessageIter *iter)
+{
+  auto type = dbus_message_iter_get_arg_type(iter);
+  if (type != DBUS_TYPE_STRING && type != DBUS_TYPE_OBJECT_PATH)
+  {
+    return std::nullopt;
+  }
+  const char *value = nullptr;
+  dbus_message_iter_get_basic(iter, static_cast<void *>(&value));
+  return value;
+}
+
+/// Calls `fn(key, value)` for every entry of an `a{sv}` dictionary.
+template <typename Fn> void forEachEntry(DBusMessageIter *dict, Fn &&fn)
+{
+  if (dbus_message_iter_get_arg_type(dict) != DBUS_TYPE_ARRAY)
+  {
+    return;
+  }
+  DBusMessageIter entries;
+  dbus_message_iter_recurse(dict, &entries);
+  while (dbus_message_iter_get_arg_type(&entries) == DBUS_TYPE_DICT_ENTRY)
+  {
+    DBusMessageIter entry;
+    dbus_message_iter_recurse(&entries, &entry);
+    auto key = readString(&entry);
+    dbus_message_iter_next(&entry);
+    if (key && dbus_message_iter_get_arg_type(&entry) == DBUS_TYPE_VARIANT)
+    {
+      DBusMessageIter value;
+      dbus_message_iter_recurse(&entry, &value);
+      fn(*key, &value);
+    }
+    dbus_message_iter_next(&entries);
+  }
+}
+
+PlaybackStatus parseStatus(std::string_view status)
+{
+  if (status == "Playing"sv)
+  {
+    return PlaybackStatus::Playing;
+  }
+  if (status == "Paused"sv)
+  {
+    return PlaybackStatus::Paused;
+  }
+  if (status == "Stopped"sv)
+  {
+    return PlaybackStatus::Stopped;
+  }
+  return PlaybackStatus::Unknown;
+}
+
+DBusMessage *busCall(const char *method)
+{
+  return dbus_message_new_method_call("org.freedesktop.DBus",
+                                      "/org/freedesktop/DBus",
+                                      "org.freedesktop.DBus", method);
+}
+
+bool isReply(DBusMessage *reply)
+{
+  return reply != nullptr &&
+         dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN;
+}
+
+} // namespace
+
+MprisController::MprisController(const std::string &address)
+    : work_(this->ctx_.get_executor()),
+      socket_(this->ctx_)
+{
+  BusError error;
+  if (address.empty())
+  {
+    this->connection_ = dbus_bus_get_private(DBUS_BUS_SESSION, error.get());
+  }
+  else
+  {
+    this->connection_ =
+        dbus_connection_open_private(address.c_str(), error.get());
+    if (this->connection_ != nullptr &&
+        !dbus_bus_register(this->connection_, error.get()))
+    {
+      dbus_connection_close(this->connection_);
+      dbus_connection_unref(this->connection_);
+      this->connection_ = nullptr;
+    }
+  }
+  if (this->connection_ == nullptr)
+  {
+    throw std::runtime_error(
+        std::format("Failed to connect to D-Bus: {}", error.message()));
+  }
+  dbus_connection_set_exit_on_disconnect(this->connection_, FALSE);
+
+  dbus_bus_add_match(this->connection_,
+                     "type='signal',sender='org.freedesktop.DBus',"
+                     "interface='org.freedesktop.DBus',"
+                     "member='NameOwnerChanged',"
+                     "arg0namespace='org.mpris.MediaPlayer2'",
+                     error.get());
+  if (!error.isSet())
+  {
+    dbus_bus_add_match(this->connection_,
+                       "type='signal',"
+                       "interface='org.freedesktop.DBus.Properties',"
+                       "member='PropertiesChanged',"
+                       "path='/org/mpris/MediaPlayer2',"
+                       "arg0='org.mpris.MediaPlayer2.Player'",
+                       error.get());
+  }
+  if (error.isSet())
+  {
+    dbus_connection_close(this->connection_);
+    dbus_connection_unref(this->connection_);
+    throw std::runtime_error(
+        std::format("Failed to subscribe to MPRIS: {}", error.message()));
+  }
+
+  dbus_connection_add_filter(
+      this->connection_,
+      [](DBusConnection * /*connection*/, DBusMessage *message, void *self)
+      {
+        static_cast<MprisController *>(self)->handleSignal(message);
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+      },
+      this, nullptr);
+
+  int fd = -1;
+  dbus_connection_get_unix_fd(this->connection_, &fd);
+  this->socket_.assign(fd);
+
+  asio::post(this->ctx_, [this] { this->listPlayers(); });
+  asio::co_spawn(this->ctx_, this->readLoop(), asio::detached);
+  this->thread_ = std::thread(
+      [this]
+      {
+        Log::setThreadName("MPRIS");
+        this->ctx_.run();
+      });
+}
+
+MprisController::~MprisController()
+{
+  this->ctx_.stop();
+  this->thread_.join();
+
+  // the descriptor belongs to the connection
+  this->socket_.release();
+  dbus_connection_close(this->connection_);
+  dbus_connection_unref(this->connection_);
+}
+
+MediaState MprisController::state() const
+{
+  std::lock_guard lock(this->mtx_);
+  const auto *player = this->currentPlayer();
+  if (player == nullptr)
+  {
+    return {};
+  }
+  return {
+      .hasSession = true,
+      .status = player->status,
+      .title = player->title,
+  };
+}
+
+void MprisController::skip(SkipCallback done)
+{
+  asio::post(this->ctx_, [this, done = std::move(done)]() mutable
+             { this->doSkip(std::move(done)); });
+}
+
+awaitable<void> MprisController::readLoop()
+{
+  for (;;)
+  {
+    error_code ec;
+    co_await this->socket_.async_wait(
+        asio::posix::stream_descriptor::wait_read,
+        asio::redirect_error(use_awaitable, ec));
+    if (ec)
+    {
+      co_return;
+    }
+
+    if (!dbus_connection_read_write(this->connection_, 0))
+    {
+      Log::error("MPRIS: lost the D-Bus connection");
+      std::lock_guard lock(this->mtx_);
+      this->players_.clear();
+      co_return;
+    }
+    this->pump();
+  }
+}
+
+void MprisController::pump()
+{
+  while (dbus_connection_dispatch(this->connection_) ==
+         DBUS_DISPATCH_DATA_REMAINS)
+  {
+  }
+}
+
+void MprisController::call(DBusMessage *message, ReplyHandler handler)
+{
+  DBusPendingCall *pending = nullptr;
+  bool sent = message != nullptr &&
+              dbus_connection_send_with_reply(this->connection_, message,
+                                              &pending,
+                                              DBUS_TIMEOUT_INFINITE) &&
+              pending != nullptr;
+  if (message != nullptr)
+  {
+    dbus_message_unref(message);
+  }
+  if (!sent)
+  {
+    handler(nullptr);
+    return;
+  }
+
+  auto call =
+      std::shared_ptr<DBusPendingCall>(pending, dbus_pending_call_unref);
+  auto timeout = std::make_shared<asio::steady_timer>(this->ctx_, CALL_TIMEOUT);
+  auto *pendingReply = new PendingReply{
+      .handler = std::move(handler),
+      .timeout = timeout,
+  };
+
+  // Replies are only read on this thread, so the call can't have completed
+  // yet.
+  dbus_pending_call_set_notify(
+      pending,
+      [](DBusPendingCall *pending, void *data)
+      {
+        auto *state = static_cast<PendingReply *>(data);
+        state->timeout->cancel();
+        auto *reply = dbus_pending_call_steal_reply(pending);
+        state->handler(reply);
+        if (reply != nullptr)
+        {
+          dbus_message_unref(reply);
+        }
+      },
+      pendingReply,
+      [](void *data) { delete static_cast<PendingReply *>(data); });
+
+  // libdbus only enforces timeouts when it's integrated into a main loop.
+  timeout->async_wait(
+      [call, timeout, pendingReply](error_code ec)
+      {
+        if (!ec && !dbus_pending_call_get_completed(call.get()))
+        {
+          dbus_pending_call_cancel(call.get());
+          pendingReply->handler(nullptr);
+        }
+      });
+
+  // Flushing may read incoming messages as well, those are dispatched later.
+  dbus_connection_flush(this->connection_);
+  asio::post(this->ctx_, [this] { this->pump(); });
+}
+
+void MprisController::listPlayers()
+{
+  this->call(busCall("ListNames"),
+             [this](DBusMessage *reply)
+             {
+               DBusMessageIter args;
+               if (!isReply(reply) || !dbus_message_iter_init(reply, &args) ||
+                   dbus_message_iter_get_arg_type(&args) != DBUS_TYPE_ARRAY)
+               {
+                 Log::warn("MPRIS: failed to list bus names");
+                 return;
+               }
+
+               DBusMessageIter names;
+               dbus_message_iter_recurse(&args, &names);
+               for (; dbus_message_iter_get_arg_type(&names) != 0;
+                    dbus_message_iter_next(&names))
+               {
+                 auto name = readString(&names);
+                 if (name && name->starts_with(PLAYER_PREFIX))
+                 {
+                   this->addPlayer(std::string(*name), {});
+                 }
+               }
+             });
+}
+
+void MprisController::addPlayer(std::string name, std::string owner)
+{
+  if (owner.empty())
+  {
+    // Signals come from the unique name, look it up first.
+    auto *message = busCall("GetNameOwner");
+    const char *arg = name.c_str();
+    dbus_message_append_args(message, DBUS_TYPE_STRING, &arg,
+                             DBUS_TYPE_INVALID);
+    this->call(message,
+               [this, name](DBusMessage *reply)
+               {
+                 const char *owner = nullptr;
+                 if (isReply(reply) &&
+                     dbus_message_get_args(reply, nullptr, DBUS_TYPE_STRING,
+                                           &owner, DBUS_TYPE_INVALID))
+                 {
+                   this->addPlayer(name, owner);
+                 }
+               });
+    return;
+  }
+
+  {
+    std::lock_guard lock(this->mtx_);
+    auto it = std::ranges::find(this->players_, name, &Player::name);
+    if (it == this->players_.end())
+    {
+      Log::info("MPRIS: found {}", name);
+      this->players_.emplace_back();
+      it = std::prev(this->players_.end());
+    }
+    it->name = name;
+    it->owner = owner;
+    it->status = PlaybackStatus::Unknown;
+    it->title.clear();
+  }
+  this->fetchProperties(owner);
+}
+
+void MprisController::removePlayer(std::string_view name)
+{
+  std::lock_guard lock(this->mtx_);
+  auto removed = std::erase_if(this->players_, [&](const auto &player)
+                               { return player.name == name; });
+  if (removed > 0)
+  {
+    Log::info("MPRIS: {} is gone", name);
+  }
+}
+
+void MprisController::fetchProperties(const std::string &owner)
+{
+  auto *message = dbus_message_new_method_call(
+      owner.c_str(), MPRIS_PATH, "org.freedesktop.DBus.Properties", "GetAll");
+  const char *interface = PLAYER_INTERFACE;
+  dbus_message_append_args(message, DBUS_TYPE_STRING, &interface,
+                           DBUS_TYPE_INVALID);
+  this->call(message,
+             [this, owner](DBusMessage *reply)
+             {
+               DBusMessageIter args;
+               if (isReply(reply) && dbus_message_iter_init(reply, &args))
+               {
+                 this->applyProperties(owner, &args);
+               }
+             });
+}
+
+void MprisController::applyProperties(std::string_view owner,
+                                      DBusMessageIter *properties)
+{
+  std::optional<MediaState> changed;
+  {
+    std::lock_guard lock(this->mtx_);
+    auto it = std::ranges::find(this->players_, owner, &Player::owner);
+    if (it == this->players_.end())
+    {
+      return;
+    }
+
+    const auto *current = this->currentPlayer();
+    auto previousTitle = current != nullptr ? current->title : std::string{};
+    forEachEntry(
+        properties,
+        [&](std::string_view key, DBusMessageIter *value)
+        {
+          if (key == "PlaybackStatus"sv)
+          {
+            it->status = parseStatus(readString(value).value_or(""));
+          }
+          else if (key == "Metadata"sv)
+          {
+            it->title.clear();
+            forEachEntry(value,
+                         [&](std::string_view field, DBusMessageIter *entry)
+                         {
+                           if (field == "xesam:title"sv)
+                           {
+                             it->title = readString(entry).value_or("");
+                           }
+                         });
+          }
+        });
+
+    current = this->currentPlayer();
+    if (current != nullptr && !current->title.empty() &&
+        current->title != previousTitle)
+    {
+      changed = MediaState{
+          .hasSession = true,
+          .status = current->status,
+          .title = current->title,
+      };
+    }
+  }
+
+  // A new title (of the current player) counts as a new track.
+  if (changed)
+  {
+    this->notifyTrackChanged(*changed);
+  }
+}
+
+void MprisController::handleSignal(DBusMessage *message)
+{
+  if (dbus_message_is_signal(message, "org.freedesktop.DBus",
+                             "NameOwnerChanged"))
+  {
+    const char *name = nullptr;
+    const char *oldOwner = nullptr;
+    const char *newOwner = nullptr;
+    if (!dbus_message_get_args(message, nullptr, DBUS_TYPE_STRING, &name,
+                               DBUS_TYPE_STRING, &oldOwner, DBUS_TYPE_STRING,
+                               &newOwner, DBUS_TYPE_INVALID) ||
+        !std::string_view(name).starts_with(PLAYER_PREFIX))
+    {
+      return;
+    }
+
+    if (*newOwner == '\0')
+    {
+      this->removePlayer(name);
+    }
+    else
+    {
+      this->addPlayer(name, newOwner);
+    }
+    return;
+  }
+
+  if (dbus_message_is_signal(message, "org.freedesktop.DBus.Properties",
+                             "PropertiesChanged"))
+  {
+    DBusMessageIter args;
+    const char *sender = dbus_message_get_sender(message);
+    if (sender == nullptr || !dbus_message_iter_init(message, &args) ||
+        readString(&args) != std::string_view(PLAYER_INTERFACE))
+    {
+      return;
+    }
+    dbus_message_iter_next(&args);
+    this->applyProperties(sender, &args);
+  }
+}
+
+void MprisController::doSkip(SkipCallback done)
+{
+  auto finish = [done](SkipOutcome outcome)
+  {
+    if (done)
+    {
+      done(outcome);
+    }
+  };
+
+  std::string owner;
+  std::string title;
+  auto status = PlaybackStatus::Unknown;
+  {
+    std::lock_guard lock(this->mtx_);
+    const auto *player = this->currentPlayer();
+    if (player != nullptr)
+    {
+      owner = player->owner;
+      title = player->title.empty() ? "[?]" : player->title;
+      status = player->status;
+    }
+  }
+
+  if (owner.empty())
+  {
+    Log::info("No app is playing any song");
+    finish(SkipOutcome::NoSession);
+    return;
+  }
+  if (status != PlaybackStatus::Unknown && status != PlaybackStatus::Playing)
+  {
+    Log::info("Current app isn't playing any song");
+    finish(SkipOutcome::NotPlaying);
+    return;
+  }
+
+  auto span = std::make_shared<AsyncTraceSpan>("skip", "media");
+  this->call(dbus_message_new_method_call(owner.c_str(), MPRIS_PATH,
+                                          PLAYER_INTERFACE, "Next"),
+             [span, finish, title](DBusMessage *reply)
+             {
+               if (isReply(reply))
+               {
+                 Log::info("Skipped {}", title);
+                 finish(SkipOutcome::Skipped);
+                 return;
+               }
+
+               const char *error = reply != nullptr
+                                       ? dbus_message_get_error_name(reply)
+                                       : nullptr;
+               Log::warn("Failed to skip {}: {}", title,
+                         error != nullptr ? error : "no reply");
+               finish(SkipOutcome::Failed);
+             });
+}
+
+const MprisController::Player *MprisController::currentPlayer() const
+{
+  auto playing = std::ranges::find(this->players_, PlaybackStatus::Playing,
+                                   &Player::status);
+  if (playing != this->players_.end())
+  {
+    return &*playing;
+  }
+  return this->players_.empty() ? nullptr : &this->players_.front();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "media/MediaController.hpp"
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct DBusConnection;
+struct DBusMessage;
+struct DBusMessageIter;
+
+/// Controls MPRIS media players (`org.mpris.MediaPlayer2.*`) over D-Bus.
+///
+/// The controller keeps a private bus connection open on its own thread.
+/// Players and their playback status and title are tracked through
+/// `NameOwnerChanged` and `PropertiesChanged` signals, so a skip is a single
+/// `Next` call to a known player. Skips go to the first playing player, or
+/// the first player if none is playing.
+class MprisController : public MediaController
+{
+public:
+  /// Connects to the session bus, or to the bus at `address` (e.g. a
+  /// private `dbus-daemon`). Throws if the bus can't be reached.
+  explicit MprisController(const std::string &address = {});
+  ~MprisController() override;
+
+  MprisController(const MprisController &) = delete;
+  MprisController(MprisController &&) noexcept = delete;
+  MprisController &operator=(const MprisController &) = delete;
+  MprisController &operator=(MprisController &&) noexcept = delete;
+
+  MediaState state() const override;
+  void skip(SkipCallback done) override;
+
+private:
+  struct Player
+  {
+    /// Well-known name (`org.mpris.MediaPlayer2.<app>`)
+    std::string name;
+    /// Unique name (`:1.42`) - signals are sent from this one
+    std::string owner;
+    PlaybackStatus status = PlaybackStatus::Unknown;
+    std::string title;
+  };
+
+  using ReplyHandler = std::function<void(DBusMessage *reply)>;
+
+  boost::asio::awaitable<void> readLoop();
+  /// Dispatches all queued messages.
+  void pump();
+  /// Sends `message` (taking ownership of it). `handler` gets the reply, an
+  /// error or `nullptr`.
+  void call(DBusMessage *message, ReplyHandler handler);
+
+  void listPlayers();
+  void addPlayer(std::string name, std::string owner);
+  void removePlayer(std::string_view name);
+  void fetchProperties(const std::string &owner);
+  void applyProperties(std::string_view owner, DBusMessageIter *properties);
+  void doSkip(SkipCallback done);
+
+  void handleSignal(DBusMessage *message);
+
+  /// Must be called with `mtx_` held.
+  const Player *currentPlayer() const;
+
+  DBusConnection *connection_ = nullptr;
+
+  boost::asio::io_context ctx_;
+  boost::asio::executor_work_guard<boost::asio::io_context::executor_type>
+      work_;
+  boost::asio::posix::stream_descriptor socket_;
+
+  mutable std::mutex mtx_;
+  std::vector<Player> players_;
+
+  std::thread thread_;
+};
@@ -0,0 +1,98 @@
+#include "media/SkipDispatcher.hpp"
+
+#include "log/Log.hpp"
+
+namespace
+{
+
+Metrics::Counter outcomeCounter(SkipOutcome outcome)
+{
+  switch (outcome)
+  {
+  case SkipOutcome::Skipped:
+    return Metrics::Counter::SkipsSucceeded;
+  case SkipOutcome::NoSession:
+    return Metrics::Counter::SkipsNoSession;
+  case SkipOutcome::NotPlaying:
+    return Metrics::Counter::SkipsNotPlaying;
+  case SkipOutcome::Failed:
+    break;
+  }
+  return Metrics::Counter::SkipsFailed;
+}
+
+} // namespace
+
+SkipDispatcher::SkipDispatcher(std::shared_ptr<MediaController> media,
+                               std::shared_ptr<Metrics> metrics,
+                               Duration cooldown)
+    : media_(std::move(media)),
+      state_(std::make_shared<State>())
+{
+  this->state_->metrics = std::move(metrics);
+  this->state_->cooldown = cooldown;
+}
+
+SkipDispatcher::Result SkipDispatcher::request()
+{
+  auto now = std::chrono::steady_clock::now();
+  auto &metrics = *this->state_->metrics;
+  std::uint64_t skip = 0;
+  {
+    std::lock_guard lock(this->state_->mtx);
+    auto &state = *this->state_;
+    if (state.inFlight && now - state.dispatchedAt > IN_FLIGHT_TIMEOUT)
+    {
+      Log::warn("The last skip didn't finish - skipping again");
+      state.inFlight = false;
+    }
+    if (state.inFlight || now < state.cooldownUntil)
+    {
+      metrics.add(Metrics::Counter::SkipsCoalesced);
+      return Result::Coalesced;
+    }
+
+    state.inFlight = true;
+    state.dispatchedAt = now;
+    skip = ++state.generation;
+  }
+
+  metrics.add(Metrics::Counter::Skips);
+  this->media_->skip([state = this->state_, skip, now](SkipOutcome outcome)
+                     { state->finish(skip, now, outcome); });
+  return Result::Dispatched;
+}
+
+bool SkipDispatcher::inFlight() const
+{
+  std::lock_guard lock(this->state_->mtx);
+  return this->state_->inFlight;
+}
+
+void SkipDispatcher::setCooldown(Duration cooldown)
+{
+  std::lock_guard lock(this->state_->mtx);
+  this->state_->cooldown = cooldown;
+}
+
+void SkipDispatcher::State::finish(std::uint64_t skip,
+                                   std::chrono::steady_clock::time_point start,
+                                   SkipOutcome outcome)
+{
+  auto now = std::chrono::steady_clock::now();
+  this->metrics->record(Metrics::Stage::Skip, now - start);
+  this->metrics->add(outcomeCounter(outcome));
+
+  std::lock_guard lock(this->mtx);
+  // a newer skip was dispatched after this one timed out
+  if (skip != this->generation)
+  {
+    return;
+  }
+
+  this->inFlight = false;
+  if (outcome == SkipOutcome::Skipped)
+  {
+    this->cooldownUntil = now + this->cooldown;
+  }
+}
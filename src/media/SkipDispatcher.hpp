@@ -0,0 +1,63 @@
+#pragma once
+
+#include "media/MediaController.hpp"
+#include "metrics/Metrics.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+/// Sends skips to a `MediaController` one at a time.
+///
+/// A request while a skip is in flight, or during the cooldown after a
+/// successful skip, is coalesced into that skip - it was meant for the same
+/// track. Each dispatched skip records its latency and outcome in `Metrics`.
+///
+/// All methods are thread-safe. Skips that finish after the dispatcher was
+/// destroyed are still recorded.
+class SkipDispatcher
+{
+public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  static constexpr auto DEFAULT_COOLDOWN = std::chrono::seconds(3);
+  /// A skip that hasn't finished after this long doesn't block new ones.
+  static constexpr auto IN_FLIGHT_TIMEOUT = std::chrono::seconds(10);
+
+  enum class Result
+  {
+    Dispatched,
+    Coalesced,
+  };
+
+  SkipDispatcher(std::shared_ptr<MediaController> media,
+                 std::shared_ptr<Metrics> metrics,
+                 Duration cooldown = DEFAULT_COOLDOWN);
+
+  Result request();
+
+  bool inFlight() const;
+  void setCooldown(Duration cooldown);
+
+private:
+  struct State
+  {
+    std::shared_ptr<Metrics> metrics;
+
+    mutable std::mutex mtx;
+    Duration cooldown;
+    /// Incremented for every dispatched skip
+    std::uint64_t generation = 0;
+    bool inFlight = false;
+    std::chrono::steady_clock::time_point dispatchedAt;
+    std::chrono::steady_clock::time_point cooldownUntil;
+
+    void finish(std::uint64_t skip,
+                std::chrono::steady_clock::time_point start,
+                SkipOutcome outcome);
+  };
+
+  std::shared_ptr<MediaController> media_;
+  std::shared_ptr<State> state_;
+};
@@ -0,0 +1,105 @@
+#include "metrics/Histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace
+{
+
+constexpr std::uint64_t MAX_VALUE =
+    (std::uint64_t{1} << (Histogram::MAX_EXPONENT + 1)) - 1;
+
+} // namespace
+
+void Histogram::record(std::chrono::steady_clock::duration duration)
+{
+  auto ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  this->recordValue(ns > 0 ? static_cast<std::uint64_t>(ns) : 0);
+}
+
+void Histogram::recordValue(std::uint64_t value)
+{
+  this->counts_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  this->sum_.fetch_add(value, std::memory_order_relaxed);
+
+  auto max = this->max_.load(std::memory_order_relaxed);
+  while (value > max && !this->max_.compare_exchange_weak(
+                            max, value, std::memory_order_relaxed))
+  {
+  }
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+  Snapshot snap;
+  for (std::size_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    snap.counts[i] = this->counts_[i].load(std::memory_order_relaxed);
+    snap.count += snap.counts[i];
+  }
+  snap.sum = this->sum_.load(std::memory_order_relaxed);
+  snap.max = this->max_.load(std::memory_order_relaxed);
+  return snap;
+}
+
+std::size_t Histogram::bucketIndex(std::uint64_t value)
+{
+  value = std::min(value, MAX_VALUE);
+  if (value < SUB_BUCKETS)
+  {
+    return static_cast<std::size_t>(value);
+  }
+
+  auto exponent = static_cast<unsigned>(std::bit_width(value)) - 1;
+  auto shift = exponent - SUB_BUCKET_BITS;
+  auto group = exponent - SUB_BUCKET_BITS + 1;
+  return (group * SUB_BUCKETS) + ((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+std::uint64_t Histogram::bucketUpperBound(std::size_t index)
+{
+  if (index < SUB_BUCKETS)
+  {
+    return index;
+  }
+
+  auto group = index / SUB_BUCKETS;
+  auto sub = index % SUB_BUCKETS;
+  return ((SUB_BUCKETS + sub + 1) << (group - 1)) - 1;
+}
+
+std::uint64_t Histogram::Snapshot::quantile(double q) const
+{
+  if (this->count == 0)
+  {
+    return 0;
+  }
+
+  auto rank = static_cast<std::uint64_t>(
+      std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(this->count)));
+  rank = std::max<std::uint64_t>(rank, 1);
+
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    seen += this->counts[i];
+    if (seen >= rank)
+    {
+      return std::min(bucketUpperBound(i), this->max);
+    }
+  }
+  return this->max;
+}
+
+std::uint64_t Histogram::Snapshot::countAtMost(std::uint64_t value) const
+{
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < BUCKET_COUNT && bucketUpperBound(i) <= value;
+       i++)
+  {
+    total += this->counts[i];
+  }
+  return total;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/// A fixed-size latency histogram with HDR-style log-linear buckets.
+///
+/// Values (nanoseconds) below 16 get a bucket each, every power of two above
+/// that is split into 16 buckets - the relative error is at most 1/16. Values
+/// above ~36 minutes end up in the last bucket.
+///
+/// Recording is wait-free (relaxed atomic increments), so any thread can
+/// record while another one takes a snapshot.
+class alignas(64) Histogram
+{
+public:
+  static constexpr unsigned SUB_BUCKET_BITS = 4;
+  static constexpr unsigned SUB_BUCKETS = 1U << SUB_BUCKET_BITS;
+  static constexpr unsigned MAX_EXPONENT = 40;
+  static constexpr std::size_t BUCKET_COUNT =
+      (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+  struct Snapshot
+  {
+    std::array<std::uint64_t, BUCKET_COUNT> counts{};
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t max = 0;
+
+    /// The value at quantile `q` (0..1), rounded up to its bucket's bound.
+    std::uint64_t quantile(double q) const;
+    /// Number of values that are at most `value` (at bucket resolution).
+    std::uint64_t countAtMost(std::uint64_t value) const;
+  };
+
+  void record(std::chrono::steady_clock::duration duration);
+  void recordValue(std::uint64_t value);
+
+  Snapshot snapshot() const;
+
+  static std::size_t bucketIndex(std::uint64_t value);
+  /// The largest value that lands in bucket `index`.
+  static std::uint64_t bucketUpperBound(std::size_t index);
+
+private:
+  std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> counts_{};
+  std::atomic<std::uint64_t> sum_{0};
+  std::atomic<std::uint64_t> max_{0};
+};
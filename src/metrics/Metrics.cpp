@@ -0,0 +1,134 @@
+#include "metrics/Metrics.hpp"
+
+#include <format>
+#include <iterator>
+#include <string_view>
+
+namespace
+{
+
+using namespace std::string_view_literals;
+
+struct CounterInfo
+{
+  std::string_view name;
+  std::string_view help;
+};
+
+constexpr std::array<std::string_view, Metrics::STAGE_COUNT> STAGE_NAMES = {
+    "read"sv,         "parse"sv,    "match"sv,
+    "publish"sv,      "ui_apply"sv, "skip"sv,
+    "vote_to_skip"sv, "ping_rtt"sv, "delivery_lag"sv,
+};
+
+constexpr std::array<CounterInfo, Metrics::COUNTER_COUNT> COUNTERS = {
+    CounterInfo{"frames", "WebSocket frames received"},
+    CounterInfo{"bytes", "Payload bytes received (after inflating)"},
+    CounterInfo{"wire_bytes", "Bytes read from the socket"},
+    CounterInfo{"messages", "IRC messages handled"},
+    CounterInfo{"arena_overflows",
+                "Frames that didn't fit into the per-frame arena"},
+    CounterInfo{"votes", "Messages that matched the vote rules"},
+    CounterInfo{"duplicate_votes", "Votes from users that already voted"},
+    CounterInfo{"skips", "Skips dispatched"},
+    CounterInfo{"skips_coalesced",
+                "Skip requests merged into a skip in flight or cooling down"},
+    CounterInfo{"skips_succeeded", "Skips the media app accepted"},
+    CounterInfo{"skips_no_session", "Skips without a media session"},
+    CounterInfo{"skips_not_playing", "Skips while nothing was playing"},
+    CounterInfo{"skips_failed", "Skips that failed"},
+    CounterInfo{"reconnects", "Reconnects to the IRC server"},
+    CounterInfo{"oversized_frames", "Frames larger than the frame limit"},
+    CounterInfo{"oversized_messages",
+                "Messages dropped because they exceeded the receive budget"},
+    CounterInfo{"shed_bytes", "Bytes of dropped messages"},
+    CounterInfo{"rate_limited_messages",
+                "Messages dropped by the per-user rate limit"},
+    CounterInfo{"rate_limited_votes",
+                "Rate limited messages that started with the vote command"},
+    CounterInfo{"rate_limiter_evictions",
+                "Users evicted from the rate limiter's table"},
+    CounterInfo{"duplicate_messages",
+                "Messages another chat source already delivered"},
+    CounterInfo{"unhealthy_reconnects",
+                "Connections replaced because their latency degraded"},
+};
+
+constexpr std::array<CounterInfo, Metrics::GAUGE_COUNT> GAUGES = {
+    CounterInfo{"receive_buffer_capacity_bytes",
+                "Capacity of the receive buffer"},
+    CounterInfo{"receive_buffer_peak_bytes",
+                "Most bytes held by the receive buffer"},
+};
+
+/// Bucket bounds (in ns) of the exported histograms. The internal histogram
+/// is much finer, so these are only rounded to its resolution.
+constexpr std::array<std::uint64_t, 22> EXPORTED_BOUNDS = {
+    1'000,         2'500,         5'000,         10'000,
+    25'000,        50'000,        100'000,       250'000,
+    500'000,       1'000'000,     2'500'000,     5'000'000,
+    10'000'000,    25'000'000,    50'000'000,    100'000'000,
+    250'000'000,   500'000'000,   1'000'000'000, 2'500'000'000,
+    5'000'000'000, 10'000'000'000,
+};
+
+double toSeconds(std::uint64_t ns)
+{
+  return static_cast<double>(ns) / 1e9;
+}
+
+} // namespace
+
+std::string Metrics::renderPrometheus() const
+{
+  std::string out;
+  auto it = std::back_inserter(out);
+
+  for (std::size_t i = 0; i < COUNTER_COUNT; i++)
+  {
+    const auto &info = COUNTERS[i]; // NOLINT
+    std::format_to(it,
+                   "# HELP skipmysong_{0}_total {1}\n"
+                   "# TYPE skipmysong_{0}_total counter\n"
+                   "skipmysong_{0}_total {2}\n",
+                   info.name, info.help,
+                   this->counters_[i].value.load(std::memory_order_relaxed));
+  }
+
+  for (std::size_t i = 0; i < GAUGE_COUNT; i++)
+  {
+    const auto &info = GAUGES[i]; // NOLINT
+    std::format_to(it,
+                   "# HELP skipmysong_{0} {1}\n"
+                   "# TYPE skipmysong_{0} gauge\n"
+                   "skipmysong_{0} {2}\n",
+                   info.name, info.help,
+                   this->gauges_[i].value.load(std::memory_order_relaxed));
+  }
+
+  out += "# HELP skipmysong_stage_duration_seconds Latency of each pipeline "
+         "stage\n"
+         "# TYPE skipmysong_stage_duration_seconds histogram\n"sv;
+  for (std::size_t i = 0; i < STAGE_COUNT; i++)
+  {
+    auto snap = this->stages_[i].snapshot(); // NOLINT
+    auto stage = STAGE_NAMES[i];             // NOLINT
+    for (auto bound : EXPORTED_BOUNDS)
+    {
+      std::format_to(
+          it,
+          "skipmysong_stage_duration_seconds_bucket{{stage=\"{}\",le=\"{}\"}} "
+          "{}\n",
+          stage, toSeconds(bound), snap.countAtMost(bound));
+    }
+    std::format_to(
+        it,
+        "skipmysong_stage_duration_seconds_bucket{{stage=\"{0}\",le=\"+Inf\"}} "
+        "{1}\n"
+        "skipmysong_stage_duration_seconds_sum{{stage=\"{0}\"}} {2}\n"
+        "skipmysong_stage_duration_seconds_count{{stage=\"{0}\"}} {1}\n",
+        stage, snap.count, toSeconds(snap.sum));
+  }
+
+  return out;
+}
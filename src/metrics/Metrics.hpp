@@ -0,0 +1,152 @@
+#pragma once
+
+#include "metrics/Histogram.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/// Counters and per-stage latencies of the vote pipeline.
+///
+/// All updates are relaxed atomics, so recording is cheap on the IO and UI
+/// thread and `renderPrometheus` can run on any thread without locking.
+class Metrics
+{
+public:
+  enum class Stage : std::uint8_t
+  {
+    /// Frame read from the socket -> handed to the parser (recording etc.)
+    Read,
+    /// Parsing a single IRC message
+    Parse,
+    /// Checking a message against the rules
+    Match,
+    /// Handing a vote to the `VoteSink`
+    Publish,
+    /// Vote published -> counted on the UI thread
+    UiApply,
+    /// Skip dispatched -> the media controller reported the outcome
+    Skip,
+    /// Frame read from the socket -> skip dispatched
+    VoteToSkip,
+    /// Our PING sent -> its PONG read
+    PingRtt,
+    /// Sent by Twitch (`tmi-sent-ts`) -> read from the socket. This includes
+    /// the offset between our clock and Twitch's.
+    DeliveryLag,
+  };
+  static constexpr std::size_t STAGE_COUNT = 9;
+
+  enum class Counter : std::uint8_t
+  {
+    Frames,
+    /// Payload bytes (after inflating)
+    Bytes,
+    /// Bytes read from the socket
+    WireBytes,
+    Messages,
+    /// Frames whose replies etc. didn't fit into the `FrameArena`
+    ArenaOverflows,
+    /// Messages that matched the rules
+    Votes,
+    /// Votes from users that already voted
+    Duplicates,
+    /// Skips dispatched to the media controller
+    Skips,
+    /// Skip requests merged into one in flight (or cooling down)
+    SkipsCoalesced,
+    SkipsSucceeded,
+    SkipsNoSession,
+    SkipsNotPlaying,
+    SkipsFailed,
+    Reconnects,
+    /// Frames larger than the session accepts
+    OversizedFrames,
+    /// Messages dropped because they didn't fit into the receive budget
+    OversizedMessages,
+    /// Bytes of dropped messages
+    ShedBytes,
+    /// Messages dropped by the per-user rate limit
+    RateLimited,
+    /// Rate limited messages that started with the vote command
+    RateLimitedVotes,
+    /// Users the rate limiter forgot to make room for others
+    RateLimiterEvictions,
+    /// Messages another chat source already delivered
+    DuplicateMessages,
+    /// Connections replaced because their latency degraded
+    UnhealthyReconnects,
+  };
+  static constexpr std::size_t COUNTER_COUNT = 22;
+
+  enum class Gauge : std::uint8_t
+  {
+    /// Capacity of the receive buffer
+    ReceiveBufferCapacity,
+    /// Most bytes ever held by the receive buffer
+    ReceiveBufferPeak,
+  };
+  static constexpr std::size_t GAUGE_COUNT = 2;
+
+  void record(Stage stage, std::chrono::steady_clock::duration duration)
+  {
+    this->stages_[static_cast<std::size_t>(stage)].record(duration);
+  }
+
+  void add(Counter counter, std::uint64_t n = 1)
+  {
+    this->counters_[static_cast<std::size_t>(counter)].value.fetch_add(
+        n, std::memory_order_relaxed);
+  }
+
+  void set(Gauge gauge, std::uint64_t value)
+  {
+    this->gauges_[static_cast<std::size_t>(gauge)].value.store(
+        value, std::memory_order_relaxed);
+  }
+
+  /// Sets `gauge` to `value` if it's larger than the current value.
+  void raise(Gauge gauge, std::uint64_t value)
+  {
+    auto &target = this->gauges_[static_cast<std::size_t>(gauge)].value;
+    auto current = target.load(std::memory_order_relaxed);
+    while (current < value &&
+           !target.compare_exchange_weak(current, value,
+                                         std::memory_order_relaxed))
+    {
+    }
+  }
+
+  const Histogram &histogram(Stage stage) const
+  {
+    return this->stages_[static_cast<std::size_t>(stage)];
+  }
+
+  std::uint64_t value(Counter counter) const
+  {
+    return this->counters_[static_cast<std::size_t>(counter)].value.load(
+        std::memory_order_relaxed);
+  }
+
+  std::uint64_t value(Gauge gauge) const
+  {
+    return this->gauges_[static_cast<std::size_t>(gauge)].value.load(
+        std::memory_order_relaxed);
+  }
+
+  /// Renders all metrics in the Prometheus text exposition format.
+  std::string renderPrometheus() const;
+
+private:
+  // counters are updated from different threads
+  struct alignas(64) PaddedCounter
+  {
+    std::atomic<std::uint64_t> value{0};
+  };
+
+  std::array<Histogram, STAGE_COUNT> stages_;
+  std::array<PaddedCounter, COUNTER_COUNT> counters_;
+  std::array<PaddedCounter, GAUGE_COUNT> gauges_;
+};
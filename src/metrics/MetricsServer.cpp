@@ -0,0 +1,101 @@
+#include "metrics/MetricsServer.hpp"
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <print>
+
+namespace
+{
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+
+using asio::awaitable;
+using asio::use_awaitable;
+using asio::ip::tcp;
+using boost::system::error_code;
+
+} // namespace
+
+MetricsServer::MetricsServer(std::shared_ptr<const Metrics> metrics,
+                             std::uint16_t port)
+    : metrics_(std::move(metrics)),
+      acceptor_(this->ctx_, {asio::ip::address_v4::loopback(), port})
+{
+  asio::co_spawn(this->ctx_, this->listen(), asio::detached);
+  this->thread_ = std::thread([this] { this->ctx_.run(); });
+}
+
+MetricsServer::~MetricsServer()
+{
+  this->ctx_.stop();
+  this->thread_.join();
+}
+
+std::uint16_t MetricsServer::port() const
+{
+  return this->acceptor_.local_endpoint().port();
+}
+
+awaitable<void> MetricsServer::listen()
+{
+  for (;;)
+  {
+    error_code ec;
+    auto socket = co_await this->acceptor_.async_accept(
+        asio::redirect_error(use_awaitable, ec));
+    if (ec)
+    {
+      std::println(stderr, "Metrics: failed to accept: {}", ec.message());
+      co_return;
+    }
+    asio::co_spawn(this->ctx_, this->serve(std::move(socket)), asio::detached);
+  }
+}
+
+awaitable<void> MetricsServer::serve(tcp::socket socket)
+{
+  beast::flat_buffer buf;
+  for (;;)
+  {
+    error_code ec;
+    http::request<http::empty_body> req;
+    co_await http::async_read(socket, buf, req,
+                              asio::redirect_error(use_awaitable, ec));
+    if (ec)
+    {
+      co_return; // closed (or garbage)
+    }
+
+    http::response<http::string_body> res;
+    res.version(req.version());
+    res.keep_alive(req.keep_alive());
+    if (req.method() != http::verb::get || req.target() != "/metrics")
+    {
+      res.result(http::status::not_found);
+      res.set(http::field::content_type, "text/plain");
+      res.body() = "Not found - try /metrics\n";
+    }
+    else
+    {
+      res.result(http::status::ok);
+      res.set(http::field::content_type, "text/plain; version=0.0.4");
+      res.body() = this->metrics_->renderPrometheus();
+    }
+    res.prepare_payload();
+
+    co_await http::async_write(socket, res,
+                               asio::redirect_error(use_awaitable, ec));
+    if (ec || !res.keep_alive())
+    {
+      co_return;
+    }
+  }
+}
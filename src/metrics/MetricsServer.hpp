@@ -0,0 +1,40 @@
+#pragma once
+
+#include "metrics/Metrics.hpp"
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+/// Serves `Metrics` on `http://127.0.0.1:<port>/metrics` in the Prometheus
+/// text format.
+///
+/// The server runs on its own thread. A scrape only reads atomics, so it never
+/// waits on the IO or UI thread.
+class MetricsServer
+{
+public:
+  /// Starts listening right away - pass port 0 to pick a free port.
+  MetricsServer(std::shared_ptr<const Metrics> metrics, std::uint16_t port);
+  ~MetricsServer();
+
+  MetricsServer(const MetricsServer &) = delete;
+  MetricsServer(MetricsServer &&) noexcept = delete;
+  MetricsServer &operator=(const MetricsServer &) = delete;
+  MetricsServer &operator=(MetricsServer &&) noexcept = delete;
+
+  std::uint16_t port() const;
+
+private:
+  boost::asio::awaitable<void> listen();
+  boost::asio::awaitable<void> serve(boost::asio::ip::tcp::socket socket);
+
+  std::shared_ptr<const Metrics> metrics_;
+  boost::asio::io_context ctx_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+  std::thread thread_;
+};
@@ -0,0 +1,329 @@
+#include "overlay/OverlayServer.hpp"
+
+#include "log/Log.hpp"
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <algorithm>
+#include <format>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+
+using asio::awaitable;
+using asio::use_awaitable;
+using asio::ip::tcp;
+using boost::system::error_code;
+using namespace std::string_view_literals;
+
+/// Comments keep idle connections alive (and find closed ones)
+constexpr auto KEEP_ALIVE_INTERVAL = std::chrono::seconds(15);
+
+constexpr std::string_view EVENTS_HEADER = "HTTP/1.1 200 OK\r\n"
+                                           "Content-Type: text/event-stream\r\n"
+                                           "Cache-Control: no-cache\r\n"
+                                           "Access-Control-Allow-Origin: *\r\n"
+                                           "Connection: keep-alive\r\n"
+                                           "\r\n";
+
+constexpr std::string_view OVERLAY_PAGE = R"(<!DOCTYPE html>
+<html>
+<head>
+<meta charset="utf-8">
+<style>
+  body { margin: 0; font: bold 24px sans-serif; color: #fff;
+         text-shadow: 0 0 4px #000; background: transparent; }
+  #bar { height: 12px; background: rgba(0, 0, 0, 0.4); border-radius: 6px; }
+  #fill { height: 100%; width: 0; background: #9146ff; border-radius: 6px;
+          transition: width 0.2s; }
+  .disabled { opacity: 0.4; }
+  .skipped #fill { background: #2ecc71; }
+</style>
+</head>
+<body>
+<div id="label">Skip votes: 0/1</div>
+<div id="bar"><div id="fill"></div></div>
+<script>
+  const state = {};
+  const render = () => {
+    document.getElementById('label').textContent =
+      `Skip votes: ${state.count}/${state.threshold}`;
+    document.getElementById('fill').style.width =
+      `${Math.min(100, 100 * state.count / state.threshold)}%`;
+    document.body.classList.toggle('disabled', !state.enabled);
+  };
+  const events = new EventSource('/events');
+  events.addEventListener('state', e => {
+    Object.assign(state, JSON.parse(e.data));
+    render();
+  });
+  events.addEventListener('votes', e => {
+    Object.assign(state, JSON.parse(e.data));
+    render();
+  });
+  events.addEventListener('skip', () => {
+    document.body.classList.add('skipped');
+    setTimeout(() => document.body.classList.remove('skipped'), 2000);
+  });
+</script>
+</body>
+</html>
+)";
+
+const auto SKIP_EVENT =
+    std::make_shared<const std::string>("event: skip\ndata: {}\n\n");
+const auto KEEP_ALIVE_EVENT = std::make_shared<const std::string>(":\n\n");
+
+} // namespace
+
+struct OverlayServer::Subscriber
+{
+  explicit Subscriber(tcp::socket socket)
+      : socket(std::move(socket)),
+        wake(this->socket.get_executor())
+  {
+  }
+
+  tcp::socket socket;
+  /// Cancelled when there's something to write
+  asio::steady_timer wake;
+  std::vector<Buffer> queue;
+  /// Write the current `state` before the queue
+  bool resync = true;
+};
+
+OverlayServer::OverlayServer(asio::any_io_executor executor,
+                             std::uint16_t port)
+    : executor_(std::move(executor)),
+      acceptor_(this->executor_, {asio::ip::address_v4::loopback(), port})
+{
+  asio::co_spawn(this->executor_, this->listen(), asio::detached);
+}
+
+OverlayServer::~OverlayServer() = default;
+
+std::uint16_t OverlayServer::port() const
+{
+  return this->acceptor_.local_endpoint().port();
+}
+
+void OverlayServer::publish(VoteSnapshot votes)
+{
+  asio::post(this->executor_, [this, votes] { this->apply(votes); });
+}
+
+void OverlayServer::publishSkip()
+{
+  asio::post(this->executor_, [this] { this->broadcast(SKIP_EVENT); });
+}
+
+void OverlayServer::apply(VoteSnapshot votes)
+{
+  const auto &old = this->votes_;
+  if (votes == old)
+  {
+    return;
+  }
+
+  // only the fields that changed
+  std::string event = "event: votes\ndata: {";
+  auto out = std::back_inserter(event);
+  auto separator = ""sv;
+  if (votes.count != old.count)
+  {
+    std::format_to(out, R"({}"count":{})", separator, votes.count);
+    separator = ","sv;
+  }
+  if (votes.threshold != old.threshold)
+  {
+    std::format_to(out, R"({}"threshold":{})", separator, votes.threshold);
+    separator = ","sv;
+  }
+  if (votes.enabled != old.enabled)
+  {
+    std::format_to(out, R"({}"enabled":{})", separator, votes.enabled);
+    separator = ","sv;
+  }
+  if (votes.rate != old.rate)
+  {
+    std::format_to(out, R"({}"rate":{:.1f})", separator, votes.rate);
+  }
+  event += "}\n\n";
+  this->serializations_.fetch_add(1, std::memory_order_relaxed);
+
+  this->votes_ = votes;
+  this->stateEvent_.reset();
+  this->broadcast(std::make_shared<const std::string>(std::move(event)));
+}
+
+void OverlayServer::broadcast(const Buffer &event)
+{
+  for (const auto &subscriber : this->subscribers_)
+  {
+    if (subscriber->queue.size() >= MAX_QUEUED)
+    {
+      // Too slow - the next write starts over with the current state. The
+      // deltas after that only contain absolute values, so the order is fine.
+      subscriber->queue.clear();
+      subscriber->resync = true;
+    }
+    subscriber->queue.emplace_back(event);
+    subscriber->wake.cancel();
+  }
+}
+
+const OverlayServer::Buffer &OverlayServer::stateEvent()
+{
+  if (!this->stateEvent_)
+  {
+    const auto &votes = this->votes_;
+    this->stateEvent_ = std::make_shared<const std::string>(std::format(
+        "event: state\ndata: "
+        R"({{"count":{},"threshold":{},"enabled":{},"rate":{:.1f}}})"
+        "\n\n",
+        votes.count, votes.threshold, votes.enabled, votes.rate));
+    this->serializations_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return this->stateEvent_;
+}
+
+awaitable<void> OverlayServer::listen()
+{
+  for (;;)
+  {
+    error_code ec;
+    auto socket = co_await this->acceptor_.async_accept(
+        asio::redirect_error(use_awaitable, ec));
+    if (ec)
+    {
+      Log::warn("Overlay: failed to accept: {}", ec.message());
+      co_return;
+    }
+    asio::co_spawn(this->executor_, this->serve(std::move(socket)),
+                   asio::detached);
+  }
+}
+
+awaitable<void> OverlayServer::serve(tcp::socket socket)
+{
+  beast::flat_buffer buf;
+  for (;;)
+  {
+    error_code ec;
+    http::request<http::empty_body> req;
+    co_await http::async_read(socket, buf, req,
+                              asio::redirect_error(use_awaitable, ec));
+    if (ec)
+    {
+      co_return; // closed (or garbage)
+    }
+
+    auto target = req.target();
+    target = target.substr(0, target.find('?'));
+    if (req.method() == http::verb::get && target == "/events")
+    {
+      co_await asio::async_write(socket, asio::buffer(EVENTS_HEADER),
+                                 asio::redirect_error(use_awaitable, ec));
+      if (!ec)
+      {
+        co_await this->stream(
+            std::make_shared<Subscriber>(std::move(socket)));
+      }
+      co_return;
+    }
+
+    http::response<http::string_body> res;
+    res.version(req.version());
+    res.keep_alive(req.keep_alive());
+    if (req.method() != http::verb::get || target != "/")
+    {
+      res.result(http::status::not_found);
+      res.set(http::field::content_type, "text/plain");
+      res.body() = "Not found - try / or /events\n";
+    }
+    else
+    {
+      res.result(http::status::ok);
+      res.set(http::field::content_type, "text/html; charset=utf-8");
+      res.body() = OVERLAY_PAGE;
+    }
+    res.prepare_payload();
+
+    co_await http::async_write(socket, res,
+                               asio::redirect_error(use_awaitable, ec));
+    if (ec || !res.keep_alive())
+    {
+      co_return;
+    }
+  }
+}
+
+awaitable<void> OverlayServer::stream(std::shared_ptr<Subscriber> subscriber)
+{
+  this->subscribers_.emplace_back(subscriber);
+  this->subscriberCount_.store(this->subscribers_.size(),
+                               std::memory_order_relaxed);
+  Log::debug("Overlay: {} subscribers", this->subscribers_.size());
+
+  std::vector<Buffer> inflight;
+  std::vector<asio::const_buffer> buffers;
+  for (;;)
+  {
+    if (subscriber->queue.empty() && !subscriber->resync)
+    {
+      error_code ec;
+      subscriber->wake.expires_after(KEEP_ALIVE_INTERVAL);
+      co_await subscriber->wake.async_wait(
+          asio::redirect_error(use_awaitable, ec));
+      if (!ec && subscriber->queue.empty())
+      {
+        subscriber->queue.emplace_back(KEEP_ALIVE_EVENT);
+      }
+      continue;
+    }
+
+    // Everything that's queued goes out in a single write. The buffers are
+    // shared with the other subscribers - `inflight` keeps them alive.
+    inflight.clear();
+    if (std::exchange(subscriber->resync, false))
+    {
+      inflight.emplace_back(this->stateEvent());
+    }
+    std::ranges::move(subscriber->queue, std::back_inserter(inflight));
+    subscriber->queue.clear();
+
+    buffers.clear();
+    for (const auto &event : inflight)
+    {
+      buffers.emplace_back(asio::buffer(*event));
+    }
+    error_code ec;
+    co_await asio::async_write(subscriber->socket, buffers,
+                               asio::redirect_error(use_awaitable, ec));
+    if (ec)
+    {
+      break; // the overlay was closed
+    }
+  }
+
+  std::erase(this->subscribers_, subscriber);
+  this->subscriberCount_.store(this->subscribers_.size(),
+                               std::memory_order_relaxed);
+  Log::debug("Overlay: {} subscribers", this->subscribers_.size());
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "VoteCounter.hpp"
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Pushes the vote progress to stream overlays (e.g. an OBS browser source)
+/// on `http://127.0.0.1:<port>/`.
+///
+/// `/events` is a stream of server-sent events: `state` with all fields
+/// when a client connects, `votes` with only the fields that changed and
+/// `skip` when a skip was dispatched. `/` serves a minimal overlay that
+/// shows them.
+///
+/// Every event is serialized once into a buffer that all subscribers share,
+/// so an update costs the same no matter how many overlays are open. A
+/// subscriber that falls too far behind gets a fresh `state` instead of the
+/// backlog.
+///
+/// The server runs on `executor` (usually the IO thread). `publish()` and
+/// `publishSkip()` can be called from any thread. It must be destroyed after
+/// the executor's context stopped running.
+class OverlayServer
+{
+public:
+  /// Events a subscriber may have queued before it's resynchronized
+  static constexpr std::size_t MAX_QUEUED = 64;
+
+  /// Starts listening right away - pass port 0 to pick a free port.
+  OverlayServer(boost::asio::any_io_executor executor, std::uint16_t port);
+  ~OverlayServer();
+
+  OverlayServer(const OverlayServer &) = delete;
+  OverlayServer(OverlayServer &&) noexcept = delete;
+  OverlayServer &operator=(const OverlayServer &) = delete;
+  OverlayServer &operator=(OverlayServer &&) noexcept = delete;
+
+  std::uint16_t port() const;
+
+  void publish(VoteSnapshot votes);
+  void publishSkip();
+
+  std::size_t subscribers() const
+  {
+    return this->subscriberCount_.load(std::memory_order_relaxed);
+  }
+  /// Events that were serialized (including `state` for new subscribers)
+  std::uint64_t serializations() const
+  {
+    return this->serializations_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Subscriber;
+  using Buffer = std::shared_ptr<const std::string>;
+
+  boost::asio::awaitable<void> listen();
+  boost::asio::awaitable<void> serve(boost::asio::ip::tcp::socket socket);
+  boost::asio::awaitable<void>
+  stream(std::shared_ptr<Subscriber> subscriber);
+
+  void apply(VoteSnapshot votes);
+  void broadcast(const Buffer &event);
+  /// The current `state` event - serialized once per change
+  const Buffer &stateEvent();
+
+  boost::asio::any_io_executor executor_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+
+  // only used on the executor
+  VoteSnapshot votes_;
+  Buffer stateEvent_;
+  std::vector<std::shared_ptr<Subscriber>> subscribers_;
+
+  std::atomic<std::size_t> subscriberCount_{0};
+  std::atomic<std::uint64_t> serializations_{0};
+};
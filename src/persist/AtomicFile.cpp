@@ -0,0 +1,177 @@
+#include "persist/AtomicFile.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+#ifdef _WIN32
+
+[[noreturn]] void throwLastError(const char *what)
+{
+  throw std::system_error(static_cast<int>(GetLastError()),
+                          std::system_category(), what);
+}
+
+/// Closes the handle when it goes out of scope
+struct FileHandle
+{
+  explicit FileHandle(HANDLE handle) : handle(handle) {}
+  ~FileHandle()
+  {
+    if (this->handle != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(this->handle);
+    }
+  }
+
+  FileHandle(const FileHandle &) = delete;
+  FileHandle(FileHandle &&) noexcept = delete;
+  FileHandle &operator=(const FileHandle &) = delete;
+  FileHandle &operator=(FileHandle &&) noexcept = delete;
+
+  HANDLE handle;
+};
+
+void writeDurably(const std::filesystem::path &path, std::string_view data)
+{
+  FileHandle file(CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+  if (file.handle == INVALID_HANDLE_VALUE)
+  {
+    throwLastError("CreateFile");
+  }
+  DWORD written = 0;
+  if (!WriteFile(file.handle, data.data(), static_cast<DWORD>(data.size()),
+                 &written, nullptr) ||
+      written != data.size())
+  {
+    throwLastError("WriteFile");
+  }
+  if (!FlushFileBuffers(file.handle))
+  {
+    throwLastError("FlushFileBuffers");
+  }
+}
+
+void replaceFile(const std::filesystem::path &from,
+                 const std::filesystem::path &to)
+{
+  if (!MoveFileExW(from.c_str(), to.c_str(),
+                   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+  {
+    throwLastError("MoveFileEx");
+  }
+}
+
+#else
+
+[[noreturn]] void throwErrno(const char *what)
+{
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+/// Closes the descriptor when it goes out of scope
+struct FileHandle
+{
+  explicit FileHandle(int fd) : fd(fd) {}
+  ~FileHandle()
+  {
+    if (this->fd >= 0)
+    {
+      ::close(this->fd);
+    }
+  }
+
+  FileHandle(const FileHandle &) = delete;
+  FileHandle(FileHandle &&) noexcept = delete;
+  FileHandle &operator=(const FileHandle &) = delete;
+  FileHandle &operator=(FileHandle &&) noexcept = delete;
+
+  int fd;
+};
+
+void writeDurably(const std::filesystem::path &path, std::string_view data)
+{
+  FileHandle file(
+      ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+  if (file.fd < 0)
+  {
+    throwErrno("open");
+  }
+  while (!data.empty())
+  {
+    auto written = ::write(file.fd, data.data(), data.size());
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      throwErrno("write");
+    }
+    data.remove_prefix(static_cast<std::size_t>(written));
+  }
+  if (::fsync(file.fd) != 0)
+  {
+    throwErrno("fsync");
+  }
+}
+
+void replaceFile(const std::filesystem::path &from,
+                 const std::filesystem::path &to)
+{
+  if (::rename(from.c_str(), to.c_str()) != 0)
+  {
+    throwErrno("rename");
+  }
+  // Persist the rename itself. Failing here doesn't lose anything that was
+  // there before, so errors are ignored.
+  auto dir = to.parent_path();
+  FileHandle dirFile(::open(dir.empty() ? "." : dir.c_str(),
+                            O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+  if (dirFile.fd >= 0)
+  {
+    ::fsync(dirFile.fd);
+  }
+}
+
+#endif
+
+} // namespace
+
+void writeFileAtomically(const std::filesystem::path &path,
+                         std::string_view data)
+{
+  auto temp = path;
+  temp += ".tmp";
+  writeDurably(temp, data);
+  replaceFile(temp, path);
+}
+
+std::optional<std::string> readFile(const std::filesystem::path &path)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+  {
+    return std::nullopt;
+  }
+  std::string data{std::istreambuf_iterator<char>(in),
+                   std::istreambuf_iterator<char>()};
+  if (in.bad())
+  {
+    return std::nullopt;
+  }
+  return data;
+}
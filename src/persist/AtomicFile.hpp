@@ -0,0 +1,18 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/// Replaces the file at `path` with `data` through a temporary file
+/// (`<path>.tmp`) that is flushed to disk and renamed over the old one, so
+/// readers (and a restart after a crash) see either the old or the new
+/// contents, never a mix.
+///
+/// Throws `std::system_error` on failure - the old file is left untouched.
+void writeFileAtomically(const std::filesystem::path &path,
+                         std::string_view data);
+
+/// Returns `std::nullopt` if the file doesn't exist or can't be read.
+std::optional<std::string> readFile(const std::filesystem::path &path);
@@ -0,0 +1,95 @@
+#include "persist/PersistWriter.hpp"
+
+#include "log/Log.hpp"
+#include "persist/AtomicFile.hpp"
+#include "trace/Trace.hpp"
+
+#include <algorithm>
+#include <exception>
+
+PersistWriter::PersistWriter() : thread_([this] { this->run(); }) {}
+
+PersistWriter::~PersistWriter()
+{
+  {
+    std::lock_guard lock(this->mtx_);
+    this->stopping_ = true;
+  }
+  this->wake_.notify_one();
+  this->thread_.join();
+}
+
+void PersistWriter::write(std::filesystem::path path, std::string data)
+{
+  {
+    std::lock_guard lock(this->mtx_);
+    this->stats_.queued++;
+    auto it = std::ranges::find(this->pending_, path,
+                                [](const auto &entry) { return entry.first; });
+    if (it != this->pending_.end())
+    {
+      it->second = std::move(data);
+      this->stats_.coalesced++;
+      return;
+    }
+    this->pending_.emplace_back(std::move(path), std::move(data));
+  }
+  this->wake_.notify_one();
+}
+
+void PersistWriter::flush()
+{
+  std::unique_lock lock(this->mtx_);
+  this->idle_.wait(lock, [this]
+                   { return this->pending_.empty() && !this->writing_; });
+}
+
+PersistWriter::Stats PersistWriter::stats() const
+{
+  std::lock_guard lock(this->mtx_);
+  return this->stats_;
+}
+
+void PersistWriter::run()
+{
+  Log::setThreadName("Persist");
+  Tracer::setThreadName("Persist");
+
+  std::vector<std::pair<std::filesystem::path, std::string>> batch;
+  std::unique_lock lock(this->mtx_);
+  for (;;)
+  {
+    this->wake_.wait(lock, [this]
+                     { return !this->pending_.empty() || this->stopping_; });
+    if (this->pending_.empty())
+    {
+      return; // stopping and everything is written
+    }
+
+    batch.swap(this->pending_);
+    this->writing_ = true;
+    lock.unlock();
+
+    std::uint64_t failed = 0;
+    for (const auto &[path, data] : batch)
+    {
+      TraceSpan span("persist", "io");
+      try
+      {
+        writeFileAtomically(path, data);
+      }
+      catch (const std::exception &ex)
+      {
+        Log::warn("Failed to write {}: {}", path.string(), ex.what());
+        failed++;
+      }
+    }
+
+    lock.lock();
+    this->stats_.written += batch.size() - failed;
+    this->stats_.failed += failed;
+    batch.clear();
+    this->writing_ = false;
+    this->idle_.notify_all();
+  }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// Writes files on a single background thread with `writeFileAtomically`.
+///
+/// Writes are coalesced per file: data queued for a file that wasn't
+/// written yet replaces the older data, so a burst of saves costs one write
+/// and the newest contents always win. Callers never wait on the disk
+/// (except in `flush()`).
+class PersistWriter
+{
+public:
+  struct Stats
+  {
+    std::uint64_t queued = 0;
+    std::uint64_t written = 0;
+    /// Writes that were replaced by newer data before they happened
+    std::uint64_t coalesced = 0;
+    std::uint64_t failed = 0;
+  };
+
+  PersistWriter();
+  /// Writes everything that's still queued.
+  ~PersistWriter();
+
+  PersistWriter(const PersistWriter &) = delete;
+  PersistWriter(PersistWriter &&) noexcept = delete;
+  PersistWriter &operator=(const PersistWriter &) = delete;
+  PersistWriter &operator=(PersistWriter &&) noexcept = delete;
+
+  void write(std::filesystem::path path, std::string data);
+  /// Blocks until everything queued so far is written.
+  void flush();
+
+  Stats stats() const;
+
+private:
+  void run();
+
+  mutable std::mutex mtx_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  /// In the order the files were first queued
+  std::vector<std::pair<std::filesystem::path, std::string>> pending_;
+  bool writing_ = false;
+  bool stopping_ = false;
+  Stats stats_;
+
+  std::thread thread_;
+};
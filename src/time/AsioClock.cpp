@@ -0,0 +1,50 @@
+#include "time/AsioClock.hpp"
+
+AsioClock::AsioClock(const boost::asio::any_io_executor &executor)
+    : timer_(executor)
+{
+}
+
+Clock::TimerId AsioClock::schedule(Duration delay,
+                                   std::function<void()> callback)
+{
+  auto id = this->queue_.add(this->now() + delay, std::move(callback));
+  this->rearm();
+  return id;
+}
+
+void AsioClock::cancel(TimerId id)
+{
+  this->queue_.remove(id);
+  this->rearm();
+}
+
+void AsioClock::rearm()
+{
+  auto next = this->queue_.nextDeadline();
+  if (next == this->armedFor_)
+  {
+    return;
+  }
+  this->armedFor_ = next;
+  if (!next)
+  {
+    this->timer_.cancel();
+    return;
+  }
+
+  this->timer_.expires_at(*next);
+  this->timer_.async_wait(
+      [this](const boost::system::error_code &ec)
+      {
+        if (ec)
+        {
+          return; // re-armed or cancelled
+        }
+        this->armedFor_.reset();
+        while (this->queue_.runNext(this->now()))
+        {
+        }
+        this->rearm();
+      });
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "time/Clock.hpp"
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <optional>
+
+/// A clock for the IO thread, backed by a single `steady_timer`.
+class AsioClock : public Clock
+{
+public:
+  explicit AsioClock(const boost::asio::any_io_executor &executor);
+
+  TimePoint now() const override { return std::chrono::steady_clock::now(); }
+
+  TimerId schedule(Duration delay, std::function<void()> callback) override;
+  void cancel(TimerId id) override;
+
+private:
+  void rearm();
+
+  boost::asio::steady_timer timer_;
+  std::optional<TimePoint> armedFor_;
+  TimerQueue queue_;
+};
+
@@ -0,0 +1,74 @@
+#include "time/Clock.hpp"
+
+Timer::Timer(Clock &clock, std::function<void()> callback)
+    : clock_(clock),
+      callback_(std::move(callback))
+{
+}
+
+Timer::~Timer()
+{
+  this->stop();
+}
+
+void Timer::start(Clock::Duration delay)
+{
+  this->stop();
+  this->id_ = this->clock_.schedule(delay,
+                                    [this]
+                                    {
+                                      this->id_ = 0;
+                                      this->callback_();
+                                    });
+}
+
+void Timer::stop()
+{
+  if (this->id_ != 0)
+  {
+    this->clock_.cancel(this->id_);
+    this->id_ = 0;
+  }
+}
+
+Clock::TimerId TimerQueue::add(Clock::TimePoint deadline,
+                               std::function<void()> callback)
+{
+  auto id = this->nextId_++;
+  this->queue_.emplace(Key{deadline, id}, std::move(callback));
+  this->deadlines_.emplace(id, deadline);
+  return id;
+}
+
+void TimerQueue::remove(Clock::TimerId id)
+{
+  auto it = this->deadlines_.find(id);
+  if (it == this->deadlines_.end())
+  {
+    return;
+  }
+  this->queue_.erase(Key{it->second, id});
+  this->deadlines_.erase(it);
+}
+
+std::optional<Clock::TimePoint> TimerQueue::nextDeadline() const
+{
+  if (this->queue_.empty())
+  {
+    return std::nullopt;
+  }
+  return this->queue_.begin()->first.first;
+}
+
+bool TimerQueue::runNext(Clock::TimePoint now)
+{
+  if (this->queue_.empty() || this->queue_.begin()->first.first > now)
+  {
+    return false;
+  }
+
+  auto node = this->queue_.extract(this->queue_.begin());
+  this->deadlines_.erase(node.key().second);
+  node.mapped()();
+  return true;
+}
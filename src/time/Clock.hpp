@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+/// A source of time that can run callbacks after a delay.
+///
+/// Callbacks always run on the thread that owns the clock (the UI thread for
+/// `WxClock`, the IO thread for `AsioClock`). `VirtualClock` only advances
+/// when told to, so time-driven code can be run faster than wall-clock time.
+class Clock
+{
+public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+  using Duration = std::chrono::steady_clock::duration;
+  using TimerId = std::uint64_t;
+
+  virtual ~Clock() = default;
+
+  virtual TimePoint now() const = 0;
+
+  virtual TimerId schedule(Duration delay, std::function<void()> callback) = 0;
+  virtual void cancel(TimerId id) = 0;
+};
+
+/// A restartable one-shot timer.
+class Timer
+{
+public:
+  Timer(Clock &clock, std::function<void()> callback);
+  ~Timer();
+
+  Timer(const Timer &) = delete;
+  Timer(Timer &&) noexcept = delete;
+  Timer &operator=(const Timer &) = delete;
+  Timer &operator=(Timer &&) noexcept = delete;
+
+  /// (Re-)starts the timer - a running timer is stopped first.
+  void start(Clock::Duration delay);
+  void stop();
+
+  bool isRunning() const { return this->id_ != 0; }
+
+private:
+  Clock &clock_;
+  std::function<void()> callback_;
+  Clock::TimerId id_ = 0;
+};
+
+/// Pending callbacks ordered by their deadline (and by the order they were
+/// scheduled in). Shared by the `Clock` implementations.
+class TimerQueue
+{
+public:
+  Clock::TimerId add(Clock::TimePoint deadline, std::function<void()> callback);
+  void remove(Clock::TimerId id);
+
+  std::optional<Clock::TimePoint> nextDeadline() const;
+  std::size_t size() const { return this->queue_.size(); }
+
+  /// Runs the earliest callback if it's due at `now`. The callback is removed
+  /// before it runs, so it may schedule new callbacks.
+  bool runNext(Clock::TimePoint now);
+
+private:
+  using Key = std::pair<Clock::TimePoint, Clock::TimerId>;
+
+  std::map<Key, std::function<void()>> queue_;
+  std::unordered_map<Clock::TimerId, Clock::TimePoint> deadlines_;
+  Clock::TimerId nextId_ = 1;
+};
@@ -0,0 +1,23 @@
+#include "time/Debouncer.hpp"
+
+Debouncer::Debouncer(Clock &clock, Clock::Duration delay,
+                     std::function<void()> callback)
+    : delay_(delay),
+      timer_(clock, std::move(callback))
+{
+}
+
+Throttle::Throttle(Clock &clock, Clock::Duration interval,
+                   std::function<void()> callback)
+    : interval_(interval),
+      timer_(clock, std::move(callback))
+{
+}
+
+void Throttle::trigger()
+{
+  if (!this->timer_.isRunning())
+  {
+    this->timer_.start(this->interval_);
+  }
+}
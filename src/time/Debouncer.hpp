@@ -0,0 +1,39 @@
+#pragma once
+
+#include "time/Clock.hpp"
+
+#include <functional>
+
+/// Runs a callback once `delay` passed without another `trigger()` - e.g.
+/// after the last keystroke of an edit.
+class Debouncer
+{
+public:
+  Debouncer(Clock &clock, Clock::Duration delay,
+            std::function<void()> callback);
+
+  void trigger() { this->timer_.start(this->delay_); }
+  void cancel() { this->timer_.stop(); }
+  bool isPending() const { return this->timer_.isRunning(); }
+
+private:
+  Clock::Duration delay_;
+  Timer timer_;
+};
+
+/// Runs a callback at most once per `interval`. The first `trigger()` starts
+/// the interval, later ones are merged into it.
+class Throttle
+{
+public:
+  Throttle(Clock &clock, Clock::Duration interval,
+           std::function<void()> callback);
+
+  void trigger();
+  void cancel() { this->timer_.stop(); }
+  bool isPending() const { return this->timer_.isRunning(); }
+
+private:
+  Clock::Duration interval_;
+  Timer timer_;
+};
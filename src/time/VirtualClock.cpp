@@ -0,0 +1,54 @@
+#include "time/VirtualClock.hpp"
+
+#include <algorithm>
+
+VirtualClock::VirtualClock(TimePoint start) : now_(start) {}
+
+Clock::TimerId VirtualClock::schedule(Duration delay,
+                                      std::function<void()> callback)
+{
+  return this->queue_.add(this->now_ + std::max(delay, Duration::zero()),
+                          std::move(callback));
+}
+
+void VirtualClock::cancel(TimerId id)
+{
+  this->queue_.remove(id);
+}
+
+void VirtualClock::advance(Duration duration)
+{
+  this->advanceTo(this->now_ + duration);
+}
+
+void VirtualClock::advanceTo(TimePoint target)
+{
+  while (auto next = this->queue_.nextDeadline())
+  {
+    if (*next > target)
+    {
+      break;
+    }
+    this->now_ = std::max(this->now_, *next);
+    this->queue_.runNext(this->now_);
+  }
+  this->now_ = std::max(this->now_, target);
+}
+
+std::size_t VirtualClock::runUntilIdle(TimePoint limit)
+{
+  std::size_t ran = 0;
+  while (auto next = this->queue_.nextDeadline())
+  {
+    if (*next > limit)
+    {
+      break;
+    }
+    this->now_ = std::max(this->now_, *next);
+    if (this->queue_.runNext(this->now_))
+    {
+      ran++;
+    }
+  }
+  return ran;
+}
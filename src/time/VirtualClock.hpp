@@ -0,0 +1,29 @@
+#pragma once
+
+#include "time/Clock.hpp"
+
+/// A clock that only moves when it's advanced. Timers run synchronously
+/// inside `advance`, in deadline order, with `now()` set to their deadline.
+class VirtualClock : public Clock
+{
+public:
+  explicit VirtualClock(TimePoint start = {});
+
+  TimePoint now() const override { return this->now_; }
+
+  TimerId schedule(Duration delay, std::function<void()> callback) override;
+  void cancel(TimerId id) override;
+
+  void advance(Duration duration);
+  void advanceTo(TimePoint target);
+
+  /// Jumps from deadline to deadline until no timers are left or `limit` is
+  /// reached. Returns the number of timers that ran.
+  std::size_t runUntilIdle(TimePoint limit = TimePoint::max());
+
+  std::size_t pending() const { return this->queue_.size(); }
+
+private:
+  TimePoint now_;
+  TimerQueue queue_;
+};
@@ -0,0 +1,44 @@
+#include "time/WxClock.hpp"
+
+#include <algorithm>
+
+Clock::TimerId WxClock::schedule(Duration delay, std::function<void()> callback)
+{
+  auto id = this->queue_.add(this->now() + delay, std::move(callback));
+  this->rearm();
+  return id;
+}
+
+void WxClock::cancel(TimerId id)
+{
+  this->queue_.remove(id);
+  this->rearm();
+}
+
+void WxClock::Notify()
+{
+  this->armedFor_.reset();
+  while (this->queue_.runNext(this->now()))
+  {
+  }
+  this->rearm();
+}
+
+void WxClock::rearm()
+{
+  auto next = this->queue_.nextDeadline();
+  if (next == this->armedFor_)
+  {
+    return;
+  }
+  this->armedFor_ = next;
+  if (!next)
+  {
+    this->Stop();
+    return;
+  }
+
+  auto delay =
+      std::chrono::ceil<std::chrono::milliseconds>(*next - this->now());
+  this->StartOnce(static_cast<int>(std::max<std::int64_t>(delay.count(), 1)));
+}
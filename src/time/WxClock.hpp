@@ -0,0 +1,24 @@
+#pragma once
+
+#include "time/Clock.hpp"
+
+#include <wx/timer.h>
+
+/// A clock for the UI thread, backed by a single `wxTimer`.
+class WxClock : public Clock, private wxTimer
+{
+public:
+  WxClock() = default;
+
+  TimePoint now() const override { return std::chrono::steady_clock::now(); }
+
+  TimerId schedule(Duration delay, std::function<void()> callback) override;
+  void cancel(TimerId id) override;
+
+private:
+  void Notify() override;
+  void rearm();
+
+  std::optional<TimePoint> armedFor_;
+  TimerQueue queue_;
+};
@@ -0,0 +1,78 @@
+#include "trace/Startup.hpp"
+
+#include "log/Log.hpp"
+#include "trace/Trace.hpp"
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::array<const char *, Startup::MILESTONE_COUNT> MILESTONE_NAMES{
+    "window", "settings", "media", "connected", "firstMessage",
+};
+
+std::int64_t toTicks(Clock::time_point at)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             at.time_since_epoch())
+      .count();
+}
+
+Clock::time_point fromTicks(std::int64_t ticks)
+{
+  return Clock::time_point(
+      std::chrono::duration_cast<Clock::duration>(
+          std::chrono::nanoseconds(ticks)));
+}
+
+} // namespace
+
+void Startup::begin()
+{
+  begin_.store(toTicks(Clock::now()), std::memory_order_relaxed);
+  for (auto &reached : reached_)
+  {
+    reached.store(0, std::memory_order_relaxed);
+  }
+}
+
+void Startup::record(Milestone milestone)
+{
+  auto start = begin_.load(std::memory_order_relaxed);
+  if (start == 0)
+  {
+    return;
+  }
+
+  auto now = Clock::now();
+  std::int64_t expected = 0;
+  if (!reached_[static_cast<std::size_t>(milestone)].compare_exchange_strong(
+          expected, toTicks(now), std::memory_order_relaxed))
+  {
+    return; // someone else was faster
+  }
+
+  const auto *name = MILESTONE_NAMES[static_cast<std::size_t>(milestone)];
+  Log::info("Startup: {} after {}ms", name,
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                now - fromTicks(start))
+                .count());
+  if (Tracer::enabled())
+  {
+    Tracer::complete(name, "startup", fromTicks(start), now);
+  }
+}
+
+std::optional<std::chrono::nanoseconds> Startup::elapsed(Milestone milestone)
+{
+  auto start = begin_.load(std::memory_order_relaxed);
+  auto reached =
+      reached_[static_cast<std::size_t>(milestone)].load(
+          std::memory_order_relaxed);
+  if (start == 0 || reached == 0)
+  {
+    return std::nullopt;
+  }
+  return std::chrono::nanoseconds(reached - start);
+}
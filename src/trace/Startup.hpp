@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/// Milestones of the app's startup, measured from `begin()`.
+///
+/// Each milestone is reached once: it's logged with the time since the start
+/// and recorded as a span from the start (category `startup`) in the trace.
+/// After that, reaching it again costs a single relaxed load.
+class Startup
+{
+public:
+  enum class Milestone : std::uint8_t
+  {
+    Window,
+    Settings,
+    Media,
+    Connected,
+    FirstMessage,
+  };
+  static constexpr std::size_t MILESTONE_COUNT = 5;
+
+  static void begin();
+  /// Does nothing before `begin()` or if `milestone` was already reached.
+  static void reach(Milestone milestone)
+  {
+    if (reached_[static_cast<std::size_t>(milestone)].load(
+            std::memory_order_relaxed) == 0)
+    {
+      record(milestone);
+    }
+  }
+  /// The time from `begin()` to `milestone` if it was reached.
+  static std::optional<std::chrono::nanoseconds> elapsed(Milestone milestone);
+
+private:
+  static void record(Milestone milestone);
+
+  /// Nanoseconds since the steady clock's epoch, 0 if not started.
+  static inline std::atomic<std::int64_t> begin_{0};
+  static inline std::array<std::atomic<std::int64_t>, MILESTONE_COUNT>
+      reached_{};
+};
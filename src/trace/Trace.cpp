@@ -0,0 +1,298 @@
+#include "trace/Trace.hpp"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <print>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+/// Events are handed to the collector in chunks of this size.
+constexpr std::size_t CHUNK_SIZE = 4096;
+/// Events beyond this are dropped (~40 MB).
+constexpr std::size_t MAX_EVENTS = 1'000'000;
+
+struct TraceEvent
+{
+  const char *name;
+  const char *category;
+  Tracer::TimePoint ts;
+  /// Duration in ns for complete events, the id for async events
+  std::uint64_t value;
+  std::uint32_t tid;
+  char phase;
+};
+
+class ThreadBuffer;
+
+class Collector
+{
+public:
+  void registerBuffer(ThreadBuffer *buffer, std::uint32_t &tid)
+  {
+    std::lock_guard lock(this->mtx_);
+    this->buffers_.emplace_back(buffer);
+    tid = this->nextTid_++;
+  }
+
+  void unregisterBuffer(ThreadBuffer *buffer)
+  {
+    std::lock_guard lock(this->mtx_);
+    std::erase(this->buffers_, buffer);
+  }
+
+  void submit(const std::vector<TraceEvent> &events)
+  {
+    std::lock_guard lock(this->mtx_);
+    this->append(events);
+  }
+
+  void nameThread(std::uint32_t tid, const char *name)
+  {
+    std::lock_guard lock(this->mtx_);
+    this->threadNames_.emplace_back(tid, name);
+  }
+
+  bool start(std::filesystem::path path)
+  {
+    std::lock_guard lock(this->mtx_);
+    if (!this->path_.empty())
+    {
+      return false;
+    }
+    this->path_ = std::move(path);
+    this->origin_ = std::chrono::steady_clock::now();
+    this->events_.clear();
+    this->dropped_ = 0;
+    return true;
+  }
+
+  void stop();
+
+private:
+  void append(const std::vector<TraceEvent> &events)
+  {
+    auto space = MAX_EVENTS - std::min(MAX_EVENTS, this->events_.size());
+    auto take = std::min(space, events.size());
+    this->events_.insert(this->events_.end(), events.begin(),
+                         events.begin() + static_cast<std::ptrdiff_t>(take));
+    this->dropped_ += events.size() - take;
+  }
+
+  void write();
+
+  std::mutex mtx_;
+  std::vector<ThreadBuffer *> buffers_;
+  std::vector<TraceEvent> events_;
+  std::vector<std::pair<std::uint32_t, const char *>> threadNames_;
+  std::filesystem::path path_;
+  Tracer::TimePoint origin_;
+  std::size_t dropped_ = 0;
+  std::uint32_t nextTid_ = 1;
+};
+
+Collector &collector()
+{
+  // never destroyed - threads may still record while the process exits
+  static auto *instance = new Collector;
+  return *instance;
+}
+
+class ThreadBuffer
+{
+public:
+  ThreadBuffer() { collector().registerBuffer(this, this->tid_); }
+
+  ~ThreadBuffer()
+  {
+    collector().unregisterBuffer(this);
+    collector().submit(this->take());
+  }
+
+  ThreadBuffer(const ThreadBuffer &) = delete;
+  ThreadBuffer(ThreadBuffer &&) noexcept = delete;
+  ThreadBuffer &operator=(const ThreadBuffer &) = delete;
+  ThreadBuffer &operator=(ThreadBuffer &&) noexcept = delete;
+
+  void push(const char *name, const char *category, char phase,
+            Tracer::TimePoint ts, std::uint64_t value)
+  {
+    std::vector<TraceEvent> full;
+    {
+      std::lock_guard lock(this->mtx_); // only contended in stop()
+      this->events_.emplace_back(TraceEvent{
+          .name = name,
+          .category = category,
+          .ts = ts,
+          .value = value,
+          .tid = this->tid_,
+          .phase = phase,
+      });
+      if (this->events_.size() >= CHUNK_SIZE)
+      {
+        std::swap(full, this->events_);
+      }
+    }
+    // don't hold our lock here - `Collector::stop` locks in the other order
+    if (!full.empty())
+    {
+      collector().submit(full);
+    }
+  }
+
+  std::vector<TraceEvent> take()
+  {
+    std::lock_guard lock(this->mtx_);
+    return std::exchange(this->events_, {});
+  }
+
+  std::uint32_t tid() const { return this->tid_; }
+
+private:
+  std::mutex mtx_;
+  std::vector<TraceEvent> events_;
+  std::uint32_t tid_ = 0;
+};
+
+ThreadBuffer &threadBuffer()
+{
+  thread_local ThreadBuffer buffer;
+  return buffer;
+}
+
+void Collector::stop()
+{
+  std::lock_guard lock(this->mtx_);
+  for (auto *buffer : this->buffers_)
+  {
+    this->append(buffer->take());
+  }
+  this->write();
+  this->path_.clear();
+  this->events_.clear();
+  this->events_.shrink_to_fit();
+}
+
+void Collector::write()
+{
+  std::ofstream out(this->path_, std::ios::binary);
+  if (!out)
+  {
+    std::println(stderr, "Failed to open {}", this->path_.string());
+    return;
+  }
+
+  auto micros = [&](Tracer::TimePoint ts)
+  {
+    return std::chrono::duration<double, std::micro>(ts - this->origin_)
+        .count();
+  };
+
+  std::string buf = R"({"displayTimeUnit":"ns","traceEvents":[)";
+  auto it = std::back_inserter(buf);
+  bool first = true;
+  auto separate = [&]
+  {
+    if (!first)
+    {
+      buf += ",\n";
+    }
+    first = false;
+  };
+
+  for (const auto &[tid, name] : this->threadNames_)
+  {
+    separate();
+    std::format_to(it,
+                   R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},)"
+                   R"("args":{{"name":"{}"}}}})",
+                   tid, name);
+  }
+  for (const auto &ev : this->events_)
+  {
+    separate();
+    if (ev.phase == 'X')
+    {
+      std::format_to(it,
+                     R"({{"name":"{}","cat":"{}","ph":"X","ts":{:.3f},)"
+                     R"("dur":{:.3f},"pid":1,"tid":{}}})",
+                     ev.name, ev.category, micros(ev.ts),
+                     static_cast<double>(ev.value) / 1000.0, ev.tid);
+    }
+    else
+    {
+      std::format_to(it,
+                     R"({{"name":"{}","cat":"{}","ph":"{}","ts":{:.3f},)"
+                     R"("id":"{:#x}","pid":1,"tid":{}}})",
+                     ev.name, ev.category, ev.phase, micros(ev.ts), ev.value,
+                     ev.tid);
+    }
+
+    if (buf.size() > (1 << 20))
+    {
+      out << buf;
+      buf.clear();
+    }
+  }
+  buf += "]}\n";
+  out << buf;
+
+  std::println(stderr, "Wrote {} trace events to {}{}", this->events_.size(),
+               this->path_.string(),
+               this->dropped_ == 0
+                   ? std::string{}
+                   : std::format(" ({} dropped)", this->dropped_));
+}
+
+} // namespace
+
+bool Tracer::start(std::filesystem::path path)
+{
+  if (!collector().start(std::move(path)))
+  {
+    return false;
+  }
+  active_.store(true);
+  return true;
+}
+
+void Tracer::stop()
+{
+  if (!active_.exchange(false))
+  {
+    return;
+  }
+  collector().stop();
+}
+
+void Tracer::setThreadName(const char *name)
+{
+  collector().nameThread(threadBuffer().tid(), name);
+}
+
+void Tracer::complete(const char *name, const char *category,
+                      TimePoint start, TimePoint end)
+{
+  auto dur =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  threadBuffer().push(name, category, 'X', start,
+                      static_cast<std::uint64_t>(dur));
+}
+
+void Tracer::asyncBegin(const char *name, const char *category,
+                        std::uint64_t id, TimePoint at)
+{
+  threadBuffer().push(name, category, 'b', at, id);
+}
+
+void Tracer::asyncEnd(const char *name, const char *category,
+                      std::uint64_t id, TimePoint at)
+{
+  threadBuffer().push(name, category, 'e', at, id);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+/// Opt-in tracing to Chrome trace-event JSON (open it in `chrome://tracing`
+/// or https://ui.perfetto.dev).
+///
+/// Events go into a buffer owned by the recording thread and are only
+/// collected in `stop()`. While tracing is disabled, a span costs a single
+/// relaxed load.
+///
+/// Names and categories must be string literals - only the pointers are
+/// stored.
+class Tracer
+{
+public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  static bool enabled() { return active_.load(std::memory_order_relaxed); }
+
+  /// Starts recording. The trace is written to `path` in `stop()`.
+  static bool start(std::filesystem::path path);
+  /// Stops recording and writes the trace.
+  static void stop();
+
+  /// Names the calling thread in the trace.
+  static void setThreadName(const char *name);
+
+  static void complete(const char *name, const char *category,
+                       TimePoint start, TimePoint end);
+  static void asyncBegin(const char *name, const char *category,
+                         std::uint64_t id, TimePoint at);
+  static void asyncEnd(const char *name, const char *category,
+                       std::uint64_t id, TimePoint at);
+  static std::uint64_t nextId()
+  {
+    return idCounter_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+private:
+  static inline std::atomic<bool> active_{false};
+  static inline std::atomic<std::uint64_t> idCounter_{1};
+};
+
+/// Records the time until the end of the scope as a span on the current
+/// thread. Don't keep it across a `co_await` - use `AsyncTraceSpan` there.
+class TraceSpan
+{
+public:
+  explicit TraceSpan(const char *name, const char *category = "irc")
+      : name_(name),
+        category_(category)
+  {
+    if (Tracer::enabled())
+    {
+      this->start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~TraceSpan()
+  {
+    if (this->start_ != Tracer::TimePoint{} && Tracer::enabled())
+    {
+      Tracer::complete(this->name_, this->category_, this->start_,
+                       std::chrono::steady_clock::now());
+    }
+  }
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan(TraceSpan &&) noexcept = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+  TraceSpan &operator=(TraceSpan &&) noexcept = delete;
+
+private:
+  const char *name_;
+  const char *category_;
+  Tracer::TimePoint start_;
+};
+
+/// Like `TraceSpan`, but recorded as an async event, so it may span
+/// suspension points of a coroutine and overlap with other spans.
+class AsyncTraceSpan
+{
+public:
+  explicit AsyncTraceSpan(const char *name, const char *category = "irc")
+      : name_(name),
+        category_(category)
+  {
+    if (Tracer::enabled())
+    {
+      this->id_ = Tracer::nextId();
+      Tracer::asyncBegin(this->name_, this->category_, this->id_,
+                         std::chrono::steady_clock::now());
+    }
+  }
+
+  ~AsyncTraceSpan()
+  {
+    if (this->id_ != 0 && Tracer::enabled())
+    {
+      Tracer::asyncEnd(this->name_, this->category_, this->id_,
+                       std::chrono::steady_clock::now());
+    }
+  }
+
+  AsyncTraceSpan(const AsyncTraceSpan &) = delete;
+  AsyncTraceSpan(AsyncTraceSpan &&) noexcept = delete;
+  AsyncTraceSpan &operator=(const AsyncTraceSpan &) = delete;
+  AsyncTraceSpan &operator=(AsyncTraceSpan &&) noexcept = delete;
+
+private:
+  const char *name_;
+  const char *category_;
+  std::uint64_t id_ = 0;
+};
@@ -0,0 +1,421 @@
+#include "IrcSimulator.hpp"
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/experimental/awaitable_operators.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+
+#include <array>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <print>
+#include <random>
+#include <string_view>
+
+namespace
+{
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace websocket = boost::beast::websocket;
+
+using asio::awaitable;
+using asio::use_awaitable;
+using asio::ip::tcp;
+using boost::system::error_code;
+using Clock = std::chrono::steady_clock;
+
+using namespace boost::asio::experimental::awaitable_operators;
+using namespace std::string_view_literals;
+
+/// How long the client may take to close the connection after a RECONNECT
+constexpr auto RECONNECT_GRACE = std::chrono::seconds(5);
+
+constexpr std::array CHATTER = {
+    "KEKW"sv,
+    "this song is a banger"sv,
+    "@nerixyz what's the name of this song?"sv,
+    "PogChamp PogChamp PogChamp"sv,
+    "first time hearing this one, not bad"sv,
+    "!song"sv,
+    "catJAM catJAM catJAM catJAM catJAM catJAM"sv,
+};
+
+class SimConnection : public std::enable_shared_from_this<SimConnection>
+{
+public:
+  SimConnection(tcp::socket socket, const SimConfig &config, SimStats &stats)
+      : ws_(std::move(socket)),
+        wake_(this->ws_.get_executor()),
+        config_(config),
+        stats_(stats),
+        rng_(std::random_device{}()),
+        nonce_(32 + config.tagPadding, 'f')
+  {
+  }
+
+  awaitable<void> run()
+  {
+    websocket::permessage_deflate deflate;
+    deflate.server_enable = this->config_.deflate;
+    this->ws_.set_option(deflate);
+    co_await this->ws_.async_accept(use_awaitable);
+    this->ws_.text(true);
+
+    this->connectedAt_ = Clock::now();
+    this->nextPing_ = this->connectedAt_ + this->config_.pingInterval;
+    co_await (this->readLoop() || this->writeLoop());
+
+    error_code ec;
+    co_await this->ws_.async_close(websocket::close_code::normal,
+                                   asio::redirect_error(use_awaitable, ec));
+  }
+
+private:
+  awaitable<void> readLoop()
+  {
+    beast::flat_buffer buf;
+    for (;;)
+    {
+      error_code ec;
+      co_await this->ws_.async_read(buf,
+                                    asio::redirect_error(use_awaitable, ec));
+      if (ec)
+      {
+        this->clientClosed_ = true;
+        this->wake_.cancel();
+        if (!this->reconnectSent_)
+        {
+          throw boost::system::system_error(ec);
+        }
+        this->stats_.reconnectsFollowed.fetch_add(1,
+                                                  std::memory_order_relaxed);
+        co_return;
+      }
+      std::string_view data{static_cast<const char *>(buf.cdata().data()),
+                            buf.cdata().size()};
+      std::size_t end = 0;
+      while ((end = data.find('\n')) != std::string_view::npos)
+      {
+        auto line = data.substr(0, end);
+        if (line.ends_with('\r'))
+        {
+          line.remove_suffix(1);
+        }
+        this->handleLine(line);
+        data.remove_prefix(end + 1);
+      }
+      buf.consume(buf.size() - data.size());
+    }
+  }
+
+  void handleLine(std::string_view line)
+  {
+    if (line.starts_with("CAP REQ :"sv))
+    {
+      this->queue(std::format(":tmi.twitch.tv CAP * ACK :{}\r\n",
+                              line.substr(9)));
+    }
+    else if (line.starts_with("NICK "sv))
+    {
+      this->nick_ = line.substr(5);
+      this->queue(std::format(":tmi.twitch.tv 001 {} :Welcome, GLHF!\r\n",
+                              this->nick_));
+    }
+    else if (line.starts_with("JOIN #"sv))
+    {
+      this->channel_ = line.substr(6);
+      this->trafficStart_ = Clock::now();
+      this->sent_ = 0;
+      this->queue(std::format(":{0}!{0}@{0}.tmi.twitch.tv JOIN #{1}\r\n",
+                              this->nick_, this->channel_));
+    }
+    else if (line.starts_with("PART #"sv))
+    {
+      this->queue(std::format(":{0}!{0}@{0}.tmi.twitch.tv PART #{1}\r\n",
+                              this->nick_, line.substr(6)));
+      if (line.substr(6) == this->channel_)
+      {
+        this->channel_.clear();
+      }
+    }
+    else if (line.starts_with("PING "sv))
+    {
+      this->queue(std::format(":tmi.twitch.tv PONG tmi.twitch.tv {}\r\n",
+                              line.substr(5)));
+    }
+    else if (line.starts_with("PONG"sv))
+    {
+      this->stats_.pongs.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  awaitable<void> writeLoop()
+  {
+    std::string frame;
+    for (;;)
+    {
+      auto now = Clock::now();
+      frame = std::move(this->pending_);
+      this->pending_.clear();
+
+      if (now >= this->nextPing_)
+      {
+        frame += "PING :tmi.twitch.tv\r\n"sv;
+        this->nextPing_ = now + this->config_.pingInterval;
+      }
+
+      if (this->config_.reconnectAfter.count() != 0 &&
+          now >= this->connectedAt_ + this->config_.reconnectAfter)
+      {
+        frame += ":tmi.twitch.tv RECONNECT\r\n"sv;
+        co_await this->writeFrame(frame);
+        this->reconnectSent_ = true;
+        this->stats_.reconnectsSent.fetch_add(1, std::memory_order_relaxed);
+        co_await this->awaitClose();
+        co_return;
+      }
+
+      auto count = this->messagesDue(now);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        this->appendPrivmsg(frame);
+      }
+
+      if (!frame.empty())
+      {
+        co_await this->writeFrame(frame);
+        continue;
+      }
+
+      error_code ec;
+      this->wake_.expires_at(this->nextDeadline());
+      co_await this->wake_.async_wait(asio::redirect_error(use_awaitable, ec));
+    }
+  }
+
+  /// Waits for the client to close the connection after a RECONNECT.
+  awaitable<void> awaitClose()
+  {
+    auto deadline = Clock::now() + RECONNECT_GRACE;
+    while (!this->clientClosed_ && Clock::now() < deadline)
+    {
+      error_code ec;
+      this->wake_.expires_at(deadline);
+      co_await this->wake_.async_wait(asio::redirect_error(use_awaitable, ec));
+    }
+    if (!this->clientClosed_)
+    {
+      std::println(stderr, "The client ignored a RECONNECT for {}s",
+                   RECONNECT_GRACE.count());
+    }
+  }
+
+  awaitable<void> writeFrame(std::string &frame)
+  {
+    if (this->config_.fragmentRatio > 0 && frame.size() > 1 &&
+        this->chance(this->config_.fragmentRatio))
+    {
+      auto cut = std::uniform_int_distribution<std::size_t>(
+          1, frame.size() - 1)(this->rng_);
+      this->pending_.insert(0, frame, cut);
+      frame.resize(cut);
+    }
+
+    co_await this->ws_.async_write(asio::buffer(frame), use_awaitable);
+    this->stats_.frames.fetch_add(1, std::memory_order_relaxed);
+    this->stats_.bytes.fetch_add(frame.size(), std::memory_order_relaxed);
+  }
+
+  std::size_t messagesDue(Clock::time_point now) const
+  {
+    if (this->channel_.empty() ||
+        (this->config_.totalMessages != 0 &&
+         this->sent_ >= this->config_.totalMessages))
+    {
+      return 0;
+    }
+
+    auto due = static_cast<std::uint64_t>(this->config_.batch);
+    if (this->config_.rate > 0)
+    {
+      std::chrono::duration<double> elapsed = now - this->trafficStart_;
+      auto target =
+          static_cast<std::uint64_t>(elapsed.count() * this->config_.rate);
+      due = target > this->sent_ ? target - this->sent_ : 0;
+    }
+    if (this->config_.totalMessages != 0)
+    {
+      due = std::min(due, this->config_.totalMessages - this->sent_);
+    }
+    return static_cast<std::size_t>(
+        std::min(due, static_cast<std::uint64_t>(this->config_.batch)));
+  }
+
+  Clock::time_point nextDeadline() const
+  {
+    auto deadline = this->nextPing_;
+    if (this->config_.reconnectAfter.count() != 0)
+    {
+      deadline = std::min(deadline,
+                          this->connectedAt_ + this->config_.reconnectAfter);
+    }
+    if (!this->channel_.empty() && this->config_.rate > 0 &&
+        (this->config_.totalMessages == 0 ||
+         this->sent_ < this->config_.totalMessages))
+    {
+      auto next = this->trafficStart_ +
+                  std::chrono::duration_cast<Clock::duration>(
+                      std::chrono::duration<double>(
+                          static_cast<double>(this->sent_ + 1) /
+                          this->config_.rate));
+      deadline = std::min(deadline, next);
+    }
+    return deadline;
+  }
+
+  void appendPrivmsg(std::string &frame)
+  {
+    bool isSpam = this->config_.spammers > 0 &&
+                  this->chance(this->config_.spamRatio);
+    auto user = std::uniform_int_distribution<std::size_t>(
+        0, (isSpam ? this->config_.spammers : this->config_.users) - 1)(
+        this->rng_);
+    // subscriber status is a property of the user, not the message
+    bool isSub = static_cast<double>((user * 2654435761U) % 1000) <
+                 this->config_.subRatio * 1000.0;
+    bool isVote = this->chance(this->config_.voteRatio);
+    auto content =
+        isVote ? std::string_view{this->config_.command}
+               : CHATTER[this->sent_ % CHATTER.size()]; // NOLINT
+    auto sentTs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count() -
+                  this->lag(Clock::now()).count();
+
+    std::format_to(
+        std::back_inserter(frame),
+        "@badge-info={};badges={}premium/1;client-nonce={};color=#1E90FF;"
+        "display-name=SimUser{};emotes=;first-msg=0;flags=;"
+        "id=5e1f0c3a-{:04x}-4c2e-9d3b-{:012x};mod=0;returning-chatter=0;"
+        "room-id=11148817;subscriber={};tmi-sent-ts={};turbo=0;user-id={};"
+        "user-type= :simuser{}!simuser{}@simuser{}.tmi.twitch.tv "
+        "PRIVMSG #{} :{}\r\n",
+        isSub ? "subscriber/12"sv : ""sv, isSub ? "subscriber/12,"sv : ""sv,
+        this->nonce_, user, user & 0xffff, this->sent_, isSub ? 1 : 0, sentTs,
+        10000000 + user, user, user, user, this->channel_, content);
+
+    this->sent_++;
+    this->stats_.messages.fetch_add(1, std::memory_order_relaxed);
+    if (isVote)
+    {
+      this->stats_.votes.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /// How late the messages are delivered
+  std::chrono::milliseconds lag(Clock::time_point now) const
+  {
+    auto degradedAt = this->connectedAt_ + this->config_.degradeAfter;
+    if (this->config_.lagGrowth.count() == 0 || now <= degradedAt)
+    {
+      return {};
+    }
+    std::chrono::duration<double> degraded = now - degradedAt;
+    return std::chrono::milliseconds(static_cast<std::int64_t>(
+        degraded.count() *
+        static_cast<double>(this->config_.lagGrowth.count())));
+  }
+
+  void queue(std::string line)
+  {
+    this->pending_ += line;
+    this->wake_.cancel();
+  }
+
+  bool chance(double p) { return std::bernoulli_distribution(p)(this->rng_); }
+
+  websocket::stream<beast::tcp_stream> ws_;
+  asio::steady_timer wake_;
+  const SimConfig &config_;
+  SimStats &stats_;
+  std::minstd_rand rng_;
+
+  std::string nonce_;
+  std::string nick_;
+  std::string channel_;
+  std::string pending_;
+
+  Clock::time_point connectedAt_;
+  Clock::time_point trafficStart_;
+  Clock::time_point nextPing_;
+  std::uint64_t sent_ = 0;
+  bool reconnectSent_ = false;
+  bool clientClosed_ = false;
+};
+
+} // namespace
+
+IrcSimulator::IrcSimulator(boost::asio::io_context &ctx, SimConfig config)
+    : acceptor_(ctx),
+      config_(std::move(config))
+{
+  tcp::endpoint endpoint{asio::ip::make_address(this->config_.address),
+                         this->config_.port};
+  this->acceptor_.open(endpoint.protocol());
+  this->acceptor_.set_option(tcp::acceptor::reuse_address(true));
+  this->acceptor_.bind(endpoint);
+  this->acceptor_.listen();
+}
+
+void IrcSimulator::start()
+{
+  asio::co_spawn(this->acceptor_.get_executor(), this->listen(),
+                 [](const std::exception_ptr &e)
+                 {
+                   if (e)
+                   {
+                     std::println(stderr, "Simulator stopped listening");
+                   }
+                 });
+}
+
+std::uint16_t IrcSimulator::port() const
+{
+  return this->acceptor_.local_endpoint().port();
+}
+
+awaitable<void> IrcSimulator::listen()
+{
+  for (;;)
+  {
+    auto socket = co_await this->acceptor_.async_accept(use_awaitable);
+    socket.set_option(tcp::no_delay(true));
+    this->stats_.connections.fetch_add(1, std::memory_order_relaxed);
+
+    auto conn = std::make_shared<SimConnection>(std::move(socket),
+                                                this->config_, this->stats_);
+    asio::co_spawn(
+        this->acceptor_.get_executor(),
+        [conn]() -> awaitable<void> { co_await conn->run(); },
+        [](const std::exception_ptr &e)
+        {
+          if (e)
+          {
+            try
+            {
+              std::rethrow_exception(e);
+            }
+            catch (const std::exception &ex)
+            {
+              std::println(stderr, "Connection closed: {}", ex.what());
+            }
+          }
+        });
+  }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+struct SimConfig
+{
+  std::string address = "127.0.0.1";
+  std::uint16_t port = 6667;
+
+  /// PRIVMSGs per second and connection (0 = as fast as possible)
+  double rate = 1000.0;
+  /// Maximum number of IRC lines in a single WebSocket frame
+  std::size_t batch = 32;
+  /// Probability of a frame being cut in the middle of a line
+  double fragmentRatio = 0.0;
+  /// Probability of a PRIVMSG being a vote (`command`)
+  double voteRatio = 0.1;
+  /// Share of users that have a subscriber badge
+  double subRatio = 0.3;
+  /// Number of distinct chatters
+  std::size_t users = 10000;
+  /// The first `spammers` chatters send `spamRatio` of all messages
+  std::size_t spammers = 0;
+  double spamRatio = 0.0;
+  /// Additional bytes added to the `client-nonce` tag
+  std::size_t tagPadding = 0;
+  std::string command = "-voteskip";
+  /// Accept `permessage-deflate` if the client offers it
+  bool deflate = false;
+
+  std::chrono::seconds pingInterval{60};
+  /// Send a RECONNECT after this duration (0 = never)
+  std::chrono::seconds reconnectAfter{0};
+  /// Stop sending PRIVMSGs after this many messages (0 = never)
+  std::uint64_t totalMessages = 0;
+  /// Once a connection is `degradeAfter` old, its messages are delivered
+  /// late - the lag grows by `lagGrowth` per second (0 = never).
+  std::chrono::seconds degradeAfter{0};
+  std::chrono::milliseconds lagGrowth{0};
+};
+
+struct SimStats
+{
+  std::atomic<std::uint64_t> connections = 0;
+  std::atomic<std::uint64_t> frames = 0;
+  std::atomic<std::uint64_t> bytes = 0;
+  std::atomic<std::uint64_t> messages = 0;
+  std::atomic<std::uint64_t> votes = 0;
+  std::atomic<std::uint64_t> pongs = 0;
+  std::atomic<std::uint64_t> reconnectsSent = 0;
+  /// RECONNECTs the client answered by closing the connection in time
+  std::atomic<std::uint64_t> reconnectsFollowed = 0;
+};
+
+/// A stand-in for `irc-ws.chat.twitch.tv` speaking plain WebSocket.
+///
+/// It implements the subset used by `IrcClient` (CAP/PASS/NICK/JOIN/PART,
+/// PING/PONG and RECONNECT) and floods every joined connection with
+/// PRIVMSGs according to its `SimConfig`. A degrading connection is
+/// simulated by backdating `tmi-sent-ts`.
+class IrcSimulator
+{
+public:
+  IrcSimulator(boost::asio::io_context &ctx, SimConfig config);
+
+  void start();
+
+  /// The port the simulator is listening on (useful with `port = 0`)
+  std::uint16_t port() const;
+  const SimStats &stats() const { return this->stats_; }
+
+private:
+  boost::asio::awaitable<void> listen();
+
+  boost::asio::ip::tcp::acceptor acceptor_;
+  SimConfig config_;
+  SimStats stats_;
+};
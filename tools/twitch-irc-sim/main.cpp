@@ -0,0 +1,220 @@
+#include "IrcSimulator.hpp"
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include <charconv>
+#include <print>
+#include <span>
+#include <string_view>
+
+namespace
+{
+
+namespace asio = boost::asio;
+
+using namespace std::string_view_literals;
+
+constexpr std::string_view USAGE = R"(Usage: twitch-irc-sim [options]
+
+Options:
+  --address <ip>            Address to listen on (default: 127.0.0.1)
+  --port <port>             Port to listen on (default: 6667)
+  --rate <msgs/s>           PRIVMSGs per second and connection, 0 = unlimited
+  --batch <n>               Maximum IRC lines per WebSocket frame
+  --fragment <ratio>        Probability of splitting a frame mid-line
+  --vote-ratio <ratio>      Probability of a message being a vote
+  --sub-ratio <ratio>       Share of subscribed users
+  --users <n>               Number of distinct chatters
+  --spammers <n>            Number of chatters that spam (the first n users)
+  --spam-ratio <ratio>      Share of messages sent by the spammers
+  --tag-padding <bytes>     Extra bytes per message in the tags
+  --command <text>          The vote command (default: -voteskip)
+  --deflate <on|off>        Accept permessage-deflate (default: off)
+  --ping-interval <s>       Seconds between PINGs
+  --reconnect-after <s>     Send RECONNECT after this many seconds, 0 = never
+  --total <n>               Stop after sending n PRIVMSGs, 0 = never
+  --degrade-after <s>       Start delivering messages late after this many
+                            seconds on a connection
+  --lag-growth <ms>         Milliseconds the lag grows per second, 0 = never
+
+Point SkipMySong at the simulator with
+  SKIP_MY_SONG_IRC_URL=ws://127.0.0.1:6667/
+)";
+
+template <typename T> bool parseNumber(std::string_view value, T &target)
+{
+  auto [ptr, ec] =
+      std::from_chars(value.data(), value.data() + value.size(), target);
+  return ec == std::errc{} && ptr == value.data() + value.size();
+}
+
+bool parseSeconds(std::string_view value, std::chrono::seconds &target)
+{
+  long long seconds = 0;
+  if (!parseNumber(value, seconds))
+  {
+    return false;
+  }
+  target = std::chrono::seconds(seconds);
+  return true;
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+bool parseArgs(std::span<char *> args, SimConfig &config)
+{
+  for (std::size_t i = 1; i < args.size(); i++)
+  {
+    std::string_view key = args[i];
+    if (key == "--help"sv || key == "-h"sv || i + 1 >= args.size())
+    {
+      return false;
+    }
+    std::string_view value = args[++i];
+
+    bool ok = true;
+    if (key == "--address"sv)
+    {
+      config.address = value;
+    }
+    else if (key == "--port"sv)
+    {
+      ok = parseNumber(value, config.port);
+    }
+    else if (key == "--rate"sv)
+    {
+      ok = parseNumber(value, config.rate);
+    }
+    else if (key == "--batch"sv)
+    {
+      ok = parseNumber(value, config.batch) && config.batch > 0;
+    }
+    else if (key == "--fragment"sv)
+    {
+      ok = parseNumber(value, config.fragmentRatio);
+    }
+    else if (key == "--vote-ratio"sv)
+    {
+      ok = parseNumber(value, config.voteRatio);
+    }
+    else if (key == "--sub-ratio"sv)
+    {
+      ok = parseNumber(value, config.subRatio);
+    }
+    else if (key == "--users"sv)
+    {
+      ok = parseNumber(value, config.users) && config.users > 0;
+    }
+    else if (key == "--spammers"sv)
+    {
+      ok = parseNumber(value, config.spammers);
+    }
+    else if (key == "--spam-ratio"sv)
+    {
+      ok = parseNumber(value, config.spamRatio);
+    }
+    else if (key == "--tag-padding"sv)
+    {
+      ok = parseNumber(value, config.tagPadding);
+    }
+    else if (key == "--command"sv)
+    {
+      config.command = value;
+    }
+    else if (key == "--deflate"sv)
+    {
+      ok = value == "on"sv || value == "off"sv;
+      config.deflate = value == "on"sv;
+    }
+    else if (key == "--ping-interval"sv)
+    {
+      ok = parseSeconds(value, config.pingInterval) &&
+           config.pingInterval.count() > 0;
+    }
+    else if (key == "--reconnect-after"sv)
+    {
+      ok = parseSeconds(value, config.reconnectAfter);
+    }
+    else if (key == "--total"sv)
+    {
+      ok = parseNumber(value, config.totalMessages);
+    }
+    else if (key == "--degrade-after"sv)
+    {
+      ok = parseSeconds(value, config.degradeAfter);
+    }
+    else if (key == "--lag-growth"sv)
+    {
+      long long ms = 0;
+      ok = parseNumber(value, ms) && ms >= 0;
+      config.lagGrowth = std::chrono::milliseconds(ms);
+    }
+    else
+    {
+      ok = false;
+    }
+
+    if (!ok)
+    {
+      std::println(stderr, "Invalid option: {} {}", key, value);
+      return false;
+    }
+  }
+  return true;
+}
+
+asio::awaitable<void> reportStats(const SimStats &stats)
+{
+  asio::steady_timer timer(co_await asio::this_coro::executor);
+  std::uint64_t lastMessages = 0;
+  std::uint64_t lastBytes = 0;
+  for (;;)
+  {
+    timer.expires_after(std::chrono::seconds(1));
+    co_await timer.async_wait(asio::use_awaitable);
+
+    auto messages = stats.messages.load(std::memory_order_relaxed);
+    auto bytes = stats.bytes.load(std::memory_order_relaxed);
+    std::println(
+        "connections={} msgs/s={} kB/s={} votes={} pongs={} reconnects={}/{}",
+        stats.connections.load(std::memory_order_relaxed),
+        messages - lastMessages, (bytes - lastBytes) / 1024,
+        stats.votes.load(std::memory_order_relaxed),
+        stats.pongs.load(std::memory_order_relaxed),
+        stats.reconnectsFollowed.load(std::memory_order_relaxed),
+        stats.reconnectsSent.load(std::memory_order_relaxed));
+    lastMessages = messages;
+    lastBytes = bytes;
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  SimConfig config;
+  if (!parseArgs({argv, static_cast<std::size_t>(argc)}, config))
+  {
+    std::print(stderr, "{}", USAGE);
+    return 1;
+  }
+
+  try
+  {
+    asio::io_context ctx;
+    IrcSimulator sim(ctx, config);
+    sim.start();
+    std::println("Listening on ws://{}:{}/", config.address, sim.port());
+
+    asio::co_spawn(ctx, reportStats(sim.stats()), asio::detached);
+    ctx.run();
+  }
+  catch (const std::exception &ex)
+  {
+    std::println(stderr, "Exception: {}", ex.what());
+    return 1;
+  }
+  return 0;
+}